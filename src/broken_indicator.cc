@@ -27,6 +27,7 @@
 #include <generic/apt/aptitude_resolver_universe.h>
 #include <generic/apt/config_signal.h>
 #include <generic/apt/resolver_manager.h>
+#include <generic/apt/version_rank.h>
 
 #include <generic/problemresolver/exceptions.h>
 #include <generic/problemresolver/solution.h>
@@ -344,8 +345,7 @@ public:
 	  ++remove_count;
 	else
 	  {
-	    int cmp=_system->VS->CmpVersion(curver.VerStr(),
-					    newver.VerStr());
+	    int cmp=aptitude::apt::compare_versions(curver, newver);
 
 	    // The versions shouldn't be equal -- otherwise
 	    // something is majorly wrong.
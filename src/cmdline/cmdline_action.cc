@@ -13,6 +13,7 @@
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
+#include <generic/apt/source_index.h>
 #include <generic/apt/tasks.h>
 
 #include <apt-pkg/algorithms.h>
@@ -46,9 +47,12 @@ namespace
 				bool allow_auto,
                                 const std::shared_ptr<terminal_metrics> &term_metrics)
   {
-    // check for deb-src in sources.list or die -- needs to instantiate
+    // check for deb-src in sources.list or die -- the index is built
+    // once and shared by every package on the command line
     {
-      pkgSrcRecords records(*apt_source_list);
+      const aptitude::apt::source_index *index = aptitude::apt::get_source_index();
+      if(index == NULL || !index->has_sources())
+	_error->Error(_("You must put some 'deb-src' URIs in your sources.list"));
       aptitude::cmdline::on_apt_errors_print_and_die();
     }
 
@@ -24,137 +24,262 @@
 
 #include "cmdline_util.h"
 
+#include <generic/apt/apt.h>
 #include <generic/apt/aptitude_resolver_universe.h>
+#include <generic/apt/version_rank.h>
 #include <generic/problemresolver/sanity_check_universe.h>
 
 #include <apt-pkg/error.h>
+#include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/progress.h>
+#include <apt-pkg/version.h>
 
 #include <algorithm>
-#include <iterator>
+#include <functional>
+#include <sstream>
+#include <thread>
 
 using namespace std;
 
 namespace
 {
-  // Check that each real (non-virtual) package and real version are
-  // represented in the universe.
-  void check_packages_and_versions(const aptitude_universe &u)
+  // Check that a real (non-virtual) package and its real versions are
+  // represented in the universe, and that the universe agrees with
+  // the cache about which version is installed.
+  //
+  // Returns the number of problems written to out.
+  unsigned long check_package(const aptitude_universe::package &p,
+			      std::ostream &out)
   {
-    std::set<pkgCache::PkgIterator> real_packages;
-
-    // Insert each non-virtual package into real_packages.
-    for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin();
-	!pkg.end(); ++pkg)
+    const pkgCache::PkgIterator apt_pkg = p.get_pkg();
+    unsigned long errors = 0;
+    bool seen_uninst = false;
+
+    // Packages have a handful of versions, so plain vectors are
+    // cheaper than sets here.
+    std::vector<pkgCache::VerIterator> seen_versions;
+    for(aptitude_universe::package::version_iterator vi = p.versions_begin();
+	!vi.end(); ++vi)
       {
-	if(!pkg.VersionList().end())
-	  real_packages.insert(pkg);
+	if(vi.get_ver().end())
+	  seen_uninst = true;
+	else
+	  seen_versions.push_back(vi.get_ver());
       }
 
-    std::set<pkgCache::PkgIterator> seen_packages;
-
-    for(aptitude_universe::package_iterator pi = u.packages_begin();
-	!pi.end(); ++pi)
+    if(!seen_uninst)
       {
-	const aptitude_universe::package p = *pi;
-	const pkgCache::PkgIterator apt_pkg = p.get_pkg();
-	bool seen_uninst = false;
+	out << "Didn't see the UNINST version of the package " << apt_pkg.FullName(false) << "." << std::endl;
+	++errors;
+      }
 
-	seen_packages.insert(apt_pkg);
+    for(pkgCache::VerIterator ver = apt_pkg.VersionList();
+	!ver.end(); ++ver)
+      {
+	// Skip versions that exist only on the current system and
+	// that have been removed; the resolver does.
+	if(!ver.Downloadable() &&
+	   (ver != apt_pkg.CurrentVer() ||
+	    apt_pkg->CurrentState == pkgCache::State::ConfigFiles))
+	  continue;
+
+	if(std::find(seen_versions.begin(), seen_versions.end(), ver) == seen_versions.end())
+	  {
+	    out << "The package version " << ver.ParentPkg().FullName(false)
+		<< " " << ver.VerStr() << " is missing from the resolver."
+		<< std::endl;
+	    ++errors;
+	  }
+      }
 
-	std::set<pkgCache::VerIterator> real_versions;
-	for(pkgCache::VerIterator ver = apt_pkg.VersionList();
-	    !ver.end(); ++ver)
+    if((*apt_cache_file)[apt_pkg].Keep() &&
+       apt_pkg->CurrentState == pkgCache::State::ConfigFiles)
+      {
+	if(!p.current_version().get_ver().end())
 	  {
-	    // Skip versions that exist only on the current system and
-	    // that have been removed; the resolver does.
-	    if( ! (!ver.Downloadable() &&
-		   (ver != apt_pkg.CurrentVer() ||
-		    apt_pkg->CurrentState == pkgCache::State::ConfigFiles) ))
-	      real_versions.insert(ver);
+	    out << "The package " << apt_pkg.FullName(false)
+		<< " only has config files installed, but version "
+		<< p.current_version().get_ver().VerStr()
+		<< " is installed according to the resolver."
+		<< std::endl;
+	    ++errors;
 	  }
+      }
+    else
+      {
+	pkgCache::VerIterator cache_instver = (*apt_cache_file)[apt_pkg].InstVerIter(*apt_cache_file);
+	pkgCache::VerIterator resolver_instver = p.current_version().get_ver();
 
-	std::set<pkgCache::VerIterator> seen_versions;
-	for(aptitude_universe::package::version_iterator vi = p.versions_begin();
-	    !vi.end(); ++vi)
+	if(cache_instver != resolver_instver)
 	  {
-	    if(vi.get_ver().end())
-	      seen_uninst = true;
+	    if(cache_instver.end())
+	      out << "The package " << apt_pkg.FullName(false)
+		  << " should not be installed, but version "
+		  << resolver_instver.VerStr()
+		  << " is installed according to the resolver."
+		  << std::endl;
+	    else if(resolver_instver.end())
+	      out << "The package " << apt_pkg.FullName(false)
+		  << " should be installed at version "
+		  << cache_instver.VerStr()
+		  << ", but it isn't installed according to the resolver."
+		  << std::endl;
 	    else
-	      seen_versions.insert(vi.get_ver());
+	      out << "The package " << apt_pkg.FullName(false)
+		  << " should be installed at version "
+		  << cache_instver.VerStr()
+		  << ", but version "
+		  << resolver_instver.VerStr()
+		  << " is installed according to the resolver."
+		  << std::endl;
+	    ++errors;
 	  }
+      }
 
-	if(!seen_uninst)
-	  std::cout << "Didn't see the UNINST version of the package " << apt_pkg.FullName(false) << "." << std::endl;
+    return errors;
+  }
 
-	std::vector<pkgCache::VerIterator> remaining_versions;
-	std::set_difference(real_versions.begin(), real_versions.end(),
-			    seen_versions.begin(), seen_versions.end(),
-			    std::back_inserter(remaining_versions));
+  int sign(int n)
+  {
+    return (n > 0) - (n < 0);
+  }
 
-	for(std::vector<pkgCache::VerIterator>::const_iterator it =
-	      remaining_versions.begin(); it != remaining_versions.end();
-	    ++it)
-	  {
-	    std::cout << "The package version " << it->ParentPkg().FullName(false)
-		      << " " << it->VerStr() << " is missing from the resolver."
-		      << std::endl;
-	  }
+  // Check that the precomputed version ranks order each version of a
+  // package against the other versions of its group the same way as
+  // the versioning system does.
+  //
+  // Returns the number of problems written to out.
+  unsigned long check_version_ranks(const pkgCache::PkgIterator &pkg,
+				    std::ostream &out)
+  {
+    unsigned long errors = 0;
+    pkgCache::GrpIterator grp = pkg.Group();
 
-	if((*apt_cache_file)[apt_pkg].Keep() &&
-	   apt_pkg->CurrentState == pkgCache::State::ConfigFiles)
+    for(pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver)
+      for(pkgCache::PkgIterator other_pkg = grp.PackageList();
+	  !other_pkg.end(); other_pkg = grp.NextPkg(other_pkg))
+	for(pkgCache::VerIterator other = other_pkg.VersionList(); !other.end(); ++other)
 	  {
-	    if(!p.current_version().get_ver().end())
+	    const int expected = sign(_system->VS->CmpVersion(ver.VerStr(), other.VerStr()));
+	    const int ranked = sign(aptitude::apt::compare_versions(ver, other));
+
+	    if(expected != ranked)
 	      {
-		std::cout << "The package " << apt_pkg.FullName(false)
-			  << " only has config files installed, but version "
-			  << p.current_version().get_ver().VerStr()
-			  << " is installed according to the resolver."
-			  << std::endl;
+		out << "The versions " << pkg.FullName(false) << " " << ver.VerStr()
+		    << " and " << other_pkg.FullName(false) << " " << other.VerStr()
+		    << " compare as " << ranked << " using their ranks, but as "
+		    << expected << " using their version strings." << std::endl;
+		++errors;
 	      }
 	  }
-	else
-	  {
-	    pkgCache::VerIterator cache_instver = (*apt_cache_file)[apt_pkg].InstVerIter(*apt_cache_file);
-	    pkgCache::VerIterator resolver_instver = p.current_version().get_ver();
 
-	    if(cache_instver != resolver_instver)
-	      {
-		if(cache_instver.end())
-		  std::cout << "The package " << apt_pkg.FullName(false)
-			    << " should not be installed, but version "
-			    << resolver_instver.VerStr()
-			    << " is installed according to the resolver."
-			    << std::endl;
-		else if(resolver_instver.end())
-		  std::cout << "The package " << apt_pkg.FullName(false)
-			    << " should be installed at version "
-			    << cache_instver.VerStr()
-			    << ", but it isn't installed according to the resolver."
-			    << std::endl;
-		else
-		  std::cout << "The package " << apt_pkg.FullName(false)
-			    << " should be installed at version "
-			    << cache_instver.VerStr()
-			    << ", but version "
-			    << resolver_instver.VerStr()
-			    << " is installed according to the resolver."
-			    << std::endl;
-	      }
+    return errors;
+  }
+
+  // Check every package whose ID falls in one shard.  Shards only read
+  // the cache and the universe, so they run in parallel; their
+  // reports are buffered so that they can be printed in ID order.
+  struct check_shard
+  {
+    unsigned long begin, end;
+    std::ostringstream out;
+    unsigned long errors;
+
+    check_shard()
+      : begin(0), end(0), errors(0)
+    {
+    }
+  };
+
+  void run_shard(check_shard &shard,
+		 const std::vector<aptitude_universe::package> &packages,
+		 const std::vector<bool> &in_universe,
+		 bool check_tables)
+  {
+    for(unsigned long id = shard.begin; id < shard.end; ++id)
+      {
+	if(!in_universe[id])
+	  continue;
+
+	const aptitude_universe::package &p = packages[id];
+	const pkgCache::PkgIterator apt_pkg = p.get_pkg();
+
+	shard.errors += check_package(p, shard.out);
+	if(check_tables)
+	  shard.errors += check_dep_tables(apt_pkg, *apt_cache_file, shard.out);
+	shard.errors += check_version_ranks(apt_pkg, shard.out);
+      }
+  }
+
+  // Check the projection of every package and the tables that the
+  // resolver relies on, sharding the package IDs between threads.
+  //
+  // Returns the number of problems found.
+  unsigned long check_packages_and_versions(const aptitude_universe &u)
+  {
+    const unsigned long num_packages = (*apt_cache_file)->Head().PackageCount;
+    std::vector<aptitude_universe::package> packages(num_packages);
+    std::vector<bool> in_universe(num_packages);
+    unsigned long errors = 0;
+
+    for(aptitude_universe::package_iterator pi = u.packages_begin();
+	!pi.end(); ++pi)
+      {
+	const unsigned long id = (*pi).get_pkg()->ID;
+	packages[id] = *pi;
+	in_universe[id] = true;
+      }
+
+    for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin();
+	!pkg.end(); ++pkg)
+      {
+	if(!pkg.VersionList().end() && !in_universe[pkg->ID])
+	  {
+	    std::cout << "The package " << pkg.FullName(true)
+		      << " is missing from the resolver model." << std::endl;
+	    ++errors;
 	  }
       }
 
-    std::vector<pkgCache::PkgIterator> remaining_packages;
-    std::set_difference(real_packages.begin(), real_packages.end(),
-			seen_packages.begin(), seen_packages.end(),
-			std::back_inserter(remaining_packages));
+    // Report a mismatch of the dependency tables once, rather than
+    // for every package.
+    const bool check_tables = dep_tables_describe(*apt_cache_file);
+    if(!check_tables)
+      {
+	std::cout << "The dependency tables do not describe the loaded cache." << std::endl;
+	++errors;
+      }
+
+    // Rank the versions before the workers start, rather than in
+    // whichever worker happens to ask first.
+    aptitude::apt::get_version_rank_table();
 
-    for(std::vector<pkgCache::PkgIterator>::const_iterator it =
-	  remaining_packages.begin(); it != remaining_packages.end(); ++it)
+    const unsigned int num_shards = std::max(1U, std::thread::hardware_concurrency());
+    const unsigned long shard_size = (num_packages + num_shards - 1) / num_shards;
+
+    std::vector<check_shard> shards(num_shards);
+    for(unsigned int i = 0; i < num_shards; ++i)
       {
-	std::cout << "The package " << it->FullName(true)
-		  << " is missing from the resolver model." << std::endl;
+	shards[i].begin = std::min(num_packages, i * shard_size);
+	shards[i].end = std::min(num_packages, (i + 1) * shard_size);
       }
+
+    std::vector<std::thread> workers;
+    for(unsigned int i = 1; i < num_shards; ++i)
+      workers.push_back(std::thread(run_shard, std::ref(shards[i]),
+				    std::cref(packages), std::cref(in_universe),
+				    check_tables));
+    run_shard(shards[0], packages, in_universe, check_tables);
+    for(std::thread &worker : workers)
+      worker.join();
+
+    for(const check_shard &shard : shards)
+      {
+	std::cout << shard.out.str();
+	errors += shard.errors;
+      }
+
+    return errors;
   }
 }
 
@@ -175,7 +300,7 @@ int cmdline_check_resolver(int argc, char *argv[],
   std::cout << "Checking that packages and versions are properly projected."
 	    << std::endl;
 
-  check_packages_and_versions(u);
+  unsigned long errors = check_packages_and_versions(u);
 
   // TODO: test that all dependencies are represented, somehow.  This
   // is complicated since dependency representation isn't one-to-one.
@@ -183,9 +308,15 @@ int cmdline_check_resolver(int argc, char *argv[],
   std::cout << "Checking internal consistency of the dependency model."
 	    << std::endl;
 
-  sanity_check_universe(u);
+  errors += sanity_check_universe(u);
 
   std::cout << "Sanity check complete." << std::endl;
 
+  if(errors > 0)
+    {
+      std::cout << "Found " << errors << " problems." << std::endl;
+      return 1;
+    }
+
   return 0;
 }
@@ -211,37 +211,42 @@ int cmdline_do_action(int argc, char *argv[],
 
   pkgset to_install, to_hold, to_remove, to_purge;
 
-  if(upgrade_mode == full_upgrade || upgrade_mode == safe_upgrade)
-    {
-      bool ignore_removed = (upgrade_mode == safe_upgrade);
+  {
+    // Sweep once for the upgrades and the Essential packages together.
+    aptitudeDepCache::action_group group(*apt_cache_file, NULL);
 
-      (*apt_cache_file)->get_upgradable(ignore_removed, to_install);
+    if(upgrade_mode == full_upgrade || upgrade_mode == safe_upgrade)
+      {
+	bool ignore_removed = (upgrade_mode == safe_upgrade);
 
-      bool use_autoinst = (resolver_mode != resolver_mode_safe);
-      (*apt_cache_file)->mark_all_upgradable(use_autoinst, ignore_removed, NULL);
-    }
+	(*apt_cache_file)->get_upgradable(ignore_removed, to_install);
 
-  // same implementation in CmdLine full-upgrade and UI MarkUpgradable
-  //
-  // install Essential/Required packages -- #555896 and #757028
-  if (upgrade_mode == full_upgrade)
-    {
-      for (pkgCache::GrpIterator grp = (*apt_cache_file)->GrpBegin(); !grp.end(); ++grp)
-	{
-	  for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg))
-	    {
-	      bool is_essential = (pkg->Flags & pkgCache::Flag::Essential) == pkgCache::Flag::Essential;
-	      if (!is_essential || is_installed(pkg))
-		continue;
+	bool use_autoinst = (resolver_mode != resolver_mode_safe);
+	(*apt_cache_file)->mark_all_upgradable(use_autoinst, ignore_removed, NULL);
+      }
 
-	      pkgCache::PkgIterator preferred_pkg = grp.FindPreferredPkg();
-	      if (is_installed(preferred_pkg) || (*apt_cache_file)[preferred_pkg].Install())
-		continue;
+    // same implementation in CmdLine full-upgrade and UI MarkUpgradable
+    //
+    // install Essential/Required packages -- #555896 and #757028
+    if (upgrade_mode == full_upgrade)
+      {
+	for (pkgCache::GrpIterator grp = (*apt_cache_file)->GrpBegin(); !grp.end(); ++grp)
+	  {
+	    for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg))
+	      {
+		bool is_essential = (pkg->Flags & pkgCache::Flag::Essential) == pkgCache::Flag::Essential;
+		if (!is_essential || is_installed(pkg))
+		  continue;
 
-	      (*apt_cache_file)->mark_install(preferred_pkg, false, false, nullptr);
-	    }
-	}
-    }
+		pkgCache::PkgIterator preferred_pkg = grp.FindPreferredPkg();
+		if (is_installed(preferred_pkg) || (*apt_cache_file)[preferred_pkg].Install())
+		  continue;
+
+		(*apt_cache_file)->mark_install(preferred_pkg, false, false, nullptr);
+	      }
+	  }
+      }
+  }
 
   bool apply_ok = true;
 
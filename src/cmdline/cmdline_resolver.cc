@@ -133,7 +133,7 @@ static cw::fragment *solution_story(const aptitude_solution &s,
     }
 }
 
-void cmdline_dump_resolver()
+void cmdline_dump_resolver(bool quiet)
 {
   string dumpfile = aptcfg->Find(PACKAGE "::CmdLine::Resolver-Dump", "");
   if(!dumpfile.empty())
@@ -147,7 +147,7 @@ void cmdline_dump_resolver()
 
 	  if(!f)
 	    _error->Errno("dump_resolver", _("Error writing resolver state to %s"), dumpfile.c_str());
-	  else
+	  else if(!quiet)
 	    cout << _("Resolver state successfully written!");
 	}
     }
@@ -781,14 +781,31 @@ static aptitude_solution wait_for_solution(cwidget::threads::box<cmdline_resolve
 	{
 	  resolver_manager::state state = resman->state_snapshot();
 
-	  spin.set_msg(ssprintf(_("open: %zd; closed: %zd; defer: %zd; conflict: %zd"),
-				state.open_size, state.closed_size,
-				state.deferred_size, state.conflicts_size));
+	  if(state.pruned_size > 0)
+	    spin.set_msg(ssprintf(_("open: %zd; closed: %zd; defer: %zd; conflict: %zd; pruned: %zd"),
+				  state.open_size, state.closed_size,
+				  state.deferred_size, state.conflicts_size,
+				  state.pruned_size));
+	  else
+	    spin.set_msg(ssprintf(_("open: %zd; closed: %zd; defer: %zd; conflict: %zd"),
+				  state.open_size, state.closed_size,
+				  state.deferred_size, state.conflicts_size));
 	  spin.display();
 	  spin.tick();
 	}
     } while(!done);
 
+  if(aptcfg->FindB(PACKAGE "::ProblemResolver::Profile", false))
+    {
+      // Move past the spinner before writing the report.
+      std::cout << std::endl;
+      resman->dump_profile(std::cout);
+      // Rewrite the dump, if one was requested, so that it includes
+      // the profile of this search; it was already announced before
+      // the search started.
+      cmdline_dump_resolver(true);
+    }
+
   if(res.out_of_time)
     throw NoMoreTime();
   else if(res.out_of_solutions)
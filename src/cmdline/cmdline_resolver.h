@@ -99,8 +99,11 @@ generic_solution<aptitude_universe> calculate_current_solution(bool print_resolv
  *  If the configuration option Aptitude::CMdLine::Resolver-Dump is
  *  set, its value is taken to be the name of a file to which the
  *  resolver state should be written.
+ *
+ *  \param quiet  if \b true, don't announce that the state was
+ *                written (errors are still reported).
  */
-void cmdline_dump_resolver();
+void cmdline_dump_resolver(bool quiet = false);
 
 /** Run the resolver once, possibly prompting the user in the process.
  *
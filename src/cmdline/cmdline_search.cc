@@ -87,12 +87,39 @@ using namespace cwidget::config;
 
 namespace
 {
+  /** \brief Print how much time each sub-pattern took and how many
+   *  of its inputs it matched.
+   */
+  void print_explanation(const std::vector<search_cache::subpattern_profile> &profile)
+  {
+    printf(_("\nSearch explanation:\n"));
+    // TRANSLATORS: column headers of the table printed by "search
+    // --explain"; keep the widths of the columns.
+    printf(_("      Time   Evaluated    Matched  Estimated       Cost  Pattern\n"));
+
+    for(std::vector<search_cache::subpattern_profile>::const_iterator it =
+          profile.begin(); it != profile.end(); ++it)
+      {
+        const double selectivity =
+          it->evaluations == 0 ? 0 : ((double)it->matches) / it->evaluations;
+
+        printf("%8.1fms  %10lu  %8.1f%%  %8.1f%%  %9.0f  %s\n",
+               it->elapsed * 1000,
+               it->evaluations,
+               selectivity * 100,
+               it->estimated_selectivity * 100,
+               it->estimated_cost,
+               serialize_pattern(it->p).c_str());
+      }
+  }
+
   int do_search_packages(const std::vector<ref_ptr<pattern> > &patterns,
                          pkg_sortpolicy *sort_policy,
                          const column_definition_list &columns,
                          int width,
                          bool disable_columns,
                          bool debug,
+                         bool explain,
                          const std::shared_ptr<terminal_locale> &term_locale,
                          const std::shared_ptr<terminal_metrics> &term_metrics,
                          const std::shared_ptr<terminal_output> &term_output)
@@ -107,6 +134,7 @@ namespace
 
     results_list output;
     ref_ptr<search_cache> search_info(search_cache::create());
+    search_info->set_profiling(explain);
     for(std::vector<ref_ptr<pattern> >::const_iterator pIt = patterns.begin();
         pIt != patterns.end(); ++pIt)
       {
@@ -145,6 +173,8 @@ namespace
 				 aptitude::cmdline::package_results_eq()),
 		     output.end());
 
+	aptitude::cmdline::buffered_line_writer writer;
+
 	for(results_list::const_iterator it = output.begin(); it != output.end(); ++it)
 	  {
 	    column_parameters *p =
@@ -167,7 +197,7 @@ namespace
 	      line = aptitude::cmdline::de_columnize(columns, columnizer, *p);
 	    else
 	      line = columnizer.layout_columns(width, *p);
-	    printf("%ls\n", line.c_str());
+	    writer.write_line(line);
 
 	    // Note that this deletes the whole result, so we can't re-use
 	    // the list.
@@ -175,6 +205,9 @@ namespace
 	  }
       }
 
+    if(explain)
+      print_explanation(search_info->get_profile());
+
     return exit_status;
   }
 }
@@ -182,7 +215,7 @@ namespace
 // FIXME: apt-cache does lots of tricks to make this fast.  Should I?
 int cmdline_search(int argc, char *argv[], const char *status_fname,
 		   string display_format, string width_cfg, string sort,
-		   bool disable_columns, bool debug)
+		   bool disable_columns, bool debug, bool explain)
 {
   std::shared_ptr<terminal_io> term = create_terminal();
 
@@ -276,6 +309,7 @@ int cmdline_search(int argc, char *argv[], const char *status_fname,
                             width,
                             disable_columns,
                             debug,
+                            explain,
                             term,
                             term,
                             term);
@@ -35,9 +35,13 @@
  *
  *  \param debug            \b true to print debugging information to stdout.
  *                          \todo  Should be handled by the logging subsystem.
+ *
+ *  \param explain          \b true to print, after the results, how long
+ *                          each sub-pattern took and how many of its inputs
+ *                          it matched.
  */
 int cmdline_search(int argc, char *argv[], const char *status_fname,
 		   std::string display_format, std::string width_cfg, std::string sort,
-		   bool disable_columns, bool debug);
+		   bool disable_columns, bool debug, bool explain);
 
 #endif // CMDLINE_SEARCH_H
@@ -0,0 +1,63 @@
+// cmdline_stats.cc
+//
+//   Copyright (C) 2026 Aptitude developers
+
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//   Boston, MA 02110-1301, USA.
+//
+// Print the memory used by each subsystem (debugging tool)
+
+#include "cmdline_stats.h"
+
+#include "cmdline_util.h"
+
+#include <aptitude.h>
+
+#include <generic/apt/apt.h>
+#include <generic/apt/tasks.h>
+#include <generic/util/memory_accounting.h>
+
+#include <apt-pkg/error.h>
+#include <apt-pkg/progress.h>
+
+#include <iostream>
+
+using namespace std;
+
+int cmdline_stats(int argc, char *argv[],
+		  const char *status_fname)
+{
+  if(argc != 1)
+    {
+      _error->Error(_("The stats command takes no arguments"));
+      return -1;
+    }
+
+  aptitude::cmdline::on_apt_errors_print_and_die();
+
+  OpProgress progress;
+  bool operation_needs_lock = false;
+  apt_init(&progress, true, operation_needs_lock, status_fname);
+
+  aptitude::cmdline::on_apt_errors_print_and_die();
+
+  // Tasks are normally loaded on demand; load them so that they show
+  // up in the report.
+  aptitude::apt::load_tasks(progress);
+
+  aptitude::util::write_memory_report(cout);
+
+  return 0;
+}
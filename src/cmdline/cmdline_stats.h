@@ -0,0 +1,30 @@
+// cmdline_stats.h                     -*-c++-*-
+//
+//   Copyright (C) 2026 Aptitude developers
+
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//   Boston, MA 02110-1301, USA.
+
+#ifndef CMDLINE_STATS_H
+#define CMDLINE_STATS_H
+
+/** \file cmdline_stats.h
+ */
+
+/** \brief Load the cache and print the memory used by each subsystem.
+ */
+int cmdline_stats(int argc, char *argv[], const char *status_fname);
+
+#endif
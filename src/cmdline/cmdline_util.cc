@@ -39,6 +39,7 @@
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
+#include <generic/apt/source_index.h>
 #include <generic/apt/tasks.h>
 
 // System includes:
@@ -57,8 +58,11 @@
 #include <sigc++/functors/ptr_fun.h>
 
 #include <algorithm>
+#include <cwchar>
 #include <vector>
 
+#include <limits.h>
+
 namespace cw = cwidget;
 
 using aptitude::cmdline::create_cmdline_download_progress;
@@ -530,36 +534,48 @@ namespace aptitude
       source_package find_source_package(const std::string &source_name,
 					 const std::string &source_version)
       {
-	if(apt_source_list == NULL)
+	const aptitude::apt::source_index *index = aptitude::apt::get_source_index();
+	if(index == NULL)
 	  return NULL;
 
-	pkgSrcRecords records(*apt_source_list);
-	records.Restart();
+	const std::vector<aptitude::apt::source_index::location> *found = index->find(source_name);
+	if(found == NULL)
+	  return NULL;
 
-	pkgSrcRecords::Parser *parser = records.Find(source_name.c_str());
-	while(parser != NULL && parser->Version() != source_version)
-	  parser = records.Find(source_name.c_str());
+	for(std::vector<aptitude::apt::source_index::location>::const_iterator it = found->begin();
+	    it != found->end(); ++it)
+	  {
+	    pkgSrcRecords::Parser *parser = index->lookup(*it);
+	    if(parser != NULL && parser->Version() == source_version)
+	      return parser;
+	  }
 
-	return parser;
+	return NULL;
       }
 
       // Find the most recent source package for the given name.
       source_package find_source_package(const std::string &source_name)
       {
-	if(apt_source_list == NULL)
+	const aptitude::apt::source_index *index = aptitude::apt::get_source_index();
+	if(index == NULL)
 	  return NULL;
 
-	pkgSrcRecords records(*apt_source_list);
-	records.Restart();
+	const std::vector<aptitude::apt::source_index::location> *found = index->find(source_name);
+	if(found == NULL)
+	  return NULL;
 
-	pkgSrcRecords::Parser *parser = records.Find(source_name.c_str());
-	source_package rval = parser;
+	source_package rval;
 
-	while(parser != NULL)
+	for(std::vector<aptitude::apt::source_index::location>::const_iterator it = found->begin();
+	    it != found->end(); ++it)
 	  {
-	    if(_system->VS->CmpVersion(rval.get_version(), parser->Version()) < 0)
+	    pkgSrcRecords::Parser *parser = index->lookup(*it);
+	    if(parser == NULL)
+	      continue;
+
+	    if(!rval.valid() ||
+	       _system->VS->CmpVersion(rval.get_version(), parser->Version()) < 0)
 	      rval = parser;
-	    parser = records.Find(source_name.c_str());
 	  }
 
 	return rval;
@@ -592,38 +608,25 @@ namespace aptitude
     source_package find_source_by_archive(const std::string &source_name,
 					  const std::string &archive)
     {
-      if(apt_source_list == NULL)
+      const aptitude::apt::source_index *index = aptitude::apt::get_source_index();
+      if(index == NULL)
 	return NULL;
 
-      for(pkgSourceList::const_iterator i = apt_source_list->begin();
-	  i != apt_source_list->end(); ++i)
+      const std::vector<aptitude::apt::source_index::location> *found = index->find(source_name);
+      if(found == NULL)
+	return source_package();
+
+      for(std::vector<aptitude::apt::source_index::location>::const_iterator it = found->begin();
+	  it != found->end(); ++it)
 	{
-	  if((*i)->GetDist() != archive)
+	  if(!it->is_source || index->get_dist(*it) != archive)
 	    continue;
 
-	  std::vector<pkgIndexFile *> *indexes = (*i)->GetIndexFiles();
-
-	  for(std::vector<pkgIndexFile *>::const_iterator j = indexes->begin();
-	      j != indexes->end(); ++j)
-	    {
-	      std::unique_ptr<pkgSrcRecords::Parser> p((*j)->CreateSrcParser());
-
-	      if(_error->PendingError())
-		return source_package();
-	      if(p.get() != 0)
-		{
-		  // Step through the file until we reach the end or find
-		  // the package:
-		  while(p.get()->Step() == true)
-		    {
-		      if(_error->PendingError() == true)
-			return source_package();
-
-		      if(p.get()->Package() == source_name)
-			return source_package(p.get());
-		    }
-		}
-	    }
+	  pkgSrcRecords::Parser *parser = index->lookup(*it);
+	  if(_error->PendingError())
+	    return source_package();
+	  if(parser != NULL)
+	    return source_package(parser);
 	}
 
       return source_package();
@@ -763,11 +766,11 @@ namespace aptitude
 	      bool applicable = false;
 	      if(it->get_pattern().valid())
 		{
-		  if(matching::get_match(it->get_pattern(),
-					 pkg,
-					 search_info,
-					 *apt_cache_file,
-					 *apt_package_records).valid())
+		  if(matching::matches(it->get_pattern(),
+				       pkg,
+				       search_info,
+				       *apt_cache_file,
+				       *apt_package_records))
 		    applicable = true;
 		}
 	      else
@@ -833,6 +836,65 @@ namespace aptitude
     }
 
 
+    namespace
+    {
+      /** Lines are accumulated up to this many bytes before being written. */
+      const std::string::size_type line_writer_chunk_size = 64 * 1024;
+    }
+
+    buffered_line_writer::buffered_line_writer(FILE *_out)
+      : out(_out)
+    {
+      buffer.reserve(line_writer_chunk_size + 1024);
+    }
+
+    buffered_line_writer::~buffered_line_writer()
+    {
+      flush();
+    }
+
+    void buffered_line_writer::write_line(const std::wstring &line)
+    {
+      const std::string::size_type start = buffer.size();
+      std::mbstate_t state = std::mbstate_t();
+      char mb[MB_LEN_MAX];
+
+      // Like printf("%ls"), stop at the first null character.
+      for(std::wstring::const_iterator it = line.begin();
+	  it != line.end() && *it != L'\0'; ++it)
+	{
+	  const size_t len = wcrtomb(mb, *it, &state);
+	  if(len == static_cast<size_t>(-1))
+	    {
+	      buffer.resize(start);
+	      return;
+	    }
+
+	  buffer.append(mb, len);
+	}
+
+      // Return to the initial shift state; the count includes the
+      // terminating null byte.
+      const size_t len = wcrtomb(mb, L'\0', &state);
+      if(len != static_cast<size_t>(-1) && len > 1)
+	buffer.append(mb, len - 1);
+
+      buffer += '\n';
+
+      if(buffer.size() >= line_writer_chunk_size)
+	flush();
+    }
+
+    void buffered_line_writer::flush()
+    {
+      if(buffer.empty())
+	return;
+
+      fwrite(buffer.data(), 1, buffer.size(), out);
+      buffer.clear();
+    }
+
+
     std::vector<pkgCache::PkgIterator> get_packages_from_string(const std::string& str)
     {
       std::vector<pkgCache::PkgIterator> pkgs;
@@ -854,19 +916,11 @@ namespace aptitude
 
 	  if (p.valid())
 	    {
-	      std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<structural_match> > > matches;
 	      ref_ptr<search_cache> search_info(search_cache::create());
 	      search(p, search_info,
-		     matches,
+		     pkgs,
 		     *apt_cache_file,
 		     *apt_package_records);
-
-	      for (std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<structural_match>>>::const_iterator
-		     it = matches.begin(); it != matches.end(); ++it)
-		{
-		  const pkgCache::PkgIterator& pkg = it->first;
-		  pkgs.push_back(pkg);
-		}
 	    }
 	}
 
@@ -42,6 +42,8 @@
 #include <memory>
 #include <string>
 
+#include <stdio.h>
+
 /** \file cmdline_util.h
  */
 
@@ -259,6 +261,40 @@ namespace aptitude
 			      cwidget::config::column_generator &columnizer,
 			      cwidget::config::column_parameters &p);
 
+    /** \brief Writes lines of wide text to a stdio stream in large
+     *  chunks.
+     *
+     *  Each line is converted to the multibyte encoding of the
+     *  current locale into a reusable buffer, which is written out
+     *  once it grows large.  The bytes written are the same as with
+     *  printf("%ls\n", line.c_str()) for each line; in particular, a
+     *  line that can't be represented in the locale is dropped
+     *  entirely.
+     *
+     *  Anything else written to the same stream must be preceded by a
+     *  call to flush().
+     */
+    class buffered_line_writer
+    {
+      FILE *out;
+      std::string buffer;
+
+    public:
+      explicit buffered_line_writer(FILE *_out = stdout);
+
+      /** Flushes the pending lines. */
+      ~buffered_line_writer();
+
+      buffered_line_writer(const buffered_line_writer &) = delete;
+      buffered_line_writer &operator=(const buffered_line_writer &) = delete;
+
+      /** Append a line; the newline is added by this method. */
+      void write_line(const std::wstring &line);
+
+      /** Write the pending lines to the stream. */
+      void flush();
+    };
+
     /** \brief Compare pairs according to their first element. */
     class lessthan_1st
     {
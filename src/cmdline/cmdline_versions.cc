@@ -57,6 +57,7 @@
 namespace cw = cwidget;
 namespace m = aptitude::matching;
 
+using aptitude::cmdline::buffered_line_writer;
 using aptitude::cmdline::create_progress_display;
 using aptitude::cmdline::create_search_progress;
 using aptitude::cmdline::create_terminal;
@@ -241,6 +242,8 @@ namespace
                                bool show_package_names,
 			       const std::shared_ptr<terminal_output> &term_output)
   {
+    buffered_line_writer writer;
+
     for(std::vector<std::pair<pkgCache::VerIterator, cw::util::ref_ptr<m::structural_match> > >::const_iterator it = output.begin();
         it != output.end(); ++it)
       {
@@ -255,7 +258,7 @@ namespace
 	  line = aptitude::cmdline::de_columnize(columns, columnizer, *p);
 	else
 	  line = columnizer.layout_columns(width, *p);
-	printf("%ls\n", line.c_str());
+	writer.write_line(line);
       }
   }
 
@@ -36,6 +36,7 @@
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 
+#include <generic/util/dense_id_set.h>
 #include <generic/util/immset.h>
 #include <generic/util/util.h>
 
@@ -599,8 +600,8 @@ namespace aptitude
 
     search_params params;
 
-    // Array of flags indicating which packages have been visited.
-    bool *seen_packages;
+    // The packages that have been visited.
+    aptitude::util::dense_id_set<pkgCache::PkgIterator> seen_packages;
 
     // Used for debug output.
     bool first_iteration;
@@ -633,7 +634,7 @@ namespace aptitude
       : leaves(_leaves),
 	search_info(aptitude::matching::search_cache::create()),
 	params(_params),
-	seen_packages(NULL),
+	seen_packages((*apt_cache_file)->Head().PackageCount),
 	first_iteration(true),
 	verbosity(_verbosity)
     {
@@ -645,18 +646,10 @@ namespace aptitude
       : q(other.q),
 	leaves(other.leaves),
 	params(other.params),
+	seen_packages(other.seen_packages),
 	first_iteration(other.first_iteration),
 	verbosity(other.verbosity)
     {
-      if(other.seen_packages == NULL)
-	seen_packages = NULL;
-      else
-	{
-	  int count = (*apt_cache_file)->Head().PackageCount;
-	  seen_packages = new bool[count];
-	  for(int i = 0; i < count; ++i)
-	    seen_packages[i] = other.seen_packages[i];
-	}
     }
 
     justification_search &operator=(const justification_search &other)
@@ -664,25 +657,12 @@ namespace aptitude
       q = other.q;
       leaves = other.leaves;
       params = other.params;
-      if(other.seen_packages == NULL)
-	seen_packages = NULL;
-      else
-	{
-	  int count = (*apt_cache_file)->Head().PackageCount;
-	  seen_packages = new bool[count];
-	  for(int i = 0; i < count; ++i)
-	    seen_packages[i] = other.seen_packages[i];
-	}
+      seen_packages = other.seen_packages;
       first_iteration = other.first_iteration;
       verbosity = other.verbosity;
       return *this;
     }
 
-    ~justification_search()
-    {
-      delete[] seen_packages;
-    }
-
     /** \brief Compute the next output of this search.
      *
      *  \param output a vector whose contents will be replaced with the
@@ -705,14 +685,6 @@ namespace aptitude
       std::vector<action> tmp;
       bool reached_leaf = false;
 
-      if(seen_packages == NULL)
-	{
-	  int count = (*apt_cache_file)->Head().PackageCount;
-	  seen_packages = new bool[count];
-	  for(int i = 0; i < count; ++i)
-	    seen_packages[i] = false;
-	}
-
       if(first_iteration)
 	{
           if(callbacks_bare != NULL)
@@ -737,14 +709,12 @@ namespace aptitude
 	  // If we visited this package already, skip it.  Otherwise,
 	  // flag it as visited.
 	  pkgCache::PkgIterator frontpkg = front.get_target().get_visited_package();
-	  int frontid = frontpkg->ID;
-	  bool &package_is_seen = seen_packages[frontid];
-	  if(package_is_seen)
+	  if(seen_packages.contains(frontpkg))
 	    continue;
 	  // Don't flag the starting package as "seen", since we want
 	  // to be able to find self-loops.
 	  if(!front.get_actions().empty())
-	    package_is_seen = true;
+	    seen_packages.insert(frontpkg);
 
 	  // If we've stepped at least once, test whether the front
 	  // node is a leaf; if it is, return it and quit.
@@ -759,11 +729,11 @@ namespace aptitude
 	    for(std::vector<ref_ptr<pattern> >::const_iterator it = leaves.begin();
 		!reached_leaf && it != leaves.end(); ++it)
 	      {
-		if(get_match((*it),
-			     frontpkg, frontver,
-			     search_info,
-			     *apt_cache_file,
-			     *apt_package_records).valid())
+		if(matches((*it),
+			   frontpkg, frontver,
+			   search_info,
+			   *apt_cache_file,
+			   *apt_package_records))
 		  reached_leaf = true;
 	      }
 	  if(reached_leaf)
@@ -1198,8 +1168,6 @@ cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves
 {
   using namespace aptitude::why;
 
-  success = true;
-
   std::vector<std::vector<action> > solutions;
   target goal = root_is_removal ? target::Remove(root) : target::Install(root);
 
@@ -1209,6 +1177,21 @@ cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves
                           callbacks,
 			  solutions);
 
+  return render_why(solutions, root, display_mode,
+		    verbosity >= 1, root_is_removal, success);
+}
+
+cw::fragment *render_why(const std::vector<std::vector<aptitude::why::action> > &solutions,
+			 const pkgCache::PkgIterator &root,
+			 aptitude::why::roots_string_mode display_mode,
+			 bool find_all,
+			 bool root_is_removal,
+			 bool &success)
+{
+  using namespace aptitude::why;
+
+  success = true;
+
   if(solutions.empty())
     {
       success = false;
@@ -1251,7 +1234,7 @@ cw::fragment *do_why(const std::vector<cwidget::util::ref_ptr<pattern> > &leaves
 
     }
   else if(display_mode == aptitude::why::no_summary)
-    return render_reason_columns(solutions, verbosity >= 1);
+    return render_reason_columns(solutions, find_all);
   else
     {
       // HACK: drop all chains that include a dependency that's less
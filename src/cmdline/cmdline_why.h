@@ -553,6 +553,20 @@ cwidget::fragment *do_why(const std::vector<cwidget::util::ref_ptr<aptitude::mat
                           const std::shared_ptr<aptitude::why::why_callbacks> &callbacks,
 			  bool &success);
 
+/** \brief Render justifications found by
+ *  aptitude::why::find_best_justification() for the given root, as
+ *  do_why() does.
+ *
+ *  This lets callers run the search and the rendering at different
+ *  times (for instance, the search in a background thread).
+ */
+cwidget::fragment *render_why(const std::vector<std::vector<aptitude::why::action> > &solutions,
+			      const pkgCache::PkgIterator &root,
+			      aptitude::why::roots_string_mode display_mode,
+			      bool find_all,
+			      bool root_is_removal,
+			      bool &success);
+
 // Parses the leaves as if they were command-line arguments.
 cwidget::fragment *do_why(const std::vector<std::string> &arguments,
 			  const std::string &root,
@@ -28,16 +28,20 @@
 #include "aptitude_resolver_universe.h"
 #include "config_file.h"
 #include "config_signal.h"
+#include "config_snapshot.h"
 #include "download_queue.h"
+#include "pkg_file_attributes.h"
 #include "resolver_manager.h"
 #include "rev_dep_iterator.h"
 #include "tags.h"
 #include "tasks.h"
+#include "version_rank.h"
 
 #include <cwidget/generic/util/eassert.h>
 #include <cwidget/generic/util/transcode.h>
 
 #include <generic/util/file_cache.h>
+#include <generic/util/memory_accounting.h>
 #include <generic/util/util.h>
 
 #include <generic/util/undo.h>
@@ -56,13 +60,15 @@
 #include <apt-pkg/sourcelist.h>
 #include <apt-pkg/version.h>
 
+#include <algorithm>
 #include <exception>
 #include <filesystem>
 #include <fstream>
-#include <regex>
 #include <sstream>
+#include <thread>
 
 #include <signal.h>
+#include <stdio.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <errno.h>
@@ -73,12 +79,68 @@ using aptitude::Loggers;
 namespace cw = cwidget;
 namespace fs = std::filesystem;
 
-enum interesting_state {uncached = 0, uninteresting, interesting};
-static interesting_state *cached_deps_interesting = NULL;
+// Tables describing every dependency of the loaded cache, indexed by
+// the ID of the dependency.  They are filled in completely when the
+// cache is loaded (see build_dep_tables()), so that surrounding_or()
+// and is_interesting_dep() are plain lookups afterwards.
+namespace
+{
+  /** A packed array of bits. */
+  class dep_bits
+  {
+    static const unsigned int bits_per_word = sizeof(unsigned long) * 8;
+
+    std::vector<unsigned long> words;
+
+  public:
+    void reset(unsigned long size)
+    {
+      words.assign((size + bits_per_word - 1) / bits_per_word, 0);
+    }
 
-// Memoization of surrounding_or.  To save space, the low bit of each
-// pointer in the following table is set to 1 when a result is cached:
-static pkgCache::Dependency **cached_surrounding_or = NULL;
+    void clear()
+    {
+      std::vector<unsigned long>().swap(words);
+    }
+
+    bool get(unsigned long i) const
+    {
+      return (words[i / bits_per_word] >> (i % bits_per_word)) & 1UL;
+    }
+
+    void set(unsigned long i)
+    {
+      words[i / bits_per_word] |= 1UL << (i % bits_per_word);
+    }
+
+    size_t memory_size() const
+    {
+      return words.capacity() * sizeof(unsigned long);
+    }
+  };
+
+  /** The cache that the tables describe, or \b NULL if they are not
+   *  built.
+   */
+  const pkgCache *dep_tables_cache = NULL;
+
+  /** The index in the cache's dependency array of the first member
+   *  of each dependency's OR group.
+   */
+  std::vector<unsigned int> dep_or_start;
+
+  /** Whether each dependency is interesting when
+   *  APT::Install-Recommends is off, and when it is on.
+   */
+  dep_bits deps_interesting, deps_interesting_with_recommends;
+
+  aptitude::util::memory_account dep_tables_account
+    ("dependency tables",
+     [] { return aptitude::util::memory_usage(dep_or_start.capacity() * sizeof(unsigned int)
+					      + deps_interesting.memory_size()
+					      + deps_interesting_with_recommends.memory_size(),
+					      dep_or_start.size()); });
+}
 
 string *pendingerr=NULL;
 bool erroriswarning=false;
@@ -92,6 +154,7 @@ static Configuration *theme_config;
 static Configuration *user_config;
 
 sigc::signal0<void> cache_closed, cache_reloaded, cache_reload_failed;
+sigc::signal1<void, const std::vector<pkgCache::PkgIterator> &> cache_refreshed;
 sigc::signal0<void> hier_reloaded;
 sigc::signal0<void> consume_errors;
 
@@ -100,17 +163,106 @@ static string apt_native_arch;
 // Access to the download_cache
 std::shared_ptr<aptitude::util::file_cache> download_cache;
 
-
-static void reset_interesting_dep_memoization()
+namespace
 {
-  delete[] cached_deps_interesting;
-  cached_deps_interesting = NULL;
+  /** Identifies one version of the dpkg status file on disk. */
+  struct dpkg_status_stamp
+  {
+    bool valid = false;
+    dev_t dev = 0;
+    ino_t ino = 0;
+    off_t size = 0;
+    time_t mtime_sec = 0;
+    long mtime_nsec = 0;
+
+    bool operator==(const dpkg_status_stamp &other) const
+    {
+      return valid && other.valid
+	&& dev == other.dev && ino == other.ino && size == other.size
+	&& mtime_sec == other.mtime_sec && mtime_nsec == other.mtime_nsec;
+    }
+  };
+
+  dpkg_status_stamp get_dpkg_status_stamp()
+  {
+    dpkg_status_stamp rval;
+
+    const string status_file = _config->FindFile("Dir::State::status");
+    struct stat buf;
+    if(status_file.empty() || stat(status_file.c_str(), &buf) != 0)
+      return rval;
+
+    rval.valid = true;
+    rval.dev = buf.st_dev;
+    rval.ino = buf.st_ino;
+    rval.size = buf.st_size;
+    rval.mtime_sec = buf.st_mtim.tv_sec;
+    rval.mtime_nsec = buf.st_mtim.tv_nsec;
+    return rval;
+  }
+
+  /** The status file that the currently loaded cache was built from. */
+  dpkg_status_stamp loaded_dpkg_status;
+
+  /** The parts of a package that dpkg can change. */
+  struct installed_state
+  {
+    string current_version;
+    unsigned char current_state;
+    unsigned char inst_state;
+
+    bool operator==(const installed_state &other) const
+    {
+      return current_state == other.current_state
+	&& inst_state == other.inst_state
+	&& current_version == other.current_version;
+    }
+
+    bool operator!=(const installed_state &other) const
+    {
+      return !(*this == other);
+    }
+  };
+
+  installed_state get_installed_state(const pkgCache::PkgIterator &pkg)
+  {
+    installed_state rval;
+    pkgCache::VerIterator current = pkg.CurrentVer();
+    if(!current.end())
+      rval.current_version = current.VerStr();
+    rval.current_state = pkg->CurrentState;
+    rval.inst_state = pkg->InstState;
+    return rval;
+  }
+
+  /** \brief Test whether an install run can have changed a package.
+   *
+   *  dpkg only touches the packages that are marked for a change and
+   *  the ones it left half-done in a previous run (e.g., unpacked
+   *  packages or pending triggers, which it processes on every run).
+   */
+  bool may_be_refreshed(aptitudeDepCache &cache, const pkgCache::PkgIterator &pkg)
+  {
+    const pkgDepCache::StateCache &state = cache[pkg];
+    if(state.Mode != pkgDepCache::ModeKeep || (state.iFlags & pkgDepCache::ReInstall) != 0)
+      return true;
+
+    return pkg->InstState != pkgCache::State::Ok
+      || (pkg->CurrentState != pkgCache::State::NotInstalled
+	  && pkg->CurrentState != pkgCache::State::ConfigFiles
+	  && pkg->CurrentState != pkgCache::State::Installed);
+  }
 }
 
-static void reset_surrounding_or_memoization()
+
+static void build_dep_tables(pkgDepCache *cache);
+
+static void clear_dep_tables()
 {
-  delete[] cached_surrounding_or;
-  cached_surrounding_or = NULL;
+  dep_tables_cache = NULL;
+  std::vector<unsigned int>().swap(dep_or_start);
+  deps_interesting.clear();
+  deps_interesting_with_recommends.clear();
 }
 
 bool get_apt_knows_about_rootdir()
@@ -232,6 +384,8 @@ void apt_preinit(const char *rootdir)
 
   aptcfg=new signalling_config(user_config, _config, theme_config);
 
+  aptitude::apt::register_config_snapshot_keys();
+
   // If the user has a Recommends-Important setting and has allowed us
   // to read it by seting Ignore-Recommends-Important to false,
   // migrate it over and then set Ignore-Recommends-Important to true.
@@ -250,12 +404,7 @@ void apt_preinit(const char *rootdir)
       apt_dumpcfg(PACKAGE);
     }
 
-  aptcfg->connect("APT::Install-Recommends",
-		  sigc::ptr_fun(&reset_interesting_dep_memoization));
-
-  cache_closed.connect(sigc::ptr_fun(&reset_interesting_dep_memoization));
-
-  cache_closed.connect(sigc::ptr_fun(&reset_surrounding_or_memoization));
+  cache_closed.connect(sigc::ptr_fun(&clear_dep_tables));
 
   apt_dumpcfg(PACKAGE);
 
@@ -322,12 +471,16 @@ void apt_init(OpProgress *progress_bar, bool do_initselections,
     apt_reload_cache(progress_bar, do_initselections, operation_needs_lock, status_fname);
 }
 
-void apt_close_cache()
+static void close_cache(bool keep_source_list)
 {
   logging::LoggerPtr logger(Loggers::getAptitudeAptGlobals());
 
   LOG_INFO(logger, "Closing apt cache.");
 
+  // Record the peak memory usage of the structures that are about to
+  // be released.
+  aptitude::util::sample_memory_accounts();
+
   cache_closed();
 
   LOG_TRACE(logger, "Done emitting cache_closed().");
@@ -352,6 +505,8 @@ void apt_close_cache()
 
   LOG_TRACE(logger, "Tasks reset.");
 
+  aptitude::apt::clear_version_rank_table();
+
   if(apt_package_records)
     {
       delete apt_package_records;
@@ -370,7 +525,11 @@ void apt_close_cache()
   else
     LOG_TRACE(logger, "No global apt cache file exists; none deleted.");
 
-  if(apt_source_list)
+  loaded_dpkg_status = dpkg_status_stamp();
+
+  if(keep_source_list)
+    LOG_TRACE(logger, "Keeping the apt sources list.");
+  else if(apt_source_list)
     {
       delete apt_source_list;
       apt_source_list=NULL;
@@ -382,6 +541,11 @@ void apt_close_cache()
   LOG_DEBUG(logger, "Done closing the apt cache.");
 }
 
+void apt_close_cache()
+{
+  close_cache(false);
+}
+
 void apt_load_cache(OpProgress *progress_bar, bool do_initselections,
 		    bool operation_needs_lock,
 		    const char * status_fname,
@@ -399,9 +563,18 @@ void apt_load_cache(OpProgress *progress_bar, bool do_initselections,
 
   aptitudeCacheFile *new_file=new aptitudeCacheFile;
 
-  LOG_TRACE(logger, "Reading the sources list.");
-  apt_source_list=new pkgSourceList;
-  apt_source_list->ReadMainList();
+  if(apt_source_list == NULL)
+    {
+      LOG_TRACE(logger, "Reading the sources list.");
+      apt_source_list=new pkgSourceList;
+      apt_source_list->ReadMainList();
+    }
+  else
+    LOG_TRACE(logger, "Reusing the sources list.");
+
+  // Taken before opening, so that changes made while the cache is
+  // being built are noticed by the next refresh.
+  const dpkg_status_stamp status_stamp = get_dpkg_status_stamp();
 
   bool simulate = aptcfg->FindB(PACKAGE "::Simulate", false);
 
@@ -451,6 +624,7 @@ void apt_load_cache(OpProgress *progress_bar, bool do_initselections,
     }
 
   apt_cache_file=new_file;
+  loaded_dpkg_status = status_stamp;
 
   // *If we were loading the global list of states*, dump immediate
   // changes back to it.  This reduces the chance that the user will
@@ -471,6 +645,9 @@ void apt_load_cache(OpProgress *progress_bar, bool do_initselections,
   LOG_TRACE(logger, "Loading the apt package records.");
   apt_package_records=new pkgRecords(*apt_cache_file);
 
+  LOG_TRACE(logger, "Classifying the dependencies.");
+  build_dep_tables(*apt_cache_file);
+
   // Um, good time to clear our undo info.
   apt_undos->clear_items();
 
@@ -629,6 +806,65 @@ void apt_reload_cache(OpProgress *progress_bar, bool do_initselections,
   apt_load_cache(progress_bar, do_initselections, operation_needs_lock, status_fname, false);
 }
 
+bool apt_refresh_cache(OpProgress *progress_bar,
+		       bool operation_needs_lock,
+		       bool reset_reinstall)
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeAptGlobals());
+
+  if(apt_cache_file == NULL)
+    {
+      apt_load_cache(progress_bar, true, operation_needs_lock, NULL, reset_reinstall);
+      return true;
+    }
+
+  // Resetting the reinstall flags needs the cache to be reinitialized
+  // (and dpkg always rewrites the status file when it succeeds).
+  if(!reset_reinstall && get_dpkg_status_stamp() == loaded_dpkg_status)
+    {
+      LOG_INFO(logger, "The dpkg status file is unchanged; not reloading the apt cache.");
+      return false;
+    }
+
+  LOG_INFO(logger, "Refreshing the apt cache.");
+
+  // Remember what dpkg could have changed, keyed by the full name of
+  // each package since its ID might differ in the new cache.
+  std::vector<std::pair<string, installed_state> > old_states;
+  for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin(); !pkg.end(); ++pkg)
+    if(may_be_refreshed(**apt_cache_file, pkg))
+      old_states.push_back(std::make_pair(pkg.FullName(false), get_installed_state(pkg)));
+
+  close_cache(true);
+  apt_load_cache(progress_bar, true, operation_needs_lock, NULL, reset_reinstall);
+
+  if(apt_cache_file == NULL)
+    return true;
+
+  std::vector<pkgCache::PkgIterator> changed;
+  std::size_t vanished = 0;
+  for(std::vector<std::pair<string, installed_state> >::const_iterator
+	it = old_states.begin(); it != old_states.end(); ++it)
+    {
+      const pkgCache::PkgIterator pkg = (*apt_cache_file)->FindPkg(it->first);
+
+      // Purged packages that are not available from any source are
+      // dropped from the cache.
+      if(pkg.end())
+	++vanished;
+      else if(get_installed_state(pkg) != it->second)
+	changed.push_back(pkg);
+    }
+
+  LOG_DEBUG(logger, "Emitting cache_refreshed() with " << changed.size()
+	    << " changed packages (" << vanished
+	    << " packages no longer in the cache).");
+  cache_refreshed(changed);
+  LOG_TRACE(logger, "Done emitting cache_refreshed().");
+
+  return true;
+}
+
 void apt_shutdown()
 {
   aptitude::shutdown_download_queue();
@@ -636,6 +872,13 @@ void apt_shutdown()
 
   apt_close_cache();
 
+  if(aptcfg && aptcfg->FindB(PACKAGE "::Memory-Stats-At-Exit", false))
+    {
+      std::ostringstream report;
+      aptitude::util::write_memory_report(report);
+      fputs(report.str().c_str(), stderr);
+    }
+
   delete aptcfg;
   aptcfg = NULL;
 
@@ -788,36 +1031,19 @@ void surrounding_or(pkgCache::DepIterator dep,
   if(cache == NULL)
     cache = *apt_cache_file;
 
-  if(cached_surrounding_or == NULL)
+  if(cache != dep_tables_cache)
     {
-      cached_surrounding_or = new pkgCache::Dependency *[cache->Head().DependsCount];
-      for(unsigned long i = 0; i<cache->Head().DependsCount; ++i)
-	cached_surrounding_or[i] = 0;
+      surrounding_or_internal(dep, start, end);
+      return;
     }
 
-  pkgCache::Dependency *s = cached_surrounding_or[dep->ID];
-
-  // Use the old trick of stuffing values into the low bits of a
-  // pointer.
-  if(((unsigned long) s & 0x1) != 0)
-    {
-      pkgCache::Dependency *unmunged
-	= (pkgCache::Dependency *) (((unsigned long) s) & ~0x1UL);
-
-      start = pkgCache::DepIterator(*cache, unmunged);
-      end = start;
+  start = pkgCache::DepIterator(*cache, cache->DepP + dep_or_start[dep->ID]);
+  end = start;
 
-      while(end->CompareOp & pkgCache::Dep::Or)
-	++end;
+  while(end->CompareOp & pkgCache::Dep::Or)
+    ++end;
 
-      ++end;
-    }
-  else
-    {
-      surrounding_or_internal(dep, start, end);
-
-      cached_surrounding_or[dep->ID] = (pkgCache::Dependency *) ((unsigned long) ((pkgCache::Dependency *) start) | 0x1UL);
-    }
+  ++end;
 }
 
 bool package_suggested(const pkgCache::PkgIterator &pkg)
@@ -918,15 +1144,11 @@ bool package_recommended(const pkgCache::PkgIterator &pkg)
 
 bool package_trusted(const pkgCache::VerIterator &ver)
 {
+  const aptitude::apt::pkg_file_table &files = (*apt_cache_file)->get_pkg_file_table();
+
   for(pkgCache::VerFileIterator i = ver.FileList(); !i.end(); ++i)
     {
-      pkgIndexFile *index;
-
-      if(!apt_source_list->FindIndex(i.File(), index))
-	// Corresponds to the currently installed package, which is
-	// always "trusted".
-	return true;
-      else if(index->IsTrusted())
+      if(files.get(i.File()).trusted)
 	return true;
     }
 
@@ -1253,21 +1475,17 @@ static bool or_group_subsumes(const pkgCache::DepIterator &d1,
  */
 bool is_security(const pkgCache::VerIterator &ver)
 {
-  static std::regex site_regex { "^security\\.(.+\\.)?debian.org$" };
-  std::smatch site_match;
+  return is_security(ver, (*apt_cache_file)->get_pkg_file_table());
+}
 
+bool is_security(const pkgCache::VerIterator &ver,
+		 const aptitude::apt::pkg_file_table &files)
+{
   for (pkgCache::VerFileIterator F = ver.FileList(); !F.end(); ++F)
     {
       pkgCache::PkgFileIterator fileit = F.File();
-      if (!fileit.end())
-	{
-	  string site  = fileit.Site()  ? fileit.Site()  : "";
-	  string label = fileit.Label() ? fileit.Label() : "";
-	  std::regex_search(site, site_match, site_regex);
-
-	  if (!site_match.empty() && label == "Debian-Security")
-	    return true;
-	}
+      if (!fileit.end() && files.get(fileit).security)
+	return true;
     }
 
   return false;
@@ -1280,7 +1498,8 @@ bool is_security(const pkgCache::VerIterator &ver)
 //   - All recommendations that are unrelated under subsumption to
 //     each recommendation of the current package version.
 static bool internal_is_interesting_dep(const pkgCache::DepIterator &d,
-					pkgDepCache *cache)
+					pkgDepCache *cache,
+					bool install_recommends)
 {
   pkgCache::PkgIterator parpkg = const_cast<pkgCache::DepIterator &>(d).ParentPkg();
   pkgCache::VerIterator currver = parpkg.CurrentVer();
@@ -1291,8 +1510,7 @@ static bool internal_is_interesting_dep(const pkgCache::DepIterator &d,
     return false;
   else if(const_cast<pkgCache::DepIterator &>(d).IsCritical())
     return true;
-  else if(d->Type != pkgCache::Dep::Recommends ||
-	  !aptcfg->FindB("APT::Install-Recommends", true))
+  else if(d->Type != pkgCache::Dep::Recommends || !install_recommends)
     return false;
   else
     {
@@ -1355,34 +1573,236 @@ static bool internal_is_interesting_dep(const pkgCache::DepIterator &d,
 bool is_interesting_dep(const pkgCache::DepIterator &d,
 			pkgDepCache *cache)
 {
-  if(cached_deps_interesting == NULL)
+  const bool install_recommends =
+    aptitude::apt::get_config_snapshot()->install_recommends;
+
+  if(&cache->GetCache() != dep_tables_cache)
     {
-      cached_deps_interesting = new interesting_state[cache->Head().DependsCount];
-      for(unsigned long i = 0; i<cache->Head().DependsCount; ++i)
-	cached_deps_interesting[i] = uncached;
+      pkgCache::DepIterator start, end;
+      surrounding_or(d, start, end, &cache->GetCache());
+
+      return internal_is_interesting_dep(start, cache, install_recommends);
     }
 
-  switch(cached_deps_interesting[d->ID])
-    {
-    case uncached:
-      {
-	pkgCache::DepIterator start, end;
-	surrounding_or(d, start, end, &cache->GetCache());
+  if(install_recommends)
+    return deps_interesting_with_recommends.get(d->ID);
+  else
+    return deps_interesting.get(d->ID);
+}
 
-	bool rval = internal_is_interesting_dep(start, cache);
+// Work out the classification of the OR group starting at start from
+// the definition of interesting dependencies above, independently of
+// internal_is_interesting_dep(), so that check_dep_tables() tests the
+// classification and not only the way it is stored.
+//
+// Recommendations of a version other than the installed one depend
+// on the subsumption test, which has no simpler statement; "known" is
+// set to false for them.
+static bool expected_interesting_dep(const pkgCache::DepIterator &start,
+				     pkgDepCache *cache,
+				     bool install_recommends,
+				     bool &known)
+{
+  pkgCache::DepIterator d = start;
+  pkgCache::PkgIterator parpkg = d.ParentPkg();
+  pkgCache::VerIterator parver = d.ParentVer();
+  pkgCache::VerIterator currver = parpkg.CurrentVer();
 
-	cached_deps_interesting[d->ID] = rval ? interesting : uninteresting;
-	return rval;
-      }
-    case interesting:
+  known = true;
+
+  // The resolver drops versions that can't be installed any more.
+  const bool installable = parver.Downloadable() ||
+    (parver == currver && parpkg->CurrentState != pkgCache::State::ConfigFiles);
+
+  if(!installable)
+    return false;
+
+  switch(d->Type)
+    {
+    case pkgCache::Dep::PreDepends:
+    case pkgCache::Dep::Depends:
+    case pkgCache::Dep::Conflicts:
+    case pkgCache::Dep::DpkgBreaks:
+    case pkgCache::Dep::Obsoletes:
       return true;
-    case uninteresting:
-      return false;
+
+    case pkgCache::Dep::Recommends:
+      break;
+
     default:
-      abort();
+      return false;
+    }
+
+  if(!install_recommends)
+    return false;
+  else if(currver.end())
+    return true;
+  else if(parver == currver)
+    {
+      pkgCache::DepIterator last = start;
+      while(!last.end() && (last->CompareOp & pkgCache::Dep::Or) != 0)
+	++last;
+
+      return ((*cache)[last] & pkgDepCache::DepGNow) != 0;
+    }
+  else
+    {
+      known = false;
+      return false;
     }
 }
 
+bool dep_tables_describe(pkgDepCache *cache)
+{
+  return &cache->GetCache() == dep_tables_cache;
+}
+
+unsigned long check_dep_tables(const pkgCache::PkgIterator &pkg,
+			       pkgDepCache *cache,
+			       std::ostream &out)
+{
+  if(!dep_tables_describe(cache))
+    return 0;
+
+  unsigned long errors = 0;
+  for(pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver)
+    {
+      pkgCache::DepIterator d = ver.DependsList();
+      while(!d.end())
+	{
+	  const pkgCache::DepIterator start = d;
+	  bool known, known_with_recommends;
+	  const bool interesting = expected_interesting_dep(start, cache, false, known);
+	  const bool interesting_with_recommends =
+	    expected_interesting_dep(start, cache, true, known_with_recommends);
+
+	  bool more;
+	  do
+	    {
+	      if(dep_or_start[d->ID] != start.Index())
+		{
+		  out << "The OR group of the dependency " << ver.ParentPkg().FullName(false)
+		      << " " << ver.VerStr() << " " << d.DepType() << " " << d.TargetPkg().FullName(false)
+		      << " starts at dependency " << dep_or_start[d->ID]
+		      << " in the tables, but at " << start.Index() << " in the cache." << std::endl;
+		  ++errors;
+		}
+
+	      // Every member of a group is classified like its first
+	      // dependency.
+	      if(deps_interesting.get(d->ID) != deps_interesting.get(start->ID) ||
+		 deps_interesting_with_recommends.get(d->ID) != deps_interesting_with_recommends.get(start->ID) ||
+		 (known && deps_interesting.get(d->ID) != interesting) ||
+		 (known_with_recommends &&
+		  deps_interesting_with_recommends.get(d->ID) != interesting_with_recommends))
+		{
+		  out << "The dependency " << ver.ParentPkg().FullName(false)
+		      << " " << ver.VerStr() << " " << d.DepType() << " " << d.TargetPkg().FullName(false)
+		      << " is misclassified as "
+		      << (deps_interesting.get(d->ID) ? "" : "un") << "interesting ("
+		      << (deps_interesting_with_recommends.get(d->ID) ? "" : "un") << "interesting with recommends)."
+		      << std::endl;
+		  ++errors;
+		}
+
+	      more = (d->CompareOp & pkgCache::Dep::Or) != 0;
+	      ++d;
+	    } while(more && !d.end());
+	}
+    }
+
+  return errors;
+}
+
+static void build_dep_tables(pkgDepCache *cache)
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeAptGlobals());
+
+  clear_dep_tables();
+
+  pkgCache &pkg_cache = cache->GetCache();
+  const unsigned long num_deps = pkg_cache.Head().DependsCount;
+
+  // Find the OR groups first: the classification below looks them
+  // up through surrounding_or().
+  std::vector<pkgCache::Dependency *> or_groups;
+  dep_or_start.resize(num_deps);
+  for(pkgCache::PkgIterator pkg = pkg_cache.PkgBegin(); !pkg.end(); ++pkg)
+    for(pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver)
+      {
+	pkgCache::DepIterator d = ver.DependsList();
+	while(!d.end())
+	  {
+	    const pkgCache::DepIterator start = d;
+	    or_groups.push_back(start);
+
+	    bool more;
+	    do
+	      {
+		dep_or_start[d->ID] = start.Index();
+		more = (d->CompareOp & pkgCache::Dep::Or) != 0;
+		++d;
+	      } while(more && !d.end());
+	  }
+      }
+
+  dep_tables_cache = &pkg_cache;
+
+  // Classify each OR group for both settings of
+  // APT::Install-Recommends, so that changing it doesn't invalidate
+  // anything.  This only reads the cache, so the groups are split
+  // between several threads.
+  enum { interesting_without_recommends = 1, interesting_with_recommends = 2 };
+  std::vector<unsigned char> classes(or_groups.size());
+
+  const auto classify = [&](size_t begin, size_t end)
+    {
+      for(size_t i = begin; i < end; ++i)
+	{
+	  const pkgCache::DepIterator start(pkg_cache, or_groups[i]);
+	  classes[i] =
+	    (internal_is_interesting_dep(start, cache, false) ? interesting_without_recommends : 0) |
+	    (internal_is_interesting_dep(start, cache, true) ? interesting_with_recommends : 0);
+	}
+    };
+
+  const unsigned int num_threads =
+    std::max(1U, std::min(std::thread::hardware_concurrency(), 8U));
+  const size_t chunk_size = (or_groups.size() + num_threads - 1) / num_threads;
+
+  std::vector<std::thread> workers;
+  for(size_t begin = chunk_size; begin < or_groups.size(); begin += chunk_size)
+    workers.push_back(std::thread(classify, begin,
+				  std::min(begin + chunk_size, or_groups.size())));
+  classify(0, std::min(chunk_size, or_groups.size()));
+  for(std::thread &worker : workers)
+    worker.join();
+
+  deps_interesting.reset(num_deps);
+  deps_interesting_with_recommends.reset(num_deps);
+  for(size_t i = 0; i < or_groups.size(); ++i)
+    {
+      if(classes[i] == 0)
+	continue;
+
+      pkgCache::DepIterator d(pkg_cache, or_groups[i]);
+      bool more;
+      do
+	{
+	  if(classes[i] & interesting_without_recommends)
+	    deps_interesting.set(d->ID);
+	  if(classes[i] & interesting_with_recommends)
+	    deps_interesting_with_recommends.set(d->ID);
+	  more = (d->CompareOp & pkgCache::Dep::Or) != 0;
+	  ++d;
+	} while(more && !d.end());
+    }
+
+  LOG_DEBUG(logger, "Classified " << num_deps << " dependencies in "
+	    << or_groups.size() << " OR groups using "
+	    << (workers.size() + 1) << " threads.");
+}
+
 std::string get_uri(const pkgCache::VerIterator& ver,
 		    const pkgRecords* records)
 {
@@ -27,6 +27,7 @@
 
 #include <string.h>
 
+#include <iosfwd>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -127,6 +128,39 @@ void apt_reload_cache(OpProgress *progress_bar,
 // a background thread, but I need to know more about various bits of apt
 // first.
 
+/** \brief Bring the cache up to date after dpkg has run.
+ *
+ *  This is the counterpart of apt_reload_cache() for the end of an
+ *  install run, where only the dpkg status file can have changed:
+ *
+ *   - if the status file is exactly the one that was read when the
+ *     cache was last loaded (e.g., dpkg failed before touching it),
+ *     the cache is left alone and no signal is emitted;
+ *
+ *   - otherwise the cache is closed and reopened, reusing the parsed
+ *     sources list (apt itself reuses the source package cache, so
+ *     only the status file is merged again), and cache_refreshed is
+ *     emitted after cache_reloaded with the packages whose installed
+ *     state changed.  Only the packages that the run could have
+ *     touched are compared.
+ *
+ *  The package cache is an immutable memory map, so the current
+ *  versions can't be patched in place: anyone holding iterators still
+ *  receives cache_closed and cache_reloaded.
+ *
+ *  \param progress_bar a progress bar with which to display the
+ *                      status of loading the cache.
+ *  \param operation_needs_lock whether to lock the cache.
+ *  \param reset_reinstall Reset packages set for reinstall (do this
+ *                         after successful installation only).
+ *
+ *  \return \b false if the cache was left alone, in which case it
+ *  still holds the selections made before the run.
+ */
+bool apt_refresh_cache(OpProgress *progress_bar,
+		       bool operation_needs_lock,
+		       bool reset_reinstall);
+
 extern sigc::signal0<void> cache_closed;
 // Announces when the cache is (or is about to be) closed.
 // This means that anyone using it should immediately drop references to it.
@@ -137,6 +171,12 @@ extern sigc::signal0<void> cache_reloaded;
 extern sigc::signal0<void> cache_reload_failed;
 // Announces that reloading the cache failed.
 
+/** Emitted by apt_refresh_cache() after cache_reloaded, with the
+ *  packages whose current version, current state or install state
+ *  differ from the ones before dpkg ran.
+ */
+extern sigc::signal1<void, const std::vector<pkgCache::PkgIterator> &> cache_refreshed;
+
 /** Called when the UI should display and remove all pending errors
  *  from the queue.  It is incumbent on the UI to remove errors on its
  *  own after calling APT routines -- this just indicates that some
@@ -414,6 +454,16 @@ struct location_compare
  */
 bool is_security(const pkgCache::VerIterator &ver);
 
+/** Whether a particular version is security-related, according to the
+ * given table of package files
+ *
+ * Unlike is_security(const pkgCache::VerIterator &), this does not
+ * consult the global cache, so background threads can use it with the
+ * table of the cache that they are reading.
+ */
+bool is_security(const pkgCache::VerIterator &ver,
+		 const aptitude::apt::pkg_file_table &files);
+
 
 /** \return \b true if the given dependency is "interesting":
  *          specifically, if it's either critical or a Recommends
@@ -426,6 +476,37 @@ bool is_security(const pkgCache::VerIterator &ver);
 bool is_interesting_dep(const pkgCache::DepIterator &d,
 			pkgDepCache *cache);
 
+/** \return \b true if the precomputed tables behind surrounding_or()
+ *  and is_interesting_dep() were built for the given cache.
+ */
+bool dep_tables_describe(pkgDepCache *cache);
+
+/** Compare the precomputed tables behind surrounding_or() and
+ *  is_interesting_dep() with a direct walk of the dependencies of
+ *  each version of a package.
+ *
+ *  The OR groups are compared with the dependency lists of the
+ *  cache.  The classification is compared with the rules that define
+ *  interesting dependencies, except for the recommendations of a
+ *  version other than the installed one, whose classification
+ *  depends on the subsumption test; those are only checked for
+ *  consistency within their OR group.
+ *
+ *  This only reads the cache and the tables, so it may be called for
+ *  different packages from several threads at once.  It does nothing
+ *  if the tables don't describe the cache; check that once with
+ *  dep_tables_describe() before checking the packages.
+ *
+ *  \param pkg the package whose dependencies should be checked.
+ *  \param cache the cache that the tables should describe.
+ *  \param out a stream to which each mismatch is written, one per line.
+ *
+ *  \return the number of mismatches found.
+ */
+unsigned long check_dep_tables(const pkgCache::PkgIterator &pkg,
+			       pkgDepCache *cache,
+			       std::ostream &out);
+
 /** \return an int representing an architecture's position within the
  *          system's prefered order.  Smaller values indicate greater
  *          preference.
@@ -27,11 +27,13 @@
 #include "aptitude_resolver_universe.h"
 #include "aptitudepolicy.h"
 #include "config_signal.h"
+#include "config_snapshot.h"
 #include "dpkg_selections.h"
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 #include <generic/problemresolver/solution.h>
+#include <generic/util/dense_id_set.h>
 #include <generic/util/undo.h>
 
 #include <apt-pkg/error.h>
@@ -46,6 +48,7 @@
 #include <apt-pkg/progress.h>
 #include <apt-pkg/version.h>
 
+#include <atomic>
 #include <vector>
 
 #include <unistd.h>
@@ -101,7 +104,7 @@ public:
   {
     aptitudeDepCache::action_group group(*owner);
 
-    owner->pre_package_state_changed();
+    owner->signal_pre_package_state_changed();
 
     if(prev_iflags&ReInstall)
       owner->internal_mark_install(pkg, false, true);
@@ -174,9 +177,12 @@ public:
 
   void undo()
   {
-    owner->pre_package_state_changed();
+    // The change is announced when the group ends, so that an
+    // enclosing group (such as the one of apt_undo_group) announces
+    // all of its changes at once.
+    aptitudeDepCache::action_group group(*owner);
+
     owner->set_candidate_version(oldver, NULL);
-    owner->package_state_changed();
   }
 };
 
@@ -196,11 +202,34 @@ aptitudeDepCache::action_group::~action_group()
   cache.end_action_group(group);
 }
 
-aptitudeDepCache::aptitudeDepCache(pkgCache *Cache, Policy *Plcy)
+namespace
+{
+  /** \brief The identifier of the next aptitudeDepCache to be created. */
+  std::atomic<unsigned long> next_cache_instance(0);
+}
+
+aptitudeDepCache::aptitudeDepCache(pkgCache *Cache, Policy *Plcy, pkgSourceList *sources)
   :pkgDepCache(Cache, Plcy), dirty(false), read_only(true),
    package_states(NULL), lock(-1), group_level(0),
-   new_package_count(0), records(NULL)
+   pre_change_signalled(false),
+   new_package_count(0), records(NULL),
+   pkg_files(*Cache, sources),
+   package_states_account("package states",
+			  [this] { return get_package_states_memory(); }),
+   user_tags_account("user tags",
+		     [this] { return get_user_tags_memory(); }),
+   snapshot_records(*Cache),
+   cache_instance(next_cache_instance++), state_generation(0)
 {
+  // Any snapshot taken while a change is in progress is stale by
+  // the time that the change is announced.
+  pre_package_state_changed.connect(sigc::mem_fun(*this, &aptitudeDepCache::invalidate_state_snapshot));
+  package_state_changed.connect(sigc::mem_fun(*this, &aptitudeDepCache::invalidate_state_snapshot));
+
+  // Listeners start over when a change is announced, even in the
+  // middle of a group, so the next change must be signalled again.
+  package_state_changed.connect(sigc::mem_fun(*this, &aptitudeDepCache::reset_pre_change_signalled));
+
   // When the "install recommended packages" flag changes, collect garbage.
 #if 0
   aptcfg->connect("APT::Install-Recommends",
@@ -235,6 +264,58 @@ aptitudeDepCache::~aptitudeDepCache()
     close(lock);
 }
 
+aptitude::util::memory_usage aptitudeDepCache::get_package_states_memory()
+{
+  using aptitude::util::string_heap_bytes;
+
+  aptitude::util::memory_usage rval;
+  if(package_states == NULL)
+    return rval;
+
+  const unsigned long count = Head().PackageCount;
+  rval.objects = count;
+  rval.bytes = count * sizeof(aptitude_state);
+  for(unsigned long i = 0; i < count; ++i)
+    {
+      const aptitude_state &state = package_states[i];
+      rval.bytes += string_heap_bytes(state.candver);
+      rval.bytes += string_heap_bytes(state.forbidver);
+      // The sets of user tags are accounted as user tags.
+    }
+
+  return rval;
+}
+
+aptitude::util::memory_usage aptitudeDepCache::get_user_tags_memory()
+{
+  using aptitude::util::node_container_bytes;
+  using aptitude::util::string_heap_bytes;
+
+  aptitude::util::memory_usage rval;
+
+  // The distinct tags, stored once in the collection and once as the
+  // keys of its index.
+  rval.bytes += user_tags.user_tags.capacity() * sizeof(std::string);
+  for(const std::string &tag : user_tags.user_tags)
+    rval.bytes += 2 * string_heap_bytes(tag);
+  rval.bytes += node_container_bytes<std::pair<const std::string, user_tag_reference> >(user_tags.user_tags_index.size());
+  rval.objects += user_tags.user_tags.size();
+
+  // The references attached to each package.
+  if(package_states != NULL)
+    {
+      const unsigned long count = Head().PackageCount;
+      for(unsigned long i = 0; i < count; ++i)
+	{
+	  const std::set<user_tag>::size_type attached = package_states[i].user_tags.size();
+	  rval.bytes += node_container_bytes<user_tag>(attached);
+	  rval.objects += attached;
+	}
+    }
+
+  return rval;
+}
+
 void aptitudeDepCache::set_read_only(bool new_read_only)
 {
   read_only = new_read_only;
@@ -541,7 +622,7 @@ bool aptitudeDepCache::build_selection_list(OpProgress* Prog,
 
   new_package_count=0;
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   // Act on them
   for(pkgCache::PkgIterator i=PkgBegin(); !i.end(); i++)
@@ -661,7 +742,7 @@ void aptitudeDepCache::mark_all_upgradable(bool with_autoinst,
       return;
     }
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   action_group group(*this, undo);
 
@@ -689,7 +770,7 @@ void aptitudeDepCache::mark_all_upgradable(bool with_autoinst,
       for(std::set<pkgCache::PkgIterator>::const_iterator it =
 	    to_upgrade.begin(); it != to_upgrade.end(); ++it)
 	{
-	  pre_package_state_changed();
+	  signal_pre_package_state_changed();
 	  dirty = true;
 
 	  internal_mark_install(*it, do_autoinstall, false);
@@ -1141,7 +1222,7 @@ void aptitudeDepCache::cleanup_after_change(undo_group *undo,
 	  // but I think they should be left in for safety's sake.
 	  // Forgetting to call pre_package_state_changed can lead to
 	  // hard to track down bugs like #432411.
-	  pre_package_state_changed();
+	  signal_pre_package_state_changed();
 
 	  if(alter_stickies &&
 	     PkgState[pkg->ID].Mode!=backup_state.PkgState[pkg->ID].Mode &&
@@ -1217,7 +1298,7 @@ void aptitudeDepCache::mark_install(const PkgIterator &Pkg,
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   internal_mark_install(Pkg, AutoInst, ReInstall);
 }
@@ -1280,7 +1361,7 @@ void aptitudeDepCache::mark_delete(const PkgIterator &Pkg,
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   internal_mark_delete(Pkg, Purge, unused_delete);
 }
@@ -1310,7 +1391,8 @@ void aptitudeDepCache::internal_mark_delete(const PkgIterator &Pkg,
   // honour ::Purge-Unused in the main entry point for removing packages, it
   // should catch cases of automatically installed and unused packages not
   // purged (#724034 and others)
-  bool purge_unused = aptcfg->FindB(PACKAGE "::Purge-Unused", false);
+  const std::shared_ptr<const aptitude::apt::config_snapshot> cfg(aptitude::apt::get_config_snapshot());
+  bool purge_unused = cfg->purge_unused;
   if (unused_delete && purge_unused)
     {
       Purge = true;
@@ -1345,7 +1427,7 @@ void aptitudeDepCache::internal_mark_delete(const PkgIterator &Pkg,
   // mark for delete depends which seem safe to remove, because they are
   // automatically installed and don't have other remaining rdeps.
 
-  if (!aptcfg->FindB(PACKAGE "::Delete-Unused", true))
+  if (!cfg->delete_unused)
     return;
 
   if (Pkg.CurrentVer().end())
@@ -1371,15 +1453,15 @@ void aptitudeDepCache::internal_mark_delete(const PkgIterator &Pkg,
   unused_delete = true;
 
   // not to purge unused lightly, can cause data loss -- see comments in #661188
-  Purge = aptcfg->FindB(PACKAGE "::Purge-Unused", false);
+  Purge = cfg->purge_unused;
 
   bool keep_recommends_installed =
-    aptcfg->FindB("APT::Install-Recommends", true)
-    || aptcfg->FindB("APT::AutoRemove::RecommendsImportant", true)
-    || aptcfg->FindB(PACKAGE "::Keep-Recommends", false);
+    cfg->install_recommends
+    || cfg->autoremove_recommends_important
+    || cfg->keep_recommends;
   bool keep_suggests_installed   =
-    aptcfg->FindB("APT::AutoRemove::SuggestsImportant", true)
-    || aptcfg->FindB(PACKAGE "::Keep-Suggests", false);
+    cfg->autoremove_suggests_important
+    || cfg->keep_suggests;
 
   for (pkgCache::DepIterator dep = Pkg.CurrentVer().DependsList(); !dep.end(); ++dep)
     {
@@ -1468,7 +1550,7 @@ void aptitudeDepCache::mark_keep(const PkgIterator &Pkg, bool Automatic, bool Se
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   internal_mark_keep(Pkg, Automatic, SetHold);
 }
@@ -1531,7 +1613,7 @@ void aptitudeDepCache::set_candidate_version(const VerIterator &ver,
       (ver == ver.ParentPkg().CurrentVer() &&
        ver.ParentPkg()->CurrentState != pkgCache::State::ConfigFiles)))
     {
-      pre_package_state_changed();
+      signal_pre_package_state_changed();
 
 
       // Make the package manually installed if it was being
@@ -1592,7 +1674,7 @@ void aptitudeDepCache::forbid_upgrade(const PkgIterator &pkg,
     {
       action_group group(*this, undo);
 
-      pre_package_state_changed();
+      signal_pre_package_state_changed();
 
       pkgCache::VerIterator candver=(*this)[pkg].CandidateVerIter(*this);
 
@@ -1615,7 +1697,7 @@ void aptitudeDepCache::mark_single_install(const PkgIterator &Pkg, undo_group *u
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
   dirty=true;
 
   for(PkgIterator i=PkgBegin(); !i.end(); i++)
@@ -1649,7 +1731,7 @@ void aptitudeDepCache::mark_auto_installed(const PkgIterator &Pkg,
     {
       action_group group(*this, undo);
 
-      pre_package_state_changed();
+      signal_pre_package_state_changed();
       dirty=true;
 
       MarkAuto(Pkg, set_auto);
@@ -1736,6 +1818,7 @@ bool aptitudeDepCache::attach_user_tag(const PkgIterator &pkg,
       if (insert_result.second)
 	{
 	  dirty = true;
+	  invalidate_state_snapshot();
 	  if (undo != NULL)
 	    undo->add_item(new attach_user_tag_undoer(this, pkg, tag));
 
@@ -1778,6 +1861,7 @@ bool aptitudeDepCache::detach_user_tag(const PkgIterator &pkg,
       if (num_erased > 0)
 	{
 	  dirty = true;
+	  invalidate_state_snapshot();
 	  if(undo != NULL)
 	    undo->add_item(new detach_user_tag_undoer(this, pkg, tag));
 
@@ -1823,7 +1907,7 @@ bool aptitudeDepCache::all_upgrade(bool with_autoinst, undo_group *undo)
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   pkgProblemResolver fixer(this);
 
@@ -1856,7 +1940,7 @@ bool aptitudeDepCache::try_fix_broken(pkgProblemResolver &fixer, undo_group *und
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
   dirty=true;
   bool founderr=false;
   if(!fixer.Resolve(true))
@@ -1878,7 +1962,7 @@ bool aptitudeDepCache::try_fix_broken(undo_group *undo)
     }
 
   pkgProblemResolver fixer(this);
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
   for(pkgCache::PkgIterator i=PkgBegin(); !i.end(); i++)
     {
       fixer.Clear(i);
@@ -1986,10 +2070,12 @@ void aptitudeDepCache::duplicate_cache(apt_state_snapshot *target)
 // Helpers for aptitudeDepCache::sweep().
 namespace
 {
+  typedef aptitude::util::dense_id_set<pkgCache::PkgIterator> pkg_id_set;
+
   // Remove reverse dependencies of the given version from the set of
   // reinstated packages.  All the packages in the set are assumed to
   // be installed at their current version when checking dependencies.
-  void remove_reverse_current_versions(std::set<pkgCache::PkgIterator> &reinstated,
+  void remove_reverse_current_versions(pkg_id_set &reinstated,
 				       pkgCache::VerIterator bad_ver)
   {
     logging::LoggerPtr logger(Loggers::getAptitudeAptCache());
@@ -2005,7 +2091,7 @@ namespace
 	  continue;
 
 	// Skip packages that aren't in the reinstate set.
-	if(reinstated.find(dep.ParentPkg()) == reinstated.end())
+	if(!reinstated.contains(dep.ParentPkg()))
 	  continue;
 
 	if((dep->Type == pkgCache::Dep::Depends ||
@@ -2036,7 +2122,7 @@ namespace
 	    continue;
 
 	  // Skip packages that aren't in the reinstate set.
-	  if(reinstated.find(dep.ParentPkg()) == reinstated.end())
+	  if(!reinstated.contains(dep.ParentPkg()))
 	    continue;
 
 	  if((dep->Type == pkgCache::Dep::Depends ||
@@ -2064,13 +2150,13 @@ namespace
   // "reinstated" to the not-orphaned set.  (the condition on
   // reinstated is so we don't pick the wrong branch of an OR)
   void trace_not_orphaned(const pkgCache::PkgIterator &notOrphan,
-			  const std::set<pkgCache::PkgIterator> &reinstated,
+			  const pkg_id_set &reinstated,
 			  pkgDepCache &cache,
-			  std::set<pkgCache::PkgIterator> &not_orphaned)
+			  pkg_id_set &not_orphaned)
   {
     logging::LoggerPtr logger(Loggers::getAptitudeAptCache());
 
-    if(not_orphaned.find(notOrphan) != not_orphaned.end())
+    if(not_orphaned.contains(notOrphan))
       {
 	LOG_TRACE(logger, "Ignoring " << notOrphan.FullName(false)
 		  << ": it was already visited.");
@@ -2088,7 +2174,7 @@ namespace
 	return;
       }
 
-    if(reinstated.find(notOrphan) == reinstated.end())
+    if(!reinstated.contains(notOrphan))
       {
 	LOG_DEBUG(logger, "Treating the package "
 		  << notOrphan.FullName(false)
@@ -2143,9 +2229,9 @@ namespace
   // because any strong dependencies on stuff that was thrown out
   // would also have been thrown out.
   void find_not_orphaned(const pkgCache::PkgIterator &maybeOrphan,
-			 const std::set<pkgCache::PkgIterator> &reinstated,
+			 const pkg_id_set &reinstated,
 			 pkgDepCache &cache,
-			 std::set<pkgCache::PkgIterator> &not_orphaned)
+			 pkg_id_set &not_orphaned)
   {
     logging::LoggerPtr logger(Loggers::getAptitudeAptCache());
 
@@ -2212,7 +2298,9 @@ namespace
 
 void aptitudeDepCache::sweep()
 {
-  if(!aptcfg->FindB(PACKAGE "::Delete-Unused", true))
+  const std::shared_ptr<const aptitude::apt::config_snapshot> cfg(aptitude::apt::get_config_snapshot());
+
+  if(!cfg->delete_unused)
     return;
 
   logging::LoggerPtr logger(Loggers::getAptitudeAptCache());
@@ -2227,14 +2315,14 @@ void aptitudeDepCache::sweep()
   // being installed by this solution!
   //
   // See Debian bugs #522881 and #524667.
-  std::set<pkgCache::PkgIterator> reinstated, reinstated_bad;
+  pkg_id_set reinstated(Head().PackageCount), reinstated_bad(Head().PackageCount);
 
   // Suppress intermediate removals.
   //
   // \todo this may cause problems if we do undo tracking via ActionGroups.
   pkgDepCache::ActionGroup group(*this);
 
-  bool purge_unused = aptcfg->FindB(PACKAGE "::Purge-Unused", false);
+  bool purge_unused = cfg->purge_unused;
 
   for(pkgCache::PkgIterator pkg = PkgBegin(); !pkg.end(); ++pkg)
     {
@@ -2252,7 +2340,7 @@ void aptitudeDepCache::sweep()
 		{
 		  LOG_DEBUG(logger, "aptitudeDepCache::sweep(): Removing " << pkg.FullName(false) << ": it is unused.");
 
-		  pre_package_state_changed();
+		  signal_pre_package_state_changed();
 		  MarkDelete(pkg, purge_unused);
 		  package_states[pkg->ID].selection_state =
 		    (purge_unused ? pkgCache::State::Purge : pkgCache::State::DeInstall);
@@ -2270,7 +2358,7 @@ void aptitudeDepCache::sweep()
 		}
 	      else
 		package_states[pkg->ID].selection_state = pkgCache::State::Install;
-	      pre_package_state_changed();
+	      signal_pre_package_state_changed();
 
 	      if(!PkgState[pkg->ID].Keep())
 		LOG_DEBUG(logger, "aptitudeDepCache::sweep(): Cancelling the installation of " << pkg.FullName(false) << ": it is unused.");
@@ -2300,15 +2388,20 @@ void aptitudeDepCache::sweep()
 	}
     }
 
+  LOG_DEBUG(logger, "aptitudeDepCache::sweep(): " << reinstated.size()
+	    << " packages provisionally reinstated and " << reinstated_bad.size()
+	    << " conflicting, in sets of "
+	    << (reinstated.memory_size() + reinstated_bad.memory_size()) << " bytes.");
+
   // Remove packages that transitively depend on a package in
   // reinstated_bad from reinstated.
-  for(std::set<pkgCache::PkgIterator>::const_iterator it =
+  for(pkg_id_set::const_iterator it =
 	reinstated_bad.begin(); it != reinstated_bad.end(); ++it)
     remove_reverse_current_versions(reinstated, it->CurrentVer());
 
   // Figure out which reinstated packages aren't orphaned.
-  std::set<pkgCache::PkgIterator> not_orphaned;
-  for(std::set<pkgCache::PkgIterator>::const_iterator it =
+  pkg_id_set not_orphaned(Head().PackageCount);
+  for(pkg_id_set::const_iterator it =
 	reinstated.begin(); it != reinstated.end(); ++it)
     find_not_orphaned(*it,
 		      reinstated,
@@ -2316,7 +2409,7 @@ void aptitudeDepCache::sweep()
 		      not_orphaned);
 
   // The ones that survived should be reinstated:
-  for(std::set<pkgCache::PkgIterator>::const_iterator it =
+  for(pkg_id_set::const_iterator it =
 	not_orphaned.begin(); it != not_orphaned.end(); ++it)
     {
       pkgCache::PkgIterator pkg(*it);
@@ -2326,8 +2419,33 @@ void aptitudeDepCache::sweep()
     }
 }
 
+void aptitudeDepCache::signal_pre_package_state_changed()
+{
+  if(group_level == 0 || !pre_change_signalled)
+    {
+      pre_change_signalled = group_level > 0;
+      pre_package_state_changed();
+    }
+  else
+    {
+      // Listeners were already told in this group; just make sure
+      // that nobody reads a snapshot taken in the meantime.
+      ++pending_group_stats.merged_signals;
+      invalidate_state_snapshot();
+    }
+}
+
+void aptitudeDepCache::reset_pre_change_signalled()
+{
+  pre_change_signalled = false;
+}
+
 void aptitudeDepCache::begin_action_group()
 {
+  if(group_level == 0)
+    pending_group_stats = action_group_stats();
+
+  ++pending_group_stats.groups;
   group_level++;
 }
 
@@ -2344,6 +2462,7 @@ void aptitudeDepCache::end_action_group(undo_group *undo)
 	  if(group_level == 0)
 	    read_only_fail();
 
+	  pre_change_signalled = false;
 	  group_level--;
 	  return;
 	}
@@ -2354,6 +2473,17 @@ void aptitudeDepCache::end_action_group(undo_group *undo)
 
       duplicate_cache(&backup_state);
 
+      pre_change_signalled = false;
+      pending_group_stats.changed_packages = changed_packages.size();
+      last_group_stats = pending_group_stats;
+
+      LOG_DEBUG(Loggers::getAptitudeAptCache(),
+		"Ending an action group: merged " << last_group_stats.groups
+		<< " nested groups into one sweep and "
+		<< last_group_stats.merged_signals + 1
+		<< " state change notifications into one; "
+		<< last_group_stats.changed_packages << " packages changed.");
+
       package_state_changed();
       package_states_changed(&changed_packages);
     }
@@ -2378,6 +2508,12 @@ void aptitudeDepCache::restore_apt_state(const apt_state_snapshot *snapshot)
       return;
     }
 
+  action_group group(*this, NULL);
+
+  signal_pre_package_state_changed();
+
+  dirty=true;
+
   memcpy(PkgState, snapshot->PkgState, sizeof(StateCache)*Head().PackageCount);
   memcpy(DepState, snapshot->DepState, sizeof(char)*Head().DependsCount);
   // memcpy doesn't work here because the aptitude_state structure
@@ -2393,6 +2529,39 @@ void aptitudeDepCache::restore_apt_state(const apt_state_snapshot *snapshot)
   iKeepCount=snapshot->iKeepCount;
   iBrokenCount=snapshot->iBrokenCount;
   iBadCount=snapshot->iBadCount;
+
+  invalidate_state_snapshot();
+}
+
+void aptitudeDepCache::invalidate_state_snapshot()
+{
+  ++state_generation;
+  current_snapshot.reset();
+}
+
+std::shared_ptr<const aptitudeDepCache::state_snapshot> aptitudeDepCache::get_state_snapshot()
+{
+  if(!current_snapshot)
+    {
+      apt_state_snapshot *state = new apt_state_snapshot;
+      duplicate_cache(state);
+
+      current_snapshot.reset(new state_snapshot(state, &GetCache(), &pkg_files,
+						&snapshot_records, state_generation));
+    }
+
+  return current_snapshot;
+}
+
+pkgRecords &aptitudeDepCache::thread_records::get()
+{
+  std::lock_guard<std::mutex> l(mutex);
+
+  std::unique_ptr<pkgRecords> &rval(records[std::this_thread::get_id()]);
+  if(!rval)
+    rval.reset(new pkgRecords(cache));
+
+  return *rval;
 }
 
 void aptitudeDepCache::apply_solution(const generic_solution<aptitude_universe> &realSol,
@@ -2418,7 +2587,7 @@ void aptitudeDepCache::apply_solution(const generic_solution<aptitude_universe>
 
   action_group group(*this, undo);
 
-  pre_package_state_changed();
+  signal_pre_package_state_changed();
 
   // Build a list of all the resolver versions that are to be
   // installed: versions selected in the solution as well as the
@@ -2569,7 +2738,7 @@ bool aptitudeCacheFile::Open(OpProgress* Progress,
     return false;
 
   {
-    DCache=new aptitudeDepCache(Cache, Policy);
+    DCache=new aptitudeDepCache(Cache, Policy, &List);
     if (_error->PendingError())
       {
 	_error->Error(_("Could not create dependency cache"));
@@ -2624,16 +2793,20 @@ bool aptitudeDepCache::is_held(const PkgIterator &pkg)
 
 bool aptitudeDepCache::MarkFollowsRecommends()
 {
+  const std::shared_ptr<const aptitude::apt::config_snapshot> cfg(aptitude::apt::get_config_snapshot());
+
   return pkgDepCache::MarkFollowsRecommends() ||
-    aptcfg->FindB("APT::Install-Recommends", true) ||
-    aptcfg->FindB(PACKAGE "::Keep-Recommends", false);
+    cfg->install_recommends ||
+    cfg->keep_recommends;
 }
 
 bool aptitudeDepCache::MarkFollowsSuggests()
 {
+  const std::shared_ptr<const aptitude::apt::config_snapshot> cfg(aptitude::apt::get_config_snapshot());
+
   return pkgDepCache::MarkFollowsSuggests() ||
-    aptcfg->FindB(PACKAGE "::Keep-Suggests", false) ||
-    aptcfg->FindB(PACKAGE "::Suggests-Important", false);
+    cfg->keep_suggests ||
+    cfg->suggests_important;
 }
 
 class AptitudeInRootSetFunc : public pkgDepCache::InRootSetFunc
@@ -2686,7 +2859,7 @@ public:
   bool InRootSet(const pkgCache::PkgIterator &pkg)
   {
     pkgRecords &records(cache.get_records());
-    if(p.valid() && aptitude::matching::get_match(p, pkg, search_info, cache, records).valid())
+    if(p.valid() && aptitude::matching::matches(p, pkg, search_info, cache, records))
       return true;
     else
       return chain != NULL && chain->InRootSet(pkg);
@@ -2762,7 +2935,7 @@ bool aptitudeDepCache::IsDeleteOk(const pkgCache::PkgIterator &pkg,
     // resolution; allow it.
     return true;
 
-  if(!aptcfg->FindB(PACKAGE "::Auto-Install-Remove-Ok", false))
+  if(!aptitude::apt::get_config_snapshot()->auto_install_remove_ok)
     return false;
   else
     {
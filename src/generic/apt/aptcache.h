@@ -23,8 +23,11 @@
 
 #include <config.h>
 
+#include "pkg_file_attributes.h"
 #include "usertags.h"
 
+#include <generic/util/memory_accounting.h>
+
 #include <cwidget/generic/util/bool_accumulate.h>
 
 #include <apt-pkg/depcache.h>
@@ -35,7 +38,10 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <vector>
 
 
@@ -56,6 +62,7 @@
 class undoable;
 class undo_group;
 class pkgProblemResolver;
+class pkgSourceList;
 class aptitude_universe;
 template<typename PackageUniverse> class generic_solution;
 
@@ -152,7 +159,18 @@ public:
     bool flagged:1;
   };
 
-  /** \brief Represents a group of aptitude actions. */
+  /** \brief Represents a group of aptitude actions.
+   *
+   *  Groups nest: until the outermost group is destroyed, the
+   *  garbage collector doesn't run, changed packages are not looked
+   *  for, pre_package_state_changed is emitted at most once, and
+   *  neither package_state_changed nor package_states_changed is
+   *  emitted.  All of this happens once, when the outermost group
+   *  ends, and only the undo group of the outermost group receives
+   *  the undo items; the undo groups of nested groups are ignored.
+   *  Bulk operations should therefore wrap all of their changes in a
+   *  single group.
+   */
   class action_group
   {
     /** The parent group.  This is a member and not a parent class so
@@ -177,6 +195,31 @@ public:
     ~action_group();
   };
 
+  /** \brief Counts of the work that an outermost action group put
+   *  off until it ended.
+   */
+  struct action_group_stats
+  {
+    /** \brief The number of groups that were opened, including the
+     *  outermost one; each would have run the garbage collector and
+     *  looked for changed packages on its own.
+     */
+    unsigned int groups;
+
+    /** \brief The number of times that pre_package_state_changed
+     *  would have been emitted again.
+     */
+    unsigned int merged_signals;
+
+    /** \brief The number of packages whose visible state changed. */
+    std::size_t changed_packages;
+
+    action_group_stats()
+      : groups(0), merged_signals(0), changed_packages(0)
+    {
+    }
+  };
+
   /** This flag is \b true iff the persistent state has changed (ie, we
    *  need to save the cache).
    */
@@ -198,6 +241,8 @@ public:
   class candver_undoer;
   friend class candver_undoer;
 
+  class state_snapshot;
+
   /** This class "remembers" the current cache state, and is used to
    *  perform post facto analysis of the decisions libapt makes.
    *  (thus enabling the "undo" function)
@@ -227,6 +272,117 @@ public:
     }
 
     friend class aptitudeDepCache;
+    friend class state_snapshot;
+  };
+
+  /** \brief Package records for the threads that read state
+   *  snapshots, one reader per thread.
+   *
+   *  Each depcache owns one of these, so the readers (and the index
+   *  files that they keep open) are freed with the cache that they
+   *  were built on.
+   */
+  class thread_records
+  {
+    pkgCache &cache;
+
+    std::mutex mutex;
+    std::map<std::thread::id, std::unique_ptr<pkgRecords> > records;
+
+  public:
+    explicit thread_records(pkgCache &_cache)
+      : cache(_cache)
+    {
+    }
+
+    thread_records(const thread_records &) = delete;
+    thread_records &operator=(const thread_records &) = delete;
+
+    /** \brief Get the reader of the calling thread, creating it the
+     *  first time that the thread asks for one.
+     */
+    pkgRecords &get();
+  };
+
+  /** \brief An immutable copy of the package states at one point in
+   *  time, which background threads can read while the main thread
+   *  keeps modifying the live cache.
+   *
+   *  Snapshots are created by get_state_snapshot() in the main
+   *  thread and shared through std::shared_ptr; a thread that holds
+   *  one sees the same states for as long as it holds it.  The
+   *  snapshot refers to the underlying pkgCache, so like any other
+   *  background reader its users must stop using it when the cache
+   *  is closed (see README.THREADS).
+   */
+  class state_snapshot
+  {
+    std::unique_ptr<const apt_state_snapshot> state;
+    pkgCache *cache;
+    const aptitude::apt::pkg_file_table *pkg_files;
+    thread_records *records;
+    unsigned long generation;
+
+    state_snapshot(const apt_state_snapshot *_state,
+		   pkgCache *_cache,
+		   const aptitude::apt::pkg_file_table *_pkg_files,
+		   thread_records *_records,
+		   unsigned long _generation)
+      : state(_state), cache(_cache), pkg_files(_pkg_files),
+	records(_records), generation(_generation)
+    {
+    }
+
+    friend class aptitudeDepCache;
+
+  public:
+    /** \brief Get the install state of a package. */
+    const StateCache &operator[](const PkgIterator &pkg) const
+    {
+      return state->PkgState[pkg->ID];
+    }
+
+    /** \brief Get the state flags (DepInstall, DepCVer...) of a
+     *  dependency.
+     */
+    unsigned char operator[](const DepIterator &dep) const
+    {
+      return state->DepState[dep->ID];
+    }
+
+    /** \brief Get the aptitude-specific state of a package. */
+    const aptitude_state &get_ext_state(const PkgIterator &pkg) const
+    {
+      return state->AptitudeState[pkg->ID];
+    }
+
+    pkgCache &get_cache() const { return *cache; }
+
+    /** \brief Get the attributes of the package files of the cache. */
+    const aptitude::apt::pkg_file_table &get_pkg_file_table() const { return *pkg_files; }
+
+    /** \brief Get the number of the modification of the cache that
+     *  this snapshot reflects; later snapshots of the same cache
+     *  have higher numbers.
+     */
+    unsigned long get_generation() const { return generation; }
+
+    signed long long get_usr_size() const { return state->iUsrSize; }
+    unsigned long long get_download_size() const { return state->iDownloadSize; }
+    unsigned long get_inst_count() const { return state->iInstCount; }
+    unsigned long get_del_count() const { return state->iDelCount; }
+    unsigned long get_keep_count() const { return state->iKeepCount; }
+    unsigned long get_broken_count() const { return state->iBrokenCount; }
+
+    /** \brief Get package records that the calling thread can use.
+     *
+     *  pkgRecords keeps the current file and record of each index
+     *  open, so it can't be shared between threads; this returns a
+     *  reader that belongs to the calling thread, creating it the
+     *  first time that the thread asks for one for this cache.  The
+     *  reader is freed along with the cache.
+     */
+    pkgRecords &get_records() const { return records->get(); }
   };
 
 private:
@@ -238,6 +394,17 @@ private:
   // The current 'group level' -- how many times start_action_group has been
   // called without a matching end_action_group.
 
+  /** \b true if pre_package_state_changed was emitted in the current
+   *  outermost action group.
+   */
+  bool pre_change_signalled;
+
+  /** What the current outermost action group has put off so far. */
+  action_group_stats pending_group_stats;
+
+  /** What the last outermost action group to end put off. */
+  action_group_stats last_group_stats;
+
   /** The number of "new" packages. */
   int new_package_count;
 
@@ -246,6 +413,39 @@ private:
 
   pkgRecords *records;
 
+  /** The attributes of the package files of this cache. */
+  const aptitude::apt::pkg_file_table pkg_files;
+
+  /** Memory accounts for package_states and user_tags.
+   *
+   *  The parsers of pkgRecords are private to apt and hold most of
+   *  its memory, so the records are not accounted for.
+   */
+  aptitude::util::memory_account package_states_account;
+  aptitude::util::memory_account user_tags_account;
+
+  /** The package records of the threads that read snapshots of this
+   *  cache.
+   */
+  thread_records snapshot_records;
+
+  /** Identifies this cache among every cache created by the
+   *  process, so that information computed from one cache is not
+   *  mistaken for information about a reloaded one.
+   */
+  unsigned long cache_instance;
+
+  /** Incremented every time that the package states change. */
+  unsigned long state_generation;
+
+  /** The most recent snapshot, if it is still current. */
+  std::shared_ptr<const state_snapshot> current_snapshot;
+
+  void invalidate_state_snapshot();
+
+  aptitude::util::memory_usage get_package_states_memory();
+  aptitude::util::memory_usage get_user_tags_memory();
+
   undoable *state_restorer(PkgIterator pkg, StateCache &state, aptitude_state &ext_state);
   // Returns an 'undoable' object which will restore the given package to the
   // given state via {Mark,Set}* routines
@@ -297,12 +497,25 @@ private:
   void sweep();
   void begin_action_group();
   void end_action_group(undo_group *undo);
+
+  /** Emit pre_package_state_changed, unless it was already emitted in
+   *  the current outermost action group.
+   */
+  void signal_pre_package_state_changed();
+
+  /** Let the next change in the current group emit
+   *  pre_package_state_changed again.
+   */
+  void reset_pre_change_signalled();
 public:
   /** Create a new depcache from the given cache and policy.  By
    *  default, the depcache is readonly if and only if it is not
    *  locked.
+   *
+   *  The source list is used to determine which package files are
+   *  trusted; if it is \b NULL, every file is considered trusted.
    */
-  aptitudeDepCache(pkgCache *cache, Policy *Plcy=0);
+  aptitudeDepCache(pkgCache *cache, Policy *Plcy=0, pkgSourceList *sources=0);
 
   bool Init(OpProgress *Prog, bool WithLock,
 	    bool do_initselections,
@@ -313,8 +526,32 @@ public:
 
   bool is_dirty() const { return dirty; }
 
+  /** \return What the last outermost action group to end put off
+   *  until it ended.
+   */
+  const action_group_stats &get_last_action_group_stats() const { return last_group_stats; }
+
+  /** \return A number that changes every time the package states
+   *  change; see state_snapshot::get_generation().
+   */
+  unsigned long get_state_generation() const { return state_generation; }
+
+  /** \return A number that identifies this cache among every cache
+   *  created by the process, so that information computed from one
+   *  cache is not mistaken for information about a reloaded one.
+   */
+  unsigned long get_cache_instance() const { return cache_instance; }
+
   pkgRecords &get_records() { return *records; }
 
+  /** \return The attributes of the package files of this cache.
+   *
+   *  The table is built when the cache is created, so it is
+   *  available while the cache is initialized (for instance to
+   *  evaluate Keep-Unused-Pattern), and it is never modified.
+   */
+  const aptitude::apt::pkg_file_table &get_pkg_file_table() const { return pkg_files; }
+
   // If do_initselections is "false", the "sticky states" will not be used
   // to initialize packages.  (important for the command-line mode)
   bool build_selection_list(OpProgress* Prog,
@@ -494,7 +731,15 @@ public:
   // Aptitude states is included); this is meant to be used to implement undo,
   // detection of "wtf happened??" after the problem resolver runs, etc.
   void restore_apt_state(const apt_state_snapshot *snapshot);
-  // Restores the *APT* cache to the given state.
+  // Restores the *APT* cache to the given state, announcing it like any
+  // other change.
+
+  /** \brief Get an immutable snapshot of the current package states.
+   *
+   *  Must be called from the main thread.  Consecutive calls return
+   *  the same snapshot until the states change.
+   */
+  std::shared_ptr<const state_snapshot> get_state_snapshot();
 
   /** This signal is emitted *before* any package's install state is
    *  changed.  It may be emitted more than once per state change; if
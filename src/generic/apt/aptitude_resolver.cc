@@ -21,6 +21,7 @@
 #include "aptitude_resolver.h"
 
 #include "config_signal.h"
+#include "config_snapshot.h"
 
 #include <apt-pkg/algorithms.h>
 #include <apt-pkg/error.h>
@@ -761,7 +762,7 @@ aptitude_resolver::aptitude_resolver(int step_score,
 	}
     }
 
-  bool discardNullSolution = aptcfg->FindB(PACKAGE "::ProblemResolver::Discard-Null-Solution", false);
+  bool discardNullSolution = aptitude::apt::get_config_snapshot()->discard_null_solution;
   if(keep_all_solution.size() > 0)
     {
       if(discardNullSolution)
@@ -1325,7 +1326,7 @@ void aptitude_resolver::add_action_scores(int preserve_score, int auto_score,
                   break;
                 }
 
-	      using aptitude::matching::get_match;
+	      using aptitude::matching::matches;
 
 	      // Check the version selection.  This is quicker than
 	      // the target test, so we do it first.
@@ -1335,16 +1336,16 @@ void aptitude_resolver::add_action_scores(int preserve_score, int auto_score,
 	      // Now check the target.
 	      if(apt_ver.end())
 		{
-		  if(!get_match(h.get_target(), p.get_pkg(),
-				search_info, *cache,
-				records).valid())
+		  if(!matches(h.get_target(), p.get_pkg(),
+			      search_info, *cache,
+			      records))
 		    continue;
 		}
 	      else
 		{
-		  if(!get_match(h.get_target(), p.get_pkg(), v.get_ver(),
-				search_info, *cache,
-				records).valid())
+		  if(!matches(h.get_target(), p.get_pkg(), v.get_ver(),
+			      search_info, *cache,
+			      records))
 		    continue;
 		}
 
@@ -477,8 +477,10 @@ namespace aptitude
 
 	  // Note that we don't re-cache the digested
 	  // changelog if it was retrieved from the cache
-	  // earlier (i.e., if job->get_digested() is true).
-	  if(digested.valid() && !job->get_digested())
+	  // earlier (i.e., if job->get_digested() is true), or if
+	  // there is nothing to key it on.
+	  if(digested.valid() && !job->get_digested() &&
+	     !job->get_source_package().empty())
 	    {
 	      LOG_TRACE(get_log_category(),
 			"Caching digested changelog as " << changelog_uri);
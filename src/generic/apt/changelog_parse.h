@@ -269,7 +269,9 @@ namespace aptitude
      *  \param to   The last version to parse, or an empty string
      *              to parse until the end of the changelog.
      *  \param source_package The name of the source package whose
-     *                        changelog is being parsed.
+     *                        changelog is being parsed, or an empty
+     *                        string if the parsed changelog should
+     *                        not be stored in the download cache.
      *  \param digested       True if the changelog was already
      *                        digested.
      *  \param post_thunk     A function that should be used to post
@@ -0,0 +1,134 @@
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+#include "config_snapshot.h"
+
+#include "apt.h"
+#include "config_signal.h"
+
+#include <aptitude.h>
+#include <loggers.h>
+
+#include <sigc++/functors/ptr_fun.h>
+
+#include <memory>
+
+using aptitude::Loggers;
+
+
+namespace aptitude {
+namespace apt {
+
+
+namespace {
+
+/** A registered boolean option: key, default and field of the snapshot */
+struct bool_option
+{
+  const char *key;
+  bool default_value;
+  bool config_snapshot::*field;
+};
+
+const bool_option bool_options[] =
+  {
+    { PACKAGE "::Delete-Unused", true, &config_snapshot::delete_unused },
+    { PACKAGE "::Purge-Unused", false, &config_snapshot::purge_unused },
+    { PACKAGE "::Auto-Install", true, &config_snapshot::auto_install },
+    { PACKAGE "::Auto-Install-Remove-Ok", false, &config_snapshot::auto_install_remove_ok },
+    { "APT::Install-Recommends", true, &config_snapshot::install_recommends },
+    { "APT::AutoRemove::RecommendsImportant", true, &config_snapshot::autoremove_recommends_important },
+    { "APT::AutoRemove::SuggestsImportant", true, &config_snapshot::autoremove_suggests_important },
+    { PACKAGE "::Keep-Recommends", false, &config_snapshot::keep_recommends },
+    { PACKAGE "::Keep-Suggests", false, &config_snapshot::keep_suggests },
+    { PACKAGE "::Suggests-Important", false, &config_snapshot::suggests_important },
+    { PACKAGE "::UI::New-Package-Commands", true, &config_snapshot::new_package_commands },
+    { PACKAGE "::ProblemResolver::Discard-Null-Solution", false, &config_snapshot::discard_null_solution },
+  };
+
+/** The current snapshot; only accessed with std::atomic_load() and
+ * std::atomic_store(), and only replaced from the main thread
+ */
+std::shared_ptr<const config_snapshot> snapshot;
+
+/** The configuration object that the keys are registered with */
+signalling_config *snapshot_source = nullptr;
+
+/** The snapshot used before the keys have been registered */
+std::shared_ptr<const config_snapshot> make_default_snapshot()
+{
+  std::shared_ptr<config_snapshot> rval(std::make_shared<config_snapshot>());
+
+  for (const bool_option& opt : bool_options)
+    (*rval).*(opt.field) = opt.default_value;
+
+  rval->generation = 0;
+
+  return rval;
+}
+
+void rebuild_snapshot()
+{
+  // aptcfg might be gone already while shutting down
+  if (aptcfg == nullptr || aptcfg != snapshot_source)
+    return;
+
+  std::shared_ptr<config_snapshot> rebuilt(std::make_shared<config_snapshot>());
+
+  for (const bool_option& opt : bool_options)
+    (*rebuilt).*(opt.field) = aptcfg->FindB(opt.key, opt.default_value);
+
+  const std::shared_ptr<const config_snapshot> old(std::atomic_load(&snapshot));
+  rebuilt->generation = old == nullptr ? 1 : old->generation + 1;
+
+  std::atomic_store(&snapshot, std::shared_ptr<const config_snapshot>(rebuilt));
+
+  LOG_TRACE(Loggers::getAptitudeAptGlobals(),
+	    "Rebuilt the configuration snapshot (generation " << rebuilt->generation << ")");
+}
+
+}
+
+
+void register_config_snapshot_keys()
+{
+  snapshot_source = aptcfg;
+
+  for (const bool_option& opt : bool_options)
+    aptcfg->connect(opt.key, sigc::ptr_fun(&rebuild_snapshot));
+
+  // values might come from the theme, so that changing it can change them
+  aptcfg->connect(PACKAGE "::Theme", sigc::ptr_fun(&rebuild_snapshot));
+
+  rebuild_snapshot();
+}
+
+std::shared_ptr<const config_snapshot> get_config_snapshot()
+{
+  std::shared_ptr<const config_snapshot> rval(std::atomic_load(&snapshot));
+  if (rval != nullptr)
+    return rval;
+
+  static const std::shared_ptr<const config_snapshot> default_snapshot(make_default_snapshot());
+  return default_snapshot;
+}
+
+}
+}
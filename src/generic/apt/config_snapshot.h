@@ -0,0 +1,111 @@
+// config_snapshot.h                       -*-c++-*-
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+/** @file
+ *
+ * Pre-resolved, typed values of configuration options that are read
+ * on hot paths.
+ *
+ */
+
+#ifndef APTITUDE_GENERIC_APT_CONFIG_SNAPSHOT_H
+#define APTITUDE_GENERIC_APT_CONFIG_SNAPSHOT_H
+
+#include <memory>
+
+namespace aptitude {
+namespace apt {
+
+
+/** Typed snapshot of the configuration options consulted per package
+ * or per step
+ *
+ * signalling_config::FindB() and friends concatenate the theme root,
+ * check Exists() and walk apt's Configuration tree on every call.  Code
+ * that runs once per package (sweep(), marking, the resolver setup)
+ * should read the fields of this structure instead.
+ *
+ * Each field is registered with its configuration key and default
+ * value in config_snapshot.cc; a new snapshot is built whenever
+ * signalling_config emits a change for one of those keys (which also
+ * happens when the whole configuration is replaced with setcfg()), or
+ * when the theme changes.
+ *
+ * Snapshots are never modified once they are published: a rebuild
+ * replaces the current snapshot atomically, so background threads
+ * (the resolver, the "why" search) can keep reading the one that they
+ * obtained while the main thread changes the configuration.
+ */
+struct config_snapshot
+{
+  /** PACKAGE::Delete-Unused */
+  bool delete_unused;
+  /** PACKAGE::Purge-Unused */
+  bool purge_unused;
+  /** PACKAGE::Auto-Install */
+  bool auto_install;
+  /** PACKAGE::Auto-Install-Remove-Ok */
+  bool auto_install_remove_ok;
+  /** APT::Install-Recommends */
+  bool install_recommends;
+  /** APT::AutoRemove::RecommendsImportant */
+  bool autoremove_recommends_important;
+  /** APT::AutoRemove::SuggestsImportant */
+  bool autoremove_suggests_important;
+  /** PACKAGE::Keep-Recommends */
+  bool keep_recommends;
+  /** PACKAGE::Keep-Suggests */
+  bool keep_suggests;
+  /** PACKAGE::Suggests-Important */
+  bool suggests_important;
+  /** PACKAGE::UI::New-Package-Commands */
+  bool new_package_commands;
+  /** PACKAGE::ProblemResolver::Discard-Null-Solution */
+  bool discard_null_solution;
+
+  /** Incremented each time that the snapshot is rebuilt */
+  unsigned long generation;
+};
+
+
+/** Register the keys of the snapshot with aptcfg and build it
+ *
+ * Must be called from the main thread each time that aptcfg is
+ * created; apt_preinit() does so.
+ */
+void register_config_snapshot_keys();
+
+/** Get the current snapshot of the configuration
+ *
+ * This may be called from any thread.  Until
+ * register_config_snapshot_keys() has been called, the snapshot holds
+ * the default value of each option.
+ *
+ * @return The snapshot; it stays valid (and unchanged) for as long as
+ * the caller holds it, even if the configuration changes meanwhile
+ */
+std::shared_ptr<const config_snapshot> get_config_snapshot();
+
+
+}
+}
+
+#endif
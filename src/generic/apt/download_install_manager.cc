@@ -29,32 +29,410 @@
 #include <generic/apt/apt.h>
 
 #include <apt-pkg/acquire-item.h>
+#include <apt-pkg/configuration.h>
 #include <apt-pkg/dpkgpm.h>
 #include <apt-pkg/error.h>
+#include <apt-pkg/fileutl.h>
 #include <apt-pkg/install-progress.h>
 #include <apt-pkg/sourcelist.h>
 #include <apt-pkg/pkgsystem.h>
 
 #include <sigc++/bind.h>
 
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
 #include <pthread.h>
 #include <signal.h>
 
 using namespace std;
 
+namespace
+{
+  /** A dpkg package manager whose archive file names can be read and
+   *  filled in from the outside.
+   */
+  class pipelined_dpkg_pm : public pkgDPkgPM
+  {
+  public:
+    explicit pipelined_dpkg_pm(pkgDepCache *cache)
+      : pkgDPkgPM(cache)
+    {
+    }
+
+    const string &get_file_name(const pkgCache::PkgIterator &pkg) const
+    {
+      return FileNames[pkg->ID];
+    }
+
+    void set_file_name(const pkgCache::PkgIterator &pkg,
+		       const string &file_name)
+    {
+      FileNames[pkg->ID] = file_name;
+    }
+
+    /** \return \b true if the last DoInstallPreFork() queued any
+     *  work for dpkg.
+     */
+    bool has_pending_actions() const
+    {
+      return !List.empty();
+    }
+  };
+}
+
+/** \brief Downloads the archives in a background thread and hands
+ *  them over to dpkg as they arrive.
+ *
+ *  pkgPackageManager::DoInstall() orders the packages whose archive
+ *  is missing after all the others, installs everything up to the
+ *  first of them and returns Incomplete; this is what apt uses to
+ *  swap media, and it splits the ordering into dependency-closed
+ *  batches.  The archives are queued on the fetcher by one package
+ *  manager, whose file names are written by the download thread; a
+ *  second package manager, which runs dpkg, only learns about the
+ *  archives once they are complete.
+ *
+ *  As soon as a download or a dpkg run fails, the pipeline stops
+ *  handing archives over: the install waits for the rest of the
+ *  download and everything left is then installed (or the failure
+ *  handled) exactly as without pipelining.
+ */
+class download_install_manager::pipeline : public pkgAcquireStatus
+{
+  /** The package manager that queued the archives. */
+  pipelined_dpkg_pm *download_pm;
+
+  /** The package manager that runs dpkg. */
+  pipelined_dpkg_pm install_pm;
+
+  /** How many new archives to wait for before running dpkg again. */
+  unsigned int batch_size;
+
+  /** The status object of the frontend. */
+  pkgAcquireStatus *log;
+
+  /** The package installed by each archive, by file name. */
+  map<string, pkgCache::PkgIterator> packages_by_file;
+
+  std::thread download_thread;
+
+  // The members below are shared with the download thread.
+  std::mutex mutex;
+  std::condition_variable cond;
+
+  /** Archives completed since they were last handed over. */
+  vector<string> completed;
+  /** \b true once a download failed. */
+  bool failed;
+  bool finished;
+  bool muted;
+  bool stop_deferred;
+  bool cancelled;
+  pkgAcquire::RunResult download_result;
+
+  bool is_muted()
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    return muted;
+  }
+
+public:
+  pipeline(pipelined_dpkg_pm *_download_pm,
+	   pkgDepCache *cache,
+	   int _batch_size)
+    : download_pm(_download_pm),
+      install_pm(cache),
+      batch_size(std::max(_batch_size, 1)),
+      log(NULL),
+      failed(false),
+      finished(false),
+      muted(false),
+      stop_deferred(false),
+      cancelled(false),
+      download_result(pkgAcquire::Continue)
+  {
+  }
+
+  ~pipeline()
+  {
+    stop();
+  }
+
+  /** Cancel the download, if it is still running, and wait for the
+   *  download thread to exit.
+   */
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> l(mutex);
+      cancelled = true;
+    }
+
+    if(download_thread.joinable())
+      download_thread.join();
+  }
+
+  pipelined_dpkg_pm *get_install_pm()
+  {
+    return &install_pm;
+  }
+
+  /** Forward the status of the download to the given object. */
+  pkgAcquireStatus *wrap(pkgAcquireStatus *_log)
+  {
+    log = _log;
+    return this;
+  }
+
+  /** Remember which archive installs which package.  Must be
+   *  invoked after GetArchives() and before the download starts.
+   */
+  void index_archives(pkgAcquire *fetcher, pkgDepCache &cache)
+  {
+    const string archives = _config->FindDir("Dir::Cache::Archives");
+
+    for(pkgCache::PkgIterator pkg = cache.PkgBegin(); !pkg.end(); ++pkg)
+      {
+	const string &file_name = download_pm->get_file_name(pkg);
+	if(file_name.empty())
+	  continue;
+
+	packages_by_file[file_name] = pkg;
+	packages_by_file[archives + flNotDir(file_name)] = pkg;
+      }
+
+    // Archives that were already in the cache are never downloaded.
+    for(pkgAcquire::ItemIterator i = fetcher->ItemsBegin();
+	i != fetcher->ItemsEnd(); ++i)
+      if((*i)->Status == pkgAcquire::Item::StatDone && (*i)->Complete)
+	completed.push_back((*i)->DestFile);
+  }
+
+  /** Start downloading in the background, unless that already
+   *  happened.
+   */
+  void start(pkgAcquire *fetcher, int pulse_interval)
+  {
+    if(download_thread.joinable() || finished)
+      return;
+
+    download_thread = std::thread([this, fetcher, pulse_interval]()
+      {
+	const pkgAcquire::RunResult res = fetcher->Run(pulse_interval);
+
+	std::lock_guard<std::mutex> l(mutex);
+	finished = true;
+	download_result = res;
+	cond.notify_all();
+      });
+  }
+
+  /** Wait until the download is over, failed, or produced enough new
+   *  archives.
+   *
+   *  \return the result of the download if it is over, otherwise
+   *  pkgAcquire::Continue.
+   */
+  pkgAcquire::RunResult wait_for_batch()
+  {
+    std::unique_lock<std::mutex> l(mutex);
+    cond.wait(l, [this]() {
+	return finished || failed || completed.size() >= batch_size;
+      });
+
+    return finished ? download_result : pkgAcquire::Continue;
+  }
+
+  /** \return \b true if the download is neither over nor failed. */
+  bool is_running()
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    return !finished && !failed;
+  }
+
+  /** Hand the archives completed so far over to dpkg. */
+  void hand_over_completed()
+  {
+    vector<string> files;
+    {
+      std::lock_guard<std::mutex> l(mutex);
+      files.swap(completed);
+    }
+
+    for(const string &file : files)
+      {
+	map<string, pkgCache::PkgIterator>::const_iterator found =
+	  packages_by_file.find(file);
+
+	if(found != packages_by_file.end())
+	  install_pm.set_file_name(found->second, file);
+      }
+  }
+
+  /** Wait for the end of the download and hand all of its results
+   *  (including the failed archives) over to dpkg.
+   *
+   *  \return the result of the download.
+   */
+  pkgAcquire::RunResult wait_until_finished()
+  {
+    if(!download_thread.joinable() && !finished)
+      return pkgAcquire::Failed;
+
+    {
+      std::unique_lock<std::mutex> l(mutex);
+      cond.wait(l, [this]() { return finished; });
+    }
+
+    if(download_thread.joinable())
+      download_thread.join();
+
+    for(const pair<const string, pkgCache::PkgIterator> &entry : packages_by_file)
+      install_pm.set_file_name(entry.second,
+			       download_pm->get_file_name(entry.second));
+
+    return download_result;
+  }
+
+  /** Hold back the output of the download while dpkg owns the
+   *  terminal.
+   */
+  void set_muted(bool _muted)
+  {
+    bool stop_now = false;
+    {
+      std::lock_guard<std::mutex> l(mutex);
+      muted = _muted;
+      stop_now = !muted && stop_deferred;
+      stop_deferred = false;
+    }
+
+    if(stop_now)
+      log->Stop();
+  }
+
+  bool MediaChange(string media, string drive)
+  {
+    return log->MediaChange(media, drive);
+  }
+
+  void Fetched(unsigned long long size, unsigned long long resume_point)
+  {
+    log->Fetched(size, resume_point);
+  }
+
+  void IMSHit(pkgAcquire::ItemDesc &itm)
+  {
+    if(!is_muted())
+      log->IMSHit(itm);
+  }
+
+  void Fetch(pkgAcquire::ItemDesc &itm)
+  {
+    if(!is_muted())
+      log->Fetch(itm);
+  }
+
+  void Done(pkgAcquire::ItemDesc &itm)
+  {
+    if(!is_muted())
+      log->Done(itm);
+
+    if(itm.Owner->Status == pkgAcquire::Item::StatDone && itm.Owner->Complete)
+      {
+	std::lock_guard<std::mutex> l(mutex);
+	completed.push_back(itm.Owner->DestFile);
+	cond.notify_all();
+      }
+  }
+
+  void Fail(pkgAcquire::ItemDesc &itm)
+  {
+    if(!is_muted())
+      log->Fail(itm);
+
+    std::lock_guard<std::mutex> l(mutex);
+    failed = true;
+    cond.notify_all();
+  }
+
+  bool Pulse(pkgAcquire *owner)
+  {
+    {
+      std::lock_guard<std::mutex> l(mutex);
+      if(cancelled)
+	return false;
+      else if(muted)
+	return true;
+    }
+
+    return log->Pulse(owner);
+  }
+
+  void Start()
+  {
+    log->Start();
+  }
+
+  void Stop()
+  {
+    {
+      std::lock_guard<std::mutex> l(mutex);
+      if(muted)
+	{
+	  stop_deferred = true;
+	  return;
+	}
+    }
+
+    log->Stop();
+  }
+};
+
 
 download_install_manager::download_install_manager(bool _download_only,
 						   const run_dpkg_in_terminal_func &_run_dpkg_in_terminal)
-  : log(NULL), download_only(_download_only), pm(_system->CreatePM(*apt_cache_file)),
+  : log(NULL), download_only(_download_only), pm(NULL), pipe(NULL),
+    changes_logged(false), installing_batch(false),
     run_dpkg_in_terminal(_run_dpkg_in_terminal)
 {
+  if(!download_only && aptcfg->FindB(PACKAGE "::Pipelined-Install", false))
+    {
+      pipelined_dpkg_pm *download_pm = new pipelined_dpkg_pm(*apt_cache_file);
+      pm = download_pm;
+      pipe = new pipeline(download_pm, *apt_cache_file,
+			  aptcfg->FindI(PACKAGE "::Pipelined-Install-Batch-Size", 10));
+    }
+  else
+    pm = _system->CreatePM(*apt_cache_file);
 }
 
 download_install_manager::~download_install_manager()
 {
+  // Stops the download thread before the fetcher goes away.
+  delete pipe;
   delete pm;
 }
 
+void download_install_manager::disable_pipelining()
+{
+  delete pipe;
+  pipe = NULL;
+}
+
+pkgPackageManager *download_install_manager::get_install_pm()
+{
+  if(pipe != NULL)
+    return pipe->get_install_pm();
+  else
+    return pm;
+}
+
 bool download_install_manager::prepare(OpProgress &progress,
 				       pkgAcquireStatus &acqlog,
 				       download_signal_log *signallog)
@@ -75,7 +453,7 @@ bool download_install_manager::prepare(OpProgress &progress,
     return false;
 
   fetcher = new pkgAcquire;
-  fetcher->SetLog(&acqlog);
+  fetcher->SetLog(pipe != NULL ? pipe->wrap(&acqlog) : &acqlog);
   // even if we would like to not have to get locks and have to call
   // fetcher->Run() if no (remote) fetch is needed (see #766122), it is needed
   // anyway to work with local repositories (see #816537)
@@ -108,11 +486,42 @@ bool download_install_manager::prepare(OpProgress &progress,
       return false;
     }
 
+  if(pipe != NULL)
+    pipe->index_archives(fetcher, **apt_cache_file);
+
   return true;
 }
 
+pkgAcquire::RunResult download_install_manager::do_download()
+{
+  return do_download(500000);
+}
+
+pkgAcquire::RunResult download_install_manager::do_download(int PulseInterval)
+{
+  if(pipe == NULL)
+    return download_manager::do_download(PulseInterval);
+
+  pipe->start(fetcher, PulseInterval);
+  return pipe->wait_for_batch();
+}
+
 download_manager::result download_install_manager::finish_pre_dpkg(pkgAcquire::RunResult res)
 {
+  installing_batch = false;
+
+  if(pipe != NULL && res == pkgAcquire::Continue)
+    {
+      if(pipe->is_running())
+	{
+	  pipe->hand_over_completed();
+	  installing_batch = true;
+	  return start_install();
+	}
+      else
+	res = pipe->wait_until_finished();
+    }
+
   if(res != pkgAcquire::Continue)
     return failure;
 
@@ -152,8 +561,15 @@ download_manager::result download_install_manager::finish_pre_dpkg(pkgAcquire::R
     {
       if (fix_missing)
 	{
-	  if (!pm->FixMissing())
+	  // FixMissing() keeps back what could not be downloaded; put
+	  // the selections back if dpkg never gets to act on them.
+	  if(pre_fix_missing_state.get() == NULL)
+	    pre_fix_missing_state.reset((*apt_cache_file)->snapshot_apt_state());
+
+	  if (!get_install_pm()->FixMissing())
 	    {
+	      (*apt_cache_file)->restore_apt_state(pre_fix_missing_state.get());
+	      pre_fix_missing_state.reset();
 	      _error->Error(_("Unable to correct for unavailable packages"));
 	      return failure;
 	    }
@@ -165,24 +581,75 @@ download_manager::result download_install_manager::finish_pre_dpkg(pkgAcquire::R
 	}
     }
 
-  log_changes();
+  return start_install();
+}
+
+download_manager::result download_install_manager::start_install()
+{
+  if(!changes_logged)
+    {
+      log_changes();
+      changes_logged = true;
+    }
 
   // Note that someone could grab the lock before dpkg takes it;
   // without a more complicated synchronization protocol (and I don't
   // control the code at dpkg's end), them's the breaks.
   apt_cache_file->ReleaseLock();
 
-  result rval = success;
+  // If the head of the ordering is still being downloaded, apt
+  // reports an error about swapping media; it is discarded, since
+  // the batch is simply retried once more archives have arrived.
+  if(installing_batch)
+    _error->PushToStack();
 
   const pkgPackageManager::OrderResult pre_fork_result =
-    pm->DoInstallPreFork();
+    get_install_pm()->DoInstallPreFork();
 
-  if(pre_fork_result == pkgPackageManager::Failed)
-    rval = failure;
+  const result rval =
+    pre_fork_outcome(pre_fork_result, installing_batch,
+		     pipe != NULL && pipe->get_install_pm()->has_pending_actions());
+
+  if(installing_batch)
+    {
+      if(rval == do_again)
+	_error->RevertToStack();
+      else
+	_error->MergeWithStack();
+    }
 
   return rval;
 }
 
+download_manager::result
+download_install_manager::pre_fork_outcome(pkgPackageManager::OrderResult pre_fork_result,
+					   bool installing_batch,
+					   bool pending_actions)
+{
+  switch(pre_fork_result)
+    {
+    case pkgPackageManager::Completed:
+      return success;
+
+    case pkgPackageManager::Incomplete:
+      // None of the archives needed next has arrived yet.
+      if(installing_batch && !pending_actions)
+	return do_again;
+      else
+	return success;
+
+    case pkgPackageManager::Failed:
+    default:
+      // pkgPackageManager::OrderInstall() fails instead of returning
+      // Incomplete if the very first package of the ordering is
+      // missing.
+      if(installing_batch && !pending_actions)
+	return do_again;
+      else
+	return failure;
+    }
+}
+
 pkgPackageManager::OrderResult download_install_manager::run_dpkg(int status_fd)
 {
   sigset_t allsignals;
@@ -190,12 +657,16 @@ pkgPackageManager::OrderResult download_install_manager::run_dpkg(int status_fd)
   sigfillset(&allsignals);
 
   pthread_sigmask(SIG_UNBLOCK, &allsignals, &oldsignals);
+
+  if(pipe != NULL)
+    pipe->set_muted(true);
+
   std::unique_ptr<APT::Progress::PackageManager> progress;
   if (status_fd > 0)
     progress = std::make_unique<APT::Progress::PackageManagerProgressFd>(status_fd);
   else
     progress = std::unique_ptr<APT::Progress::PackageManager> { APT::Progress::PackageManagerProgressFactory() };
-  pkgPackageManager::OrderResult pmres = pm->DoInstallPostFork(progress.get());
+  pkgPackageManager::OrderResult pmres = get_install_pm()->DoInstallPostFork(progress.get());
 
   switch(pmres)
     {
@@ -211,6 +682,9 @@ pkgPackageManager::OrderResult download_install_manager::run_dpkg(int status_fd)
       break;
     }
 
+  if(pipe != NULL)
+    pipe->set_muted(false);
+
   pthread_sigmask(SIG_SETMASK, &oldsignals, NULL);
 
   return pmres;
@@ -235,12 +709,18 @@ void download_install_manager::finish_post_dpkg(pkgPackageManager::OrderResult d
       break;
     }
 
-  fetcher->Shutdown();
+  installing_batch = false;
+
+  // In pipelined mode the fetcher is still busy with the remaining
+  // archives, and the package manager that runs dpkg receives them
+  // from there.
+  if(pipe == NULL)
+    fetcher->Shutdown();
 
   // Get the archives again.  This was necessary for multi-CD
   // installs, according to my comments in an old commit log in the
   // Subversion repository.
-  if(!pm->GetArchives(fetcher, &src_list, apt_package_records))
+  if(pipe == NULL && !pm->GetArchives(fetcher, &src_list, apt_package_records))
     rval = failure;
   else if(!apt_cache_file->GainLock())
     // This really shouldn't happen.
@@ -251,7 +731,13 @@ void download_install_manager::finish_post_dpkg(pkgPackageManager::OrderResult d
 
   if(rval != do_again)
     {
-      apt_close_cache();
+      // The queued archives refer to the cache that is about to go
+      // away.
+      if(pipe != NULL)
+	pipe->stop();
+
+      if(download_only)
+	apt_close_cache();
 
       if(log != NULL)
 	log->Complete();
@@ -264,14 +750,18 @@ void download_install_manager::finish_post_dpkg(pkgPackageManager::OrderResult d
       // We absolutely need to do this here.  Yes, it slows things
       // down, but without this we get stuff like #429388 due to
       // inconsistencies between aptitude's state file and the real
-      // world.
+      // world.  The cache is only rebuilt if dpkg touched its status
+      // file, though.
       //
       // This implicitly updates the package state file on disk.
       if(!download_only)
 	{
 	  bool operation_needs_lock = true;
-	  apt_load_cache(progress, true, operation_needs_lock, nullptr, reset_reinstall);
+	  if(!apt_refresh_cache(progress, operation_needs_lock, reset_reinstall)
+	     && pre_fix_missing_state.get() != NULL)
+	    (*apt_cache_file)->restore_apt_state(pre_fix_missing_state.get());
 	}
+      pre_fix_missing_state.reset();
 
       if(aptcfg->FindB(PACKAGE "::Forget-New-On-Install", false)
 	 && !download_only)
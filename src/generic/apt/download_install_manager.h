@@ -31,6 +31,7 @@
 
 #include <sigc++/signal.h>
 
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -63,6 +64,30 @@ class download_install_manager : public download_manager
   /** The package manager object used when installing packages */
   pkgPackageManager *pm;
 
+  class pipeline;
+
+  /** If PACKAGE::Pipelined-Install is set, downloads the archives in
+   *  the background and hands them to dpkg as they arrive; otherwise
+   *  \b NULL.
+   */
+  pipeline *pipe;
+
+  /** \b true once the changes have been written to the log. */
+  bool changes_logged;
+
+  /** \b true while the pipeline installs the archives downloaded
+   *  so far, rather than everything that is left.
+   */
+  bool installing_batch;
+
+  /** The selections from before FixMissing() adjusted them, or \b
+   *  NULL if it was not called.
+   */
+  std::unique_ptr<const aptitudeDepCache::apt_state_snapshot> pre_fix_missing_state;
+
+  /** \return The package manager that invokes dpkg. */
+  pkgPackageManager *get_install_pm();
+
   /** The list of sources from which to download. */
   pkgSourceList src_list;
 
@@ -105,7 +130,32 @@ class download_install_manager : public download_manager
    */
   result finish_pre_dpkg(pkgAcquire::RunResult result);
 
+  /** \brief Log the changes and let the package manager prepare
+   *  the next dpkg run.
+   *
+   *  \return success, failure, or do_again if nothing can be
+   *  installed until more archives have been downloaded.
+   */
+  result start_install();
+
 public:
+  /** \brief Decide how to go on once the package manager has
+   *  prepared a dpkg run.
+   *
+   *  \param pre_fork_result   The return value of DoInstallPreFork().
+   *  \param installing_batch  \b true if the rest of the archives
+   *                           are still being downloaded.
+   *  \param pending_actions   \b true if anything was queued for
+   *                           dpkg.
+   *
+   *  \return success if dpkg should be run, do_again if nothing
+   *  can be installed until more archives have arrived, and failure
+   *  otherwise.
+   */
+  static result pre_fork_outcome(pkgPackageManager::OrderResult pre_fork_result,
+				 bool installing_batch,
+				 bool pending_actions);
+
   /** \param _download_only if \b true, this download process will
    *  stop after downloading files (i.e., it won't run the package
    *  manager).
@@ -116,6 +166,13 @@ public:
 			   const run_dpkg_in_terminal_func &_run_dpkg_in_terminal);
   ~download_install_manager();
 
+  /** Install only once the whole download is over, even if
+   *  PACKAGE::Pipelined-Install is set.  Frontends that run dpkg in a
+   *  sub-process must invoke this before prepare(), since the
+   *  package manager would forget what it installed between batches.
+   */
+  void disable_pipelining();
+
   /** Set up an install run.  Does not take ownership of any of the
    *  arguments to the method.
    *
@@ -145,6 +202,14 @@ public:
 	      OpProgress *progress,
 	      const sigc::slot1<void, download_manager::result> &k);
 
+  /** In pipelined mode, start the download in the background if
+   *  necessary and return once enough archives are available to
+   *  run dpkg again (pkgAcquire::Continue) or once the download is
+   *  over (its result).  Otherwise, run the whole download.
+   */
+  pkgAcquire::RunResult do_download();
+  pkgAcquire::RunResult do_download(int PulseInterval);
+
   /** Invoked after an automatic 'forget new' operation. */
   sigc::signal0<void> post_forget_new_hook;
 
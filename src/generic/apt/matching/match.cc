@@ -23,6 +23,7 @@
 #include <aptitude.h>
 
 #include <generic/apt/apt.h>
+#include <generic/apt/pkg_file_attributes.h>
 #include <generic/apt/tags.h>
 #include <generic/apt/tasks.h>
 #include <generic/apt/usertags.h>
@@ -42,6 +43,7 @@
 #include "../config_signal.h"
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <unordered_map>
 
@@ -284,6 +286,339 @@ namespace aptitude
 	}
     }
 
+    namespace
+    {
+      // Rough static estimates used to decide in which order the
+      // children of an ?and are evaluated.
+      //
+      // The cost is in arbitrary units, about the price of testing a
+      // flag of a package; the selectivity is the expected fraction
+      // of the inputs that match.  Neither has to be accurate: they
+      // only have to rank a flag test before a regular expression,
+      // and a regular expression before a lookup in the package
+      // records.
+      double estimate_cost(const ref_ptr<pattern> &p)
+      {
+	switch(p->get_type())
+	  {
+	  case pattern::and_tp:
+	  case pattern::or_tp:
+	    {
+	      const std::vector<ref_ptr<pattern> > &sub_patterns =
+		p->get_type() == pattern::and_tp
+		  ? p->get_and_patterns()
+		  : p->get_or_patterns();
+
+	      double rval = 0;
+	      for(std::vector<ref_ptr<pattern> >::const_iterator it =
+		    sub_patterns.begin(); it != sub_patterns.end(); ++it)
+		rval += estimate_cost(*it);
+
+	      return rval;
+	    }
+
+	  case pattern::not_tp:
+	    return estimate_cost(p->get_not_pattern());
+
+	  case pattern::bind:
+	    return 1 + estimate_cost(p->get_bind_pattern());
+
+	    // Structural patterns that evaluate their argument
+	    // against a whole pool rather than a single version.
+	  case pattern::all_versions:
+	    return 2 * estimate_cost(p->get_all_versions_pattern());
+	  case pattern::any_version:
+	    return 2 * estimate_cost(p->get_any_version_pattern());
+	  case pattern::for_tp:
+	    return estimate_cost(p->get_for_pattern());
+	  case pattern::narrow:
+	    return 2 * (estimate_cost(p->get_narrow_filter())
+			+ estimate_cost(p->get_narrow_pattern()));
+	  case pattern::widen:
+	    return 4 * estimate_cost(p->get_widen_pattern());
+
+	    // Patterns that walk the dependencies or provides and
+	    // evaluate their argument against each target.
+	  case pattern::depends:
+	    return 10 + 10 * estimate_cost(p->get_depends_pattern());
+	  case pattern::reverse_depends:
+	    return 10 + 10 * estimate_cost(p->get_reverse_depends_pattern());
+	  case pattern::provides:
+	    return 5 + 5 * estimate_cost(p->get_provides_pattern());
+	  case pattern::reverse_provides:
+	    return 5 + 5 * estimate_cost(p->get_reverse_provides_pattern());
+	  case pattern::broken_type:
+	    return 10;
+
+	    // Patterns that need the package records.
+	  case pattern::description:
+	  case pattern::maintainer:
+	  case pattern::source_package:
+	  case pattern::source_version:
+	  case pattern::task:
+	    return 50;
+
+	    // Index lookups (or, without an index, a regular
+	    // expression over the description).
+	  case pattern::tag:
+	  case pattern::term:
+	  case pattern::term_prefix:
+	    return 20;
+
+	    // Regular expressions over short strings, possibly for
+	    // each file that a version is available from.
+	  case pattern::archive:
+	  case pattern::label:
+	  case pattern::origin:
+	    return 4;
+	  case pattern::architecture:
+	  case pattern::name:
+	  case pattern::section:
+	  case pattern::user_tag:
+	  case pattern::version:
+	    return 3;
+
+	  case pattern::action:
+	  case pattern::automatic:
+	  case pattern::broken:
+	  case pattern::candidate_version:
+	  case pattern::config_files:
+	  case pattern::current_version:
+	  case pattern::equal:
+	  case pattern::essential:
+	  case pattern::exact_name:
+	  case pattern::false_tp:
+	  case pattern::foreign_architecture:
+	  case pattern::garbage:
+	  case pattern::install_version:
+	  case pattern::installed:
+	  case pattern::multiarch:
+	  case pattern::native_architecture:
+	  case pattern::new_tp:
+	  case pattern::obsolete:
+	  case pattern::priority:
+	  case pattern::true_tp:
+	  case pattern::upgradable:
+	  case pattern::virtual_tp:
+	    return 1;
+
+	  default:
+	    throw MatchingException("Internal error: unhandled pattern type in estimate_cost()");
+	  }
+      }
+
+      double estimate_selectivity(const ref_ptr<pattern> &p)
+      {
+	switch(p->get_type())
+	  {
+	  case pattern::and_tp:
+	    {
+	      const std::vector<ref_ptr<pattern> > &sub_patterns(p->get_and_patterns());
+
+	      double rval = 1;
+	      for(std::vector<ref_ptr<pattern> >::const_iterator it =
+		    sub_patterns.begin(); it != sub_patterns.end(); ++it)
+		rval *= estimate_selectivity(*it);
+
+	      return rval;
+	    }
+
+	  case pattern::or_tp:
+	    {
+	      const std::vector<ref_ptr<pattern> > &sub_patterns(p->get_or_patterns());
+
+	      double rejected = 1;
+	      for(std::vector<ref_ptr<pattern> >::const_iterator it =
+		    sub_patterns.begin(); it != sub_patterns.end(); ++it)
+		rejected *= 1 - estimate_selectivity(*it);
+
+	      return 1 - rejected;
+	    }
+
+	  case pattern::not_tp:
+	    return 1 - estimate_selectivity(p->get_not_pattern());
+
+	  case pattern::bind:
+	    return estimate_selectivity(p->get_bind_pattern());
+	  case pattern::all_versions:
+	    return estimate_selectivity(p->get_all_versions_pattern());
+	  case pattern::any_version:
+	    return estimate_selectivity(p->get_any_version_pattern());
+	  case pattern::for_tp:
+	    return estimate_selectivity(p->get_for_pattern());
+	  case pattern::narrow:
+	    return estimate_selectivity(p->get_narrow_filter())
+	      * estimate_selectivity(p->get_narrow_pattern());
+	  case pattern::widen:
+	    return estimate_selectivity(p->get_widen_pattern());
+
+	  case pattern::true_tp:
+	    return 1;
+	  case pattern::false_tp:
+	    return 0;
+
+	  case pattern::architecture:
+	  case pattern::archive:
+	  case pattern::equal:
+	  case pattern::label:
+	  case pattern::native_architecture:
+	  case pattern::origin:
+	    return 0.5;
+
+	  case pattern::candidate_version:
+	  case pattern::depends:
+	  case pattern::reverse_depends:
+	  case pattern::version:
+	    return 0.2;
+
+	  case pattern::foreign_architecture:
+	  case pattern::multiarch:
+	  case pattern::name:
+	  case pattern::priority:
+	  case pattern::section:
+	  case pattern::virtual_tp:
+	    return 0.1;
+
+	  case pattern::automatic:
+	  case pattern::current_version:
+	  case pattern::description:
+	  case pattern::install_version:
+	  case pattern::installed:
+	  case pattern::maintainer:
+	  case pattern::new_tp:
+	  case pattern::provides:
+	  case pattern::reverse_provides:
+	  case pattern::source_package:
+	  case pattern::source_version:
+	  case pattern::tag:
+	  case pattern::task:
+	  case pattern::term:
+	  case pattern::term_prefix:
+	  case pattern::user_tag:
+	    return 0.05;
+
+	  case pattern::action:
+	  case pattern::broken:
+	  case pattern::broken_type:
+	  case pattern::config_files:
+	  case pattern::essential:
+	  case pattern::exact_name:
+	  case pattern::garbage:
+	  case pattern::obsolete:
+	  case pattern::upgradable:
+	    return 0.02;
+
+	  default:
+	    throw MatchingException("Internal error: unhandled pattern type in estimate_selectivity()");
+	  }
+      }
+
+      /** \brief Order the children of an ?and pattern by how cheaply
+       *  they are expected to reject an input.
+       *
+       *  A child that costs c and passes a fraction s of its inputs
+       *  costs c/(1-s) per rejected input, so sorting by that value
+       *  lets the cheap, selective tests run first; the expensive
+       *  ones are only evaluated on whatever survives them.  Ties
+       *  keep the order written by the user.
+       */
+      std::vector<std::size_t> compute_and_order(const ref_ptr<pattern> &p)
+      {
+	const std::vector<ref_ptr<pattern> > &sub_patterns(p->get_and_patterns());
+
+	std::vector<std::pair<double, std::size_t> > ranked;
+	ranked.reserve(sub_patterns.size());
+	for(std::size_t i = 0; i < sub_patterns.size(); ++i)
+	  {
+	    const double rejected =
+	      std::max(0.01, 1 - estimate_selectivity(sub_patterns[i]));
+
+	    ranked.push_back(std::make_pair(estimate_cost(sub_patterns[i]) / rejected, i));
+	  }
+
+	std::stable_sort(ranked.begin(), ranked.end());
+
+	std::vector<std::size_t> rval;
+	rval.reserve(ranked.size());
+	for(std::vector<std::pair<double, std::size_t> >::const_iterator it =
+	      ranked.begin(); it != ranked.end(); ++it)
+	  rval.push_back(it->second);
+
+	return rval;
+      }
+
+      /** \brief Append the stack positions of the variables that p
+       *  refers to (through ?bind and ?equal) to out.
+       *
+       *  This includes the variables bound by ?for patterns inside p.
+       */
+      void collect_variables(const ref_ptr<pattern> &p,
+			     std::vector<std::size_t> &out)
+      {
+	switch(p->get_type())
+	  {
+	  case pattern::and_tp:
+	  case pattern::or_tp:
+	    {
+	      const std::vector<ref_ptr<pattern> > &sub_patterns =
+		p->get_type() == pattern::and_tp
+		  ? p->get_and_patterns()
+		  : p->get_or_patterns();
+
+	      for(std::vector<ref_ptr<pattern> >::const_iterator it =
+		    sub_patterns.begin(); it != sub_patterns.end(); ++it)
+		collect_variables(*it, out);
+	    }
+	    break;
+
+	  case pattern::bind:
+	    out.push_back(p->get_bind_variable_index());
+	    collect_variables(p->get_bind_pattern(), out);
+	    break;
+	  case pattern::equal:
+	    out.push_back(p->get_equal_stack_position());
+	    break;
+
+	  case pattern::all_versions:
+	    collect_variables(p->get_all_versions_pattern(), out);
+	    break;
+	  case pattern::any_version:
+	    collect_variables(p->get_any_version_pattern(), out);
+	    break;
+	  case pattern::depends:
+	    collect_variables(p->get_depends_pattern(), out);
+	    break;
+	  case pattern::for_tp:
+	    collect_variables(p->get_for_pattern(), out);
+	    break;
+	  case pattern::narrow:
+	    collect_variables(p->get_narrow_filter(), out);
+	    collect_variables(p->get_narrow_pattern(), out);
+	    break;
+	  case pattern::not_tp:
+	    collect_variables(p->get_not_pattern(), out);
+	    break;
+	  case pattern::provides:
+	    collect_variables(p->get_provides_pattern(), out);
+	    break;
+	  case pattern::reverse_depends:
+	    collect_variables(p->get_reverse_depends_pattern(), out);
+	    break;
+	  case pattern::reverse_provides:
+	    collect_variables(p->get_reverse_provides_pattern(), out);
+	    break;
+	  case pattern::widen:
+	    collect_variables(p->get_widen_pattern(), out);
+	    break;
+
+	  default:
+	    // Every other pattern is atomic and refers to no
+	    // variables.
+	    break;
+	  }
+      }
+    }
+
     // We could try a fancy scheme where arbitrary values are attached
     // to each pattern and downcast using dynamic_cast, but I opted
     // for just explicitly listing all the possible caches in one
@@ -296,6 +631,17 @@ namespace aptitude
 
       user_tag_match_map user_tag_matches;
 
+      typedef std::map<std::pair<ref_ptr<pattern>, unsigned int>, ref_ptr<match> > pkg_file_string_match_map;
+
+      // Matches of ?archive, ?label and ?origin patterns against the
+      // distinct strings of the package files, keyed by the
+      // identifier of the string in the pkg_file_table of the cache
+      // identified by pkg_file_strings_cache_instance.  Identifiers
+      // are only meaningful within one cache, so the matches are
+      // discarded when a different cache is searched.
+      pkg_file_string_match_map pkg_file_string_matches;
+      unsigned long pkg_file_strings_cache_instance;
+
       struct compare_user_tag_match_by_tag
       {
 	bool operator()(const std::pair<user_tag, ref_ptr<match> > &p1,
@@ -333,6 +679,55 @@ namespace aptitude
       // Only used if the Xapian database failed to load.
       unordered_map<std::string, ref_ptr<regex> > term_prefix_regexes;
 
+      // Maps each ?and pattern to the order in which its children
+      // are evaluated (see compute_and_order()).
+      std::map<ref_ptr<pattern>, std::vector<std::size_t> > and_orders;
+
+      // If true, the caller only needs to know whether the pattern
+      // matched: successful evaluations return the placeholders below
+      // instead of building a tree of match objects.
+      bool boolean_only;
+
+      // Placeholders returned by successful evaluations in
+      // boolean-only mode.  They carry no information (not even a
+      // pattern) and are shared by every evaluation.
+      ref_ptr<structural_match> true_structural_match;
+      ref_ptr<match> true_match;
+
+      // If true, evaluations are timed and counted in profile.
+      bool profiling;
+
+      // Maps each profiled pattern to its entry in profile.
+      std::map<ref_ptr<pattern>, std::size_t> profile_indices;
+
+      std::vector<subpattern_profile> profile;
+
+    public:
+      // Identifies an evaluation of a ?bind pattern: the pattern,
+      // whether only a yes/no answer was needed, and the contents of
+      // the pools bound to the variables that it refers to.
+      typedef std::pair<std::pair<ref_ptr<pattern>, bool>,
+			std::vector<std::vector<matchable> > > bind_memo_key;
+
+    private:
+      // Memoizes the matches of ?bind patterns.  A ?bind ignores the
+      // value that it is tested against, so its match only depends
+      // on its key; without this, ?for x: ?depends(?bind(x, ...))
+      // evaluates the same sub-pattern again for every dependency.
+      //
+      // Matches also depend on the state of the package cache, so
+      // the table is emptied when the cache or its state generation
+      // changes.  It is also emptied when a new search starts, since
+      // its keys hold on to the patterns of the previous one.
+      std::map<bind_memo_key, ref_ptr<structural_match> > bind_memo;
+      unsigned long bind_memo_cache_instance;
+      unsigned long bind_memo_generation;
+      bind_memo_statistics bind_memo_stats;
+
+      // Maps each ?bind pattern to the stack positions of the
+      // variables that it refers to, sorted and without duplicates.
+      std::map<ref_ptr<pattern>, std::vector<std::size_t> > bind_variables;
+
       /** \brief Get a regular expression that matches the given
        *  string as a "term".
        *
@@ -379,7 +774,20 @@ namespace aptitude
 
     public:
       implementation()
+	: pkg_file_strings_cache_instance(0),
+	  boolean_only(false),
+	  true_structural_match(structural_match::make_branch(ref_ptr<pattern>(),
+							      (ref_ptr<structural_match> *)0,
+							      (ref_ptr<structural_match> *)0)),
+	  true_match(match::make_atomic(ref_ptr<pattern>())),
+	  profiling(false),
+	  bind_memo_cache_instance(0),
+	  bind_memo_generation(0)
       {
+	bind_memo_stats.lookups = 0;
+	bind_memo_stats.hits = 0;
+	bind_memo_stats.entries = 0;
+
 	try
 	  {
             const std::string filename =
@@ -393,9 +801,175 @@ namespace aptitude
 	  }
       }
 
-      const std::unique_ptr<debtags_db> &get_db() const
+      const std::unique_ptr<debtags_db> &get_db() const
+      {
+	return db;
+      }
+
+      /** \brief Get the order in which to evaluate the children of
+       *  the given ?and pattern.
+       *
+       *  Memoizes its return value in and_orders.
+       */
+      const std::vector<std::size_t> &get_and_order(const ref_ptr<pattern> &p)
+      {
+	std::map<ref_ptr<pattern>, std::vector<std::size_t> >::iterator found =
+	  and_orders.find(p);
+
+	if(found == and_orders.end())
+	  found = and_orders.insert(std::make_pair(p, compute_and_order(p))).first;
+
+	return found->second;
+      }
+
+      bool get_boolean_only() const
+      {
+	return boolean_only;
+      }
+
+      void set_boolean_only(bool value)
+      {
+	boolean_only = value;
+      }
+
+      const ref_ptr<structural_match> &get_true_structural_match() const
+      {
+	return true_structural_match;
+      }
+
+      const ref_ptr<match> &get_true_match() const
+      {
+	return true_match;
+      }
+
+      void set_profiling(bool enabled)
+      {
+	profiling = enabled;
+      }
+
+      bool get_profiling() const
+      {
+	return profiling;
+      }
+
+      const std::vector<subpattern_profile> &get_profile() const
+      {
+	return profile;
+      }
+
+      /** \brief Forget the ?bind matches and variables of the
+       *  previous search, and restart the statistics.
+       */
+      void begin_search()
+      {
+	bind_memo.clear();
+	bind_variables.clear();
+	bind_memo_stats.lookups = 0;
+	bind_memo_stats.hits = 0;
+	bind_memo_stats.entries = 0;
+      }
+
+      /** \brief Get the stack positions of the variables that the
+       *  given ?bind pattern refers to, in increasing order.
+       *
+       *  Memoizes its return value in bind_variables.
+       */
+      const std::vector<std::size_t> &get_bind_variables(const ref_ptr<pattern> &p)
+      {
+	std::map<ref_ptr<pattern>, std::vector<std::size_t> >::iterator found =
+	  bind_variables.find(p);
+
+	if(found == bind_variables.end())
+	  {
+	    std::vector<std::size_t> variables;
+	    collect_variables(p, variables);
+	    std::sort(variables.begin(), variables.end());
+	    variables.erase(std::unique(variables.begin(), variables.end()),
+			    variables.end());
+
+	    found = bind_variables.insert(std::make_pair(p, variables)).first;
+	  }
+
+	return found->second;
+      }
+
+      /** \brief Look up a previous evaluation of a ?bind pattern.
+       *
+       *  \param key    the evaluation to look up.
+       *  \param cache  the package cache that the search runs on; the
+       *                memo table is emptied if it differs from the
+       *                cache of the last lookup, or if its state has
+       *                changed since then.
+       *  \param m      set to the memoized match (which might be
+       *                invalid) if one was found.
+       *
+       *  \return \b true if a match was memoized for key.
+       */
+      bool find_bind_match(const bind_memo_key &key,
+			   const aptitudeDepCache &cache,
+			   ref_ptr<structural_match> &m)
+      {
+	if(bind_memo_cache_instance != cache.get_cache_instance() ||
+	   bind_memo_generation != cache.get_state_generation())
+	  {
+	    bind_memo.clear();
+	    bind_memo_stats.entries = 0;
+	    bind_memo_cache_instance = cache.get_cache_instance();
+	    bind_memo_generation = cache.get_state_generation();
+	  }
+
+	++bind_memo_stats.lookups;
+
+	std::map<bind_memo_key, ref_ptr<structural_match> >::const_iterator found =
+	  bind_memo.find(key);
+	if(found == bind_memo.end())
+	  return false;
+
+	++bind_memo_stats.hits;
+	m = found->second;
+	return true;
+      }
+
+      /** \brief Memoize the match of a ?bind pattern after a failed
+       *  call to find_bind_match().
+       */
+      void add_bind_match(const bind_memo_key &key,
+			  const ref_ptr<structural_match> &m)
+      {
+	if(bind_memo.insert(std::make_pair(key, m)).second)
+	  ++bind_memo_stats.entries;
+      }
+
+      const bind_memo_statistics &get_bind_memo_statistics() const
+      {
+	return bind_memo_stats;
+      }
+
+      /** \brief Account for one evaluation of p. */
+      void add_evaluation(const ref_ptr<pattern> &p, bool matched, double elapsed)
       {
-	return db;
+	std::map<ref_ptr<pattern>, std::size_t>::iterator found =
+	  profile_indices.find(p);
+
+	if(found == profile_indices.end())
+	  {
+	    subpattern_profile entry;
+	    entry.p = p;
+	    entry.estimated_cost = estimate_cost(p);
+	    entry.estimated_selectivity = estimate_selectivity(p);
+	    entry.evaluations = 0;
+	    entry.matches = 0;
+	    entry.elapsed = 0;
+
+	    found = profile_indices.insert(std::make_pair(p, profile.size())).first;
+	    profile.push_back(entry);
+	  }
+
+	subpattern_profile &entry(profile[found->second]);
+	++entry.evaluations;
+	if(matched)
+	  ++entry.matches;
+	entry.elapsed += elapsed;
       }
 
       // Return a match of the given user tag to the given pattern,
@@ -425,6 +999,37 @@ namespace aptitude
 	  return cached_match->second;
       }
 
+      // Return a match of the string with the given identifier in the
+      // pkg_file_table of the given cache to the given pattern, which
+      // must be an ?archive, ?label or ?origin pattern.  The regular
+      // expression is run at most once per distinct string.
+      ref_ptr<match> find_pkg_file_string_match(const ref_ptr<pattern> &p,
+						const pattern::regex_info &inf,
+						unsigned int id,
+						const aptitudeDepCache &cache,
+						bool debug)
+      {
+	if(pkg_file_strings_cache_instance != cache.get_cache_instance())
+	  {
+	    pkg_file_string_matches.clear();
+	    pkg_file_strings_cache_instance = cache.get_cache_instance();
+	  }
+
+	std::pair<ref_ptr<pattern>, unsigned int> key(std::make_pair(p, id));
+	pkg_file_string_match_map::iterator cached_match(pkg_file_string_matches.find(key));
+
+	if(cached_match == pkg_file_string_matches.end())
+	  {
+	    const std::string &s = cache.get_pkg_file_table().get_string(id);
+	    cached_match = pkg_file_string_matches.insert(std::make_pair(key, evaluate_regexp(p, inf, s.c_str(), debug))).first;
+	  }
+
+	if(boolean_only && cached_match->second.valid())
+	  return true_match;
+	else
+	  return cached_match->second;
+      }
+
       bool term_prefix_matches(const matchable &target,
                                const std::string &prefix,
                                aptitudeDepCache &cache,
@@ -651,6 +1256,21 @@ namespace aptitude
       return new implementation;
     }
 
+    void search_cache::set_profiling(bool enabled)
+    {
+      static_cast<implementation *>(this)->set_profiling(enabled);
+    }
+
+    const std::vector<search_cache::subpattern_profile> &search_cache::get_profile() const
+    {
+      return static_cast<const implementation *>(this)->get_profile();
+    }
+
+    search_cache::bind_memo_statistics search_cache::get_bind_memo_statistics() const
+    {
+      return static_cast<const implementation *>(this)->get_bind_memo_statistics();
+    }
+
     namespace
     {
       Xapian::Query stem_term(const std::string &term)
@@ -741,6 +1361,136 @@ namespace aptitude
 						  pkgRecords &records,
 						  bool debug);
 
+      /** \brief Like evaluate_structural, but accounts for the
+       *  evaluation in the search cache's profile if profiling is
+       *  enabled.
+       */
+      ref_ptr<structural_match> evaluate_profiled(structural_eval_mode mode,
+						  const ref_ptr<pattern> &p,
+						  stack &the_stack,
+						  const ref_ptr<search_cache::implementation> &search_info,
+						  const std::vector<matchable> &pool,
+						  aptitudeDepCache &cache,
+						  pkgRecords &records,
+						  bool debug);
+
+      /** \brief Test whether p matches, without building match
+       *  objects for it.
+       */
+      bool evaluate_boolean(structural_eval_mode mode,
+			    const ref_ptr<pattern> &p,
+			    stack &the_stack,
+			    const ref_ptr<search_cache::implementation> &search_info,
+			    const std::vector<matchable> &pool,
+			    aptitudeDepCache &cache,
+			    pkgRecords &records,
+			    bool debug);
+
+      /** \brief Puts a search cache in boolean-only mode for the
+       *  lifetime of this object.
+       */
+      class boolean_only_scope
+      {
+	search_cache::implementation &search_info;
+	bool previous;
+
+      public:
+	boolean_only_scope(search_cache::implementation &_search_info)
+	  : search_info(_search_info),
+	    previous(_search_info.get_boolean_only())
+	{
+	  search_info.set_boolean_only(true);
+	}
+
+	~boolean_only_scope()
+	{
+	  search_info.set_boolean_only(previous);
+	}
+      };
+
+      /** \brief Print how often ?bind matches were found in the memo
+       *  table, for debugging.
+       */
+      void print_bind_memo_statistics(std::ostream &out,
+				      const search_cache::implementation &search_info)
+      {
+	const search_cache::bind_memo_statistics &stats(search_info.get_bind_memo_statistics());
+
+	if(stats.lookups > 0)
+	  out << "Memoized ?bind matches: " << stats.hits
+	      << " hits in " << stats.lookups << " lookups ("
+	      << (100 * stats.hits / stats.lookups) << "%), "
+	      << stats.entries << " entries." << std::endl;
+      }
+
+      ref_ptr<match> make_atomic_match(const ref_ptr<pattern> &p,
+				       const ref_ptr<search_cache::implementation> &search_info)
+      {
+	if(search_info->get_boolean_only())
+	  return search_info->get_true_match();
+	else
+	  return match::make_atomic(p);
+      }
+
+      ref_ptr<match> make_atomic_match(const ref_ptr<pattern> &p,
+				       const std::string &match_string,
+				       const ref_ptr<search_cache::implementation> &search_info)
+      {
+	if(search_info->get_boolean_only())
+	  return search_info->get_true_match();
+	else
+	  return match::make_atomic(p, match_string);
+      }
+
+      ref_ptr<match> make_sub_match(const ref_ptr<pattern> &p,
+				    const ref_ptr<structural_match> &sub_match,
+				    const ref_ptr<search_cache::implementation> &search_info)
+      {
+	if(search_info->get_boolean_only())
+	  return search_info->get_true_match();
+	else
+	  return make_sub_match(p, sub_match, search_info);
+      }
+
+      ref_ptr<match> make_dependency_match(const ref_ptr<pattern> &p,
+					   const ref_ptr<structural_match> &sub_match,
+					   const pkgCache::DepIterator &dep,
+					   const ref_ptr<search_cache::implementation> &search_info)
+      {
+	if(search_info->get_boolean_only())
+	  return search_info->get_true_match();
+	else
+	  return match::make_dependency(p, sub_match, dep);
+      }
+
+      ref_ptr<match> make_provides_match(const ref_ptr<pattern> &p,
+					 const ref_ptr<structural_match> &sub_match,
+					 const pkgCache::PrvIterator &prv,
+					 const ref_ptr<search_cache::implementation> &search_info)
+      {
+	if(search_info->get_boolean_only())
+	  return search_info->get_true_match();
+	else
+	  return match::make_provides(p, sub_match, prv);
+      }
+
+      /** \brief Like evaluate_regexp(), but doesn't retrieve the
+       *  matched groups if the search cache is in boolean-only mode.
+       */
+      ref_ptr<match> evaluate_regexp(const ref_ptr<pattern> &p,
+				     const pattern::regex_info &inf,
+				     const char *s,
+				     const ref_ptr<search_cache::implementation> &search_info,
+				     bool debug)
+      {
+	if(!search_info->get_boolean_only())
+	  return evaluate_regexp(p, inf, s, debug);
+	else if(inf.get_regex_group()->exec(s, NULL, 0))
+	  return search_info->get_true_match();
+	else
+	  return NULL;
+      }
+
       // Match an atomic expression against one matchable.
       ref_ptr<match> evaluate_atomic(const ref_ptr<pattern> &p,
 				     const matchable &target,
@@ -782,18 +1532,23 @@ namespace aptitude
 
 	    {
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
-
+	      const aptitude::apt::pkg_file_table &files(cache.get_pkg_file_table());
 
 	      for(pkgCache::VerFileIterator f = ver.FileList(); !f.end(); ++f)
 		{
 		  pkgCache::PkgFileIterator cur = f.File();
+		  if(cur.end())
+		    continue;
 
-		  if(!cur.end() && cur.Archive())
+		  const unsigned int archive = files.get(cur).archive;
+		  if(archive != 0)
 		    {
-		      ref_ptr<match> m = evaluate_regexp(p,
-							 p->get_archive_regex_info(),
-							 cur.Archive(),
-							 debug);
+		      ref_ptr<match> m =
+			search_info->find_pkg_file_string_match(p,
+								p->get_archive_regex_info(),
+								archive,
+								cache,
+								debug);
 
 		      if(m.valid())
 			return m;
@@ -865,7 +1620,7 @@ namespace aptitude
 		}
 
 	      if(matches)
-		return match::make_atomic(p);
+		return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
@@ -881,7 +1636,7 @@ namespace aptitude
               const ref_ptr<arch_specification> spec(p->get_architecture_arch_specification());
 
               if(spec->matches(ver.Arch()) == true)
-                return match::make_atomic(p, ver.Arch());
+                return make_atomic_match(p, ver.Arch(), search_info);
               else
                 return NULL;
 	    }
@@ -893,7 +1648,7 @@ namespace aptitude
 
 	      if(  (!pkg.CurrentVer().end() || cache[pkg].Install()) &&
 		   (cache[pkg].Flags & pkgCache::Flag::Auto)  )
-		return match::make_atomic(p);
+		return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
@@ -905,18 +1660,40 @@ namespace aptitude
 	      const std::size_t variable_index = p->get_bind_variable_index();
 	      eassert(variable_index < the_stack.size());
 
-	      ref_ptr<structural_match>
-		sub_match(evaluate_toplevel(structural_eval_any,
-					    p->get_bind_pattern(),
-					    the_stack,
-					    search_info,
-					    *the_stack[variable_index],
-					    cache,
-					    records,
-					    debug));
+	      // The match doesn't depend on the target, only on the
+	      // variables in scope that the pattern refers to (the
+	      // others are bound by ?for patterns inside it).
+	      search_cache::implementation::bind_memo_key key;
+	      key.first = std::make_pair(p, search_info->get_boolean_only());
+
+	      const std::vector<std::size_t> &variables(search_info->get_bind_variables(p));
+	      for(std::vector<std::size_t>::const_iterator it =
+		    variables.begin(); it != variables.end() && *it < the_stack.size(); ++it)
+		key.second.push_back(*the_stack[*it]);
+
+	      ref_ptr<structural_match> sub_match;
+	      if(search_info->find_bind_match(key, cache, sub_match))
+		{
+		  if(debug)
+		    std::cout << "Reusing the memoized match of "
+			      << serialize_pattern(p) << std::endl;
+		}
+	      else
+		{
+		  sub_match = evaluate_toplevel(structural_eval_any,
+						p->get_bind_pattern(),
+						the_stack,
+						search_info,
+						*the_stack[variable_index],
+						cache,
+						records,
+						debug);
+
+		  search_info->add_bind_match(key, sub_match);
+		}
 
 	      if(sub_match.valid())
-		return match::make_with_sub_match(p, sub_match);
+		return make_sub_match(p, sub_match, search_info);
 	      else
 		return NULL;
 	    }
@@ -931,7 +1708,7 @@ namespace aptitude
 		aptitudeDepCache::StateCache &state = cache[pkg];
 
 		if(state.NowBroken() || state.InstBroken())
-		  return match::make_atomic(p);
+		  return make_atomic_match(p, search_info);
 		else
 		  return NULL;
 	      }
@@ -953,7 +1730,7 @@ namespace aptitude
 		    if(dep->Type == p->get_broken_type_depends_type() &&
 		       !(cache[dep] & pkgDepCache::DepGInstall))
 		      // Oops, it's broken..
-		      return match::make_atomic(p);
+		      return make_atomic_match(p, search_info);
 
 		    ++dep;
 		  }
@@ -971,7 +1748,7 @@ namespace aptitude
 		pkgCache::VerIterator ver(target.get_version_iterator(cache));
 
 		if(ver == cache[pkg].CandidateVerIter(cache))
-		  return match::make_atomic(p);
+		  return make_atomic_match(p, search_info);
 		else
 		  return NULL;
 	      }
@@ -979,7 +1756,7 @@ namespace aptitude
 
 	  case pattern::config_files:
 	    if(target.get_pkg()->CurrentState == pkgCache::State::ConfigFiles)
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    else
 	      return NULL;
 	    break;
@@ -994,7 +1771,7 @@ namespace aptitude
 		pkgCache::VerIterator ver(target.get_version_iterator(cache));
 
 		if(ver == pkg.CurrentVer())
-		  return match::make_atomic(p);
+		  return make_atomic_match(p, search_info);
 		else
 		  return NULL;
 	      }
@@ -1070,8 +1847,9 @@ namespace aptitude
 			    // Note: the dependency that we return is
 			    // just the head of the OR group.
 			    if(m.valid())
-			      return match::make_dependency(p, m,
-							    or_group_start);
+			      return make_dependency_match(p, m,
+							    or_group_start,
+							    search_info);
 			  }
 		      }
 
@@ -1091,6 +1869,7 @@ namespace aptitude
 		return evaluate_regexp(p,
 				       p->get_description_regex_info(),
 				       transcode(get_long_description(ver, &records)).c_str(),
+				       search_info,
 				       debug);
 	      }
 	    break;
@@ -1100,7 +1879,7 @@ namespace aptitude
 	      pkgCache::PkgIterator pkg(target.get_package_iterator(cache));
 
 	      if ((pkg->Flags & pkgCache::Flag::Essential) == pkgCache::Flag::Essential)
-		  return match::make_atomic(p);
+		  return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
@@ -1117,7 +1896,7 @@ namespace aptitude
 
 	      if(std::binary_search(pool.begin(), pool.end(),
 				    target))
-		return match::make_atomic(p);
+		return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
@@ -1126,7 +1905,7 @@ namespace aptitude
 
 	  case pattern::exact_name:
 	    if(p->get_exact_name_name() == target.get_package_iterator(cache).Name())
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    else
 	      return NULL;
 
@@ -1141,7 +1920,7 @@ namespace aptitude
 	    {
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
 	      if(aptitude::apt::is_foreign_arch(ver))
-		return match::make_atomic(p, ver.Arch());
+		return make_atomic_match(p, ver.Arch(), search_info);
 	      else
 		return NULL;
 	    }
@@ -1152,13 +1931,13 @@ namespace aptitude
 	    else if(!cache[target.get_package_iterator(cache)].Garbage)
 	      return NULL;
 	    else
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    break;
 
 	  case pattern::install_version:
 	    if(target.get_has_version() &&
 	       target.get_ver() == cache[target.get_package_iterator(cache)].InstallVer)
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    else
 	      return NULL;
 	    break;
@@ -1166,7 +1945,7 @@ namespace aptitude
 	  case pattern::installed:
 	    if(target.get_has_version() &&
 	       target.get_version_iterator(cache) == target.get_package_iterator(cache).CurrentVer())
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    else
 	      return NULL;
 	    break;
@@ -1175,22 +1954,23 @@ namespace aptitude
 	    if(!target.get_has_version())
 	      return NULL;
 	    {
-	      pkgCache::PkgIterator pkg(target.get_package_iterator(cache));
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
+	      const aptitude::apt::pkg_file_table &files(cache.get_pkg_file_table());
 
 	      for(pkgCache::VerFileIterator f = ver.FileList(); !f.end(); ++f)
 		{
 		  pkgCache::PkgFileIterator cur = f.File();
 		  if (!cur.end())
 		    {
-		      const char* label = cur.Label();
-		      if (label != nullptr)
+		      const unsigned int label = files.get(cur).label;
+		      if (label != 0)
 			{
 			  ref_ptr<match>
-			    m(evaluate_regexp(p,
-					      p->get_label_regex_info(),
-					      label,
-					      debug));
+			    m(search_info->find_pkg_file_string_match(p,
+								      p->get_label_regex_info(),
+								      label,
+								      cache,
+								      debug));
 
 			  if (m.valid())
 			    return m;
@@ -1214,6 +1994,7 @@ namespace aptitude
 		return evaluate_regexp(p,
 				       p->get_maintainer_regex_info(),
 				       rec.Maintainer().c_str(),
+				       search_info,
 				       debug);
 	      }
 	    break;
@@ -1244,7 +2025,7 @@ namespace aptitude
                   }
 
 		if(matches)
-		  return match::make_atomic(p);
+		  return make_atomic_match(p, search_info);
 		else
 		  return NULL;
 	      }
@@ -1254,6 +2035,7 @@ namespace aptitude
 	    return evaluate_regexp(p,
 				   p->get_name_regex_info(),
 				   target.get_package_iterator(cache).Name(),
+				   search_info,
 				   debug);
 	    break;
 
@@ -1264,7 +2046,7 @@ namespace aptitude
 	    {
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
 	      if(aptitude::apt::is_native_arch(ver))
-		return match::make_atomic(p, ver.Arch());
+		return make_atomic_match(p, ver.Arch(), search_info);
 	      else
 		return NULL;
 	    }
@@ -1275,12 +2057,12 @@ namespace aptitude
 	    else if(!cache.get_ext_state(target.get_package_iterator(cache)).new_package)
 	      return NULL;
 	    else
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    break;
 
 	  case pattern::obsolete:
 	    if(pkg_obsolete(target.get_package_iterator(cache)))
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    else
 	      return NULL;
 	    break;
@@ -1289,23 +2071,23 @@ namespace aptitude
 	    if(!target.get_has_version())
 	      return NULL;
 	    {
-	      pkgCache::PkgIterator pkg(target.get_package_iterator(cache));
 	      pkgCache::VerIterator ver(target.get_version_iterator(cache));
+	      const aptitude::apt::pkg_file_table &files(cache.get_pkg_file_table());
 
 	      for(pkgCache::VerFileIterator f = ver.FileList(); !f.end(); ++f)
 		{
 		  pkgCache::PkgFileIterator cur = f.File();
 		  if (!cur.end())
 		    {
-		      const char* origin = cur.Origin();
-		      if (origin != nullptr)
+		      const unsigned int origin = files.get(cur).origin;
+		      if (origin != 0)
 			{
-
 			  ref_ptr<match>
-			    m(evaluate_regexp(p,
-					      p->get_origin_regex_info(),
-					      origin,
-					      debug));
+			    m(search_info->find_pkg_file_string_match(p,
+								      p->get_origin_regex_info(),
+								      origin,
+								      cache,
+								      debug));
 
 			  if (m.valid())
 			    return m;
@@ -1324,7 +2106,7 @@ namespace aptitude
 	    else if(target.get_ver()->Priority != p->get_priority_priority())
 	      return NULL;
 	    else
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    break;
 
 	  case pattern::provides:
@@ -1365,7 +2147,7 @@ namespace aptitude
 					  debug));
 
 		    if(m.valid())
-		      return match::make_provides(p, m, prv);
+		      return make_provides_match(p, m, prv, search_info);
 		  }
 	      }
 
@@ -1420,7 +2202,7 @@ namespace aptitude
 					       debug));
 
 		      if(rval.valid())
-			return match::make_dependency(p, rval, d);
+			return make_dependency_match(p, rval, d, search_info);
 		    }
 		}
 
@@ -1465,7 +2247,7 @@ namespace aptitude
 						       debug));
 
 			      if(rval.valid())
-				return match::make_dependency(p, rval, d);
+				return make_dependency_match(p, rval, d, search_info);
 			    }
 			}
 		    }
@@ -1501,7 +2283,7 @@ namespace aptitude
 					debug));
 
 		  if(m.valid())
-		    return match::make_provides(p, m, prv);
+		    return make_provides_match(p, m, prv, search_info);
 		}
 
 	      return NULL;
@@ -1520,6 +2302,7 @@ namespace aptitude
 		      m(evaluate_regexp(p,
 					p->get_section_regex_info(),
 					ver_section,
+					search_info,
 					debug));
 
 		    if(m.valid())
@@ -1550,6 +2333,7 @@ namespace aptitude
 		  ref_ptr<match> rval = evaluate_regexp(p,
 							p->get_source_package_regex_info(),
 							ver.SourcePkgName(),
+							search_info,
 							debug);
 		  if (rval.valid())
 		    return rval;
@@ -1573,6 +2357,7 @@ namespace aptitude
 			    evaluate_regexp(p,
 					    p->get_source_package_regex_info(),
 					    pkg.Name(),
+					    search_info,
 					    debug);
 
 			  if(rval.valid())
@@ -1585,6 +2370,7 @@ namespace aptitude
 			evaluate_regexp(p,
 					p->get_source_package_regex_info(),
 					rec.SourcePkg().c_str(),
+					search_info,
 					debug);
 
 		      if(rval.valid())
@@ -1615,6 +2401,7 @@ namespace aptitude
 		  ref_ptr<match> rval = evaluate_regexp(p,
 							p->get_source_version_regex_info(),
 							ver.SourceVerStr(),
+							search_info,
 							debug);
 		  if (rval.valid())
 		    return rval;
@@ -1638,6 +2425,7 @@ namespace aptitude
 			    evaluate_regexp(p,
 					    p->get_source_version_regex_info(),
 					    ver.VerStr(),
+					    search_info,
 					    debug);
 
 			  if(rval.valid())
@@ -1650,6 +2438,7 @@ namespace aptitude
 			evaluate_regexp(p,
 					p->get_source_version_regex_info(),
 					rec.SourceVer().c_str(),
+					search_info,
 					debug);
 
 		      if(rval.valid())
@@ -1683,6 +2472,7 @@ namespace aptitude
 		    evaluate_regexp(p,
 				    p->get_tag_regex_info(),
 				    name.c_str(),
+				    search_info,
 				    debug);
 
 		  if(rval.valid())
@@ -1710,6 +2500,7 @@ namespace aptitude
 		    evaluate_regexp(p,
 				    p->get_task_regex_info(),
 				    i->c_str(),
+				    search_info,
 				    debug);
 
 		  if(m.valid())
@@ -1727,7 +2518,7 @@ namespace aptitude
                                            cache,
                                            records,
                                            debug))
-		return match::make_atomic(p);
+		return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
@@ -1740,14 +2531,14 @@ namespace aptitude
                                                   cache,
                                                   records,
                                                   debug))
-		return match::make_atomic(p);
+		return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
 	    break;
 
 	  case pattern::true_tp:
-	    return match::make_atomic(p);
+	    return make_atomic_match(p, search_info);
 	    break;
 
 	  case pattern::upgradable:
@@ -1758,7 +2549,7 @@ namespace aptitude
 	      if(!pkg.CurrentVer().end() &&
 		 cache[pkg].CandidateVer != NULL &&
 		 cache[pkg].Upgradable())
-		return match::make_atomic(p);
+		return make_atomic_match(p, search_info);
 	      else
 		return NULL;
 	    }
@@ -1800,6 +2591,7 @@ namespace aptitude
 	    return evaluate_regexp(p,
 				   p->get_version_regex_info(),
 				   target.get_version_iterator(cache).VerStr(),
+				   search_info,
 				   debug);
 	    break;
 
@@ -1807,7 +2599,7 @@ namespace aptitude
 	    if(!target.get_package_iterator(cache).VersionList().end())
 	      return NULL;
 	    else
-	      return match::make_atomic(p);
+	      return make_atomic_match(p, search_info);
 	    break;
 
 	  default:
@@ -1863,6 +2655,8 @@ namespace aptitude
 
 	      if(!m.valid())
 		return NULL;
+	      else if(search_info->get_boolean_only())
+		return m;
 	      else
 		return structural_match::make_branch(p, &m, (&m) + 1);
 	    }
@@ -1871,27 +2665,37 @@ namespace aptitude
 	  case pattern::and_tp:
 	    {
 	      const std::vector<ref_ptr<pattern> > &sub_patterns(p->get_and_patterns());
+	      // The children are evaluated cheapest-rejection first, but
+	      // their matches are stored in the order in which they
+	      // were written, so that group numbers don't change.
+	      const std::vector<std::size_t> &order(search_info->get_and_order(p));
 	      std::vector<ref_ptr<structural_match> > sub_matches;
+	      if(!search_info->get_boolean_only())
+		sub_matches.resize(sub_patterns.size());
 
-	      for(std::vector<ref_ptr<pattern> >::const_iterator it =
-		    sub_patterns.begin(); it != sub_patterns.end(); ++it)
+	      for(std::vector<std::size_t>::const_iterator it =
+		    order.begin(); it != order.end(); ++it)
 		{
-		  ref_ptr<structural_match> m(evaluate_structural(mode,
-								  (*it),
-								  the_stack,
-								  search_info,
-								  pool,
-								  cache,
-								  records,
-								  debug));
+		  ref_ptr<structural_match> m(evaluate_profiled(mode,
+								sub_patterns[*it],
+								the_stack,
+								search_info,
+								pool,
+								cache,
+								records,
+								debug));
 
 		  if(!m.valid())
 		    return NULL;
 
-		  sub_matches.push_back(m);
+		  if(!sub_matches.empty())
+		    sub_matches[*it] = m;
 		}
 
-	      return structural_match::make_branch(p, sub_matches.begin(), sub_matches.end());
+	      if(search_info->get_boolean_only())
+		return search_info->get_true_structural_match();
+	      else
+		return structural_match::make_branch(p, sub_matches.begin(), sub_matches.end());
 	    }
 	    break;
 
@@ -1916,7 +2720,11 @@ namespace aptitude
 					  records,
 					  debug));
 
-		  if(m.valid())
+		  if(!m.valid())
+		    continue;
+		  else if(search_info->get_boolean_only())
+		    return search_info->get_true_structural_match();
+		  else
 		    sub_matches.push_back(m);
 		}
 
@@ -1941,10 +2749,17 @@ namespace aptitude
 				      records,
 				      debug));
 
-	      if(m.valid())
-		return structural_match::make_branch(p, &m, (&m) + 1);
-	      else
+	      // Take the variable out of scope: variables are looked up
+	      // by stack position, and the pool might not outlive this
+	      // call.
+	      the_stack.pop_back();
+
+	      if(!m.valid())
 		return NULL;
+	      else if(search_info->get_boolean_only())
+		return m;
+	      else
+		return structural_match::make_branch(p, &m, (&m) + 1);
 	    }
 	    break;
 
@@ -1958,20 +2773,21 @@ namespace aptitude
 	      singleton_pool.push_back(matchable());
 
 	      // \todo we should perhaps store the filter matches in a
-	      // separate list.
+	      // separate list.  Until then, only ask whether the filter
+	      // matched.
 	      for(std::vector<matchable>::const_iterator it =
 		    pool.begin(); it != pool.end(); ++it)
 		{
 		  singleton_pool[0] = *it;
 
-		  if(evaluate_structural(mode,
-					 p->get_narrow_filter(),
-					 the_stack,
-					 search_info,
-					 singleton_pool,
-					 cache,
-					 records,
-					 debug).valid())
+		  if(evaluate_boolean(mode,
+				      p->get_narrow_filter(),
+				      the_stack,
+				      search_info,
+				      singleton_pool,
+				      cache,
+				      records,
+				      debug))
 		    new_pool.push_back(*it);
 		}
 
@@ -1991,6 +2807,8 @@ namespace aptitude
 
 		  if(!m.valid())
 		    return NULL;
+		  else if(search_info->get_boolean_only())
+		    return m;
 		  else
 		    return structural_match::make_branch(p, &m, (&m) + 1);
 		}
@@ -1999,24 +2817,24 @@ namespace aptitude
 
 	  case pattern::not_tp:
 	    {
-	      ref_ptr<structural_match> m(evaluate_structural(mode,
-							      p->get_not_pattern(),
-							      the_stack,
-							      search_info,
-							      pool,
-							      cache,
-							      records,
-							      debug));
-
-	      if(!m.valid())
+	      if(evaluate_boolean(mode,
+				  p->get_not_pattern(),
+				  the_stack,
+				  search_info,
+				  pool,
+				  cache,
+				  records,
+				  debug))
+		return NULL;
+	      else if(search_info->get_boolean_only())
+		return search_info->get_true_structural_match();
+	      else
 		// Report a structural match with no sub-parts.  This
 		// will lose doubly-negated information.  For now that's
 		// just too bad; we can try to recover it later.
 		return structural_match::make_branch(p,
 						     (ref_ptr<structural_match> *)0,
 						     (ref_ptr<structural_match> *)0);
-	      else
-		return NULL;
 	    }
 
 	    break;
@@ -2028,20 +2846,26 @@ namespace aptitude
 
 	      // Note: we do *not* short-circuit, in order to allow
 	      // the caller to see as much information as possible
-	      // about the match.
+	      // about the match.  Hence there's nothing to gain from
+	      // reordering the children either.  (Unless the caller
+	      // only wants to know whether the pattern matched.)
 	      for(std::vector<ref_ptr<pattern> >::const_iterator it =
 		    sub_patterns.begin(); it != sub_patterns.end(); ++it)
 		{
-		  ref_ptr<structural_match> m(evaluate_structural(mode,
-								  (*it),
-								  the_stack,
-								  search_info,
-								  pool,
-								  cache,
-								  records,
-								  debug));
+		  ref_ptr<structural_match> m(evaluate_profiled(mode,
+								(*it),
+								the_stack,
+								search_info,
+								pool,
+								cache,
+								records,
+								debug));
 
-		  if(m.valid())
+		  if(!m.valid())
+		    continue;
+		  else if(search_info->get_boolean_only())
+		    return m;
+		  else
 		    sub_matches.push_back(m);
 		}
 
@@ -2106,6 +2930,8 @@ namespace aptitude
 				      debug));
 	      if(!m.valid())
 		return NULL;
+	      else if(search_info->get_boolean_only())
+		return m;
 	      else
 		return structural_match::make_branch(p, &m, (&m) + 1);
 	    }
@@ -2161,6 +2987,7 @@ namespace aptitude
 	      {
 	      case structural_eval_all:
 		{
+		  const bool boolean_only = search_info->get_boolean_only();
 		  std::vector<std::pair<matchable, ref_ptr<match> > > matches;
 		  for(std::vector<matchable>::const_iterator it =
 			pool.begin(); it != pool.end(); ++it)
@@ -2176,12 +3003,14 @@ namespace aptitude
 			    }
 			  return NULL;
 			}
-		      else
+		      else if(!boolean_only)
 			matches.push_back(std::make_pair(*it, m));
 		    }
 
-		  if(matches.size() == 0)
+		  if(pool.empty())
 		    return NULL;
+		  else if(boolean_only)
+		    return search_info->get_true_structural_match();
 		  else
 		    return structural_match::make_leaf(p, matches.begin(), matches.end());
 		}
@@ -2202,7 +3031,11 @@ namespace aptitude
 			      print_matchable(std::cout, *it, cache);
 			      std::cout << std::endl;
 			    }
-			  // TODO: short-circuit?
+			  // In boolean-only mode the first match is
+			  // enough; otherwise every matching entry of the
+			  // pool is reported.
+			  if(search_info->get_boolean_only())
+			    return search_info->get_true_structural_match();
 			  matches.push_back(std::make_pair(*it, m));
 			}
 		    }
@@ -2225,6 +3058,47 @@ namespace aptitude
 	  }
       }
 
+      bool evaluate_boolean(structural_eval_mode mode,
+			    const ref_ptr<pattern> &p,
+			    stack &the_stack,
+			    const ref_ptr<search_cache::implementation> &search_info,
+			    const std::vector<matchable> &pool,
+			    aptitudeDepCache &cache,
+			    pkgRecords &records,
+			    bool debug)
+      {
+	boolean_only_scope scope(*search_info);
+
+	return evaluate_structural(mode, p, the_stack, search_info,
+				   pool, cache, records, debug).valid();
+      }
+
+      ref_ptr<structural_match> evaluate_profiled(structural_eval_mode mode,
+						  const ref_ptr<pattern> &p,
+						  stack &the_stack,
+						  const ref_ptr<search_cache::implementation> &search_info,
+						  const std::vector<matchable> &pool,
+						  aptitudeDepCache &cache,
+						  pkgRecords &records,
+						  bool debug)
+      {
+	if(!search_info->get_profiling())
+	  return evaluate_structural(mode, p, the_stack, search_info,
+				     pool, cache, records, debug);
+
+	const std::chrono::steady_clock::time_point start =
+	  std::chrono::steady_clock::now();
+
+	ref_ptr<structural_match> m(evaluate_structural(mode, p, the_stack, search_info,
+							pool, cache, records, debug));
+
+	const std::chrono::duration<double> elapsed =
+	  std::chrono::steady_clock::now() - start;
+	search_info->add_evaluation(p, m.valid(), elapsed.count());
+
+	return m;
+      }
+
       ref_ptr<structural_match> evaluate_toplevel(structural_eval_mode mode,
 						  const ref_ptr<pattern> &p,
 						  stack &the_stack,
@@ -2996,6 +3870,58 @@ namespace aptitude
       }
     }
 
+    namespace
+    {
+      /** \brief Test a package or version against a pattern as one
+       *  step of a search, reusing the ?bind matches of the previous
+       *  steps.
+       */
+      ref_ptr<structural_match>
+      get_match_in_search(const ref_ptr<pattern> &p,
+			  const pkgCache::PkgIterator &pkg,
+			  const pkgCache::VerIterator &ver,
+			  const ref_ptr<search_cache::implementation> &search_info,
+			  aptitudeDepCache &cache,
+			  pkgRecords &records,
+			  bool debug)
+      {
+	eassert(p.valid());
+
+	std::vector<matchable> initial_pool;
+
+	if(pkg.VersionList().end())
+	  initial_pool.push_back(matchable(pkg));
+	else if(ver.end())
+	  {
+	    for(pkgCache::VerIterator ver2 = pkg.VersionList();
+		!ver2.end(); ++ver2)
+	      {
+		initial_pool.push_back(matchable(pkg, ver2));
+	      }
+	  }
+	else
+	  {
+	    eassert(ver.ParentPkg() == pkg);
+
+	    initial_pool.push_back(matchable(pkg, ver));
+	  }
+
+	std::sort(initial_pool.begin(), initial_pool.end());
+
+	stack st;
+	st.push_back(&initial_pool);
+
+	return evaluate_profiled(structural_eval_any,
+				 p,
+				 st,
+				 search_info,
+				 initial_pool,
+				 cache,
+				 records,
+				 debug);
+      }
+    }
+
     ref_ptr<structural_match>
     get_match(const ref_ptr<pattern> &p,
 	      const pkgCache::PkgIterator &pkg,
@@ -3005,45 +3931,16 @@ namespace aptitude
 	      pkgRecords &records,
 	      bool debug)
     {
-      eassert(p.valid());
       eassert(search_info.valid());
 
-      std::vector<matchable> initial_pool;
-
-      if(pkg.VersionList().end())
-	initial_pool.push_back(matchable(pkg));
-      else if(ver.end())
-	{
-	  for(pkgCache::VerIterator ver2 = pkg.VersionList();
-	      !ver2.end(); ++ver2)
-	    {
-	      initial_pool.push_back(matchable(pkg, ver2));
-	    }
-	}
-      else
-	{
-	  eassert(ver.ParentPkg() == pkg);
-
-	  initial_pool.push_back(matchable(pkg, ver));
-	}
-
-      std::sort(initial_pool.begin(), initial_pool.end());
-
-      stack st;
-      st.push_back(&initial_pool);
-
       ref_ptr<search_cache::implementation> search_info_imp =
 	search_info.dyn_downcast<search_cache::implementation>();
       eassert(search_info_imp.valid());
 
-      return evaluate_structural(structural_eval_any,
-				 p,
-				 st,
-				 search_info_imp,
-				 initial_pool,
-				 cache,
-				 records,
-				 debug);
+      search_info_imp->begin_search();
+
+      return get_match_in_search(p, pkg, ver, search_info_imp,
+				 cache, records, debug);
     }
 
     ref_ptr<structural_match>
@@ -3059,6 +3956,37 @@ namespace aptitude
 		       search_info, cache, records, debug);
     }
 
+    bool matches(const ref_ptr<pattern> &p,
+		 const pkgCache::PkgIterator &pkg,
+		 const pkgCache::VerIterator &ver,
+		 const cwidget::util::ref_ptr<search_cache> &search_info,
+		 aptitudeDepCache &cache,
+		 pkgRecords &records,
+		 bool debug)
+    {
+      eassert(search_info.valid());
+
+      ref_ptr<search_cache::implementation> search_info_imp =
+	search_info.dyn_downcast<search_cache::implementation>();
+      eassert(search_info_imp.valid());
+
+      boolean_only_scope scope(*search_info_imp);
+
+      return get_match(p, pkg, ver, search_info, cache, records, debug).valid();
+    }
+
+    bool matches(const ref_ptr<pattern> &p,
+		 const pkgCache::PkgIterator &pkg,
+		 const cwidget::util::ref_ptr<search_cache> &search_info,
+		 aptitudeDepCache &cache,
+		 pkgRecords &records,
+		 bool debug)
+    {
+      return matches(p, pkg,
+		     pkgCache::VerIterator(cache),
+		     search_info, cache, records, debug);
+    }
+
     void xapian_info::setup(const Xapian::Database &db,
 			    const ref_ptr<pattern> &p,
 			    bool debug)
@@ -3128,6 +4056,8 @@ namespace aptitude
 	  const ref_ptr<search_cache::implementation> info = search_info.dyn_downcast<search_cache::implementation>();
 	  eassert(info.valid());
 
+	  info->begin_search();
+
 	  const xapian_info &xapian_results(info->get_toplevel_xapian_info(p, debug));
 
           const std::string filter_msg = _("Filtering packages");
@@ -3154,11 +4084,12 @@ namespace aptitude
 		  // term postings and only store match sets on a
 		  // per-toplevel basis (that might work, actually?).
 
-		  ref_ptr<structural_match> m(get_match(p, pkg,
-							info,
-							cache,
-							records,
-							debug));
+		  ref_ptr<structural_match> m(get_match_in_search(p, pkg,
+								  pkgCache::VerIterator(cache),
+								  info,
+								  cache,
+								  records,
+								  debug));
 
 		  if(m.valid())
 		    matches.push_back(std::make_pair(pkg, m));
@@ -3193,11 +4124,12 @@ namespace aptitude
 		    }
 		  else if(!(pkg.VersionList().end() && pkg.ProvidesList().end()))
 		    {
-		      ref_ptr<structural_match> m(get_match(p, pkg,
-							    info,
-							    cache,
-							    records,
-							    debug));
+		      ref_ptr<structural_match> m(get_match_in_search(p, pkg,
+								      pkgCache::VerIterator(cache),
+								      info,
+								      cache,
+								      records,
+								      debug));
 
 		      if(m.valid())
 			matches.push_back(std::make_pair(pkg, m));
@@ -3206,6 +4138,9 @@ namespace aptitude
 	    }
 
           progress_slot(progress_info::none());
+
+	  if(debug)
+	    print_bind_memo_statistics(std::cout, *info);
 	}
       catch(cwidget::util::Exception &e)
 	{
@@ -3221,6 +4156,34 @@ namespace aptitude
 	}
     }
 
+    void search(const ref_ptr<pattern> &p,
+		const ref_ptr<search_cache> &search_info,
+		std::vector<pkgCache::PkgIterator> &matches,
+		aptitudeDepCache &cache,
+		pkgRecords &records,
+                bool debug,
+                const sigc::slot<void, progress_info> &progress_slot)
+    {
+      eassert(search_info.valid());
+
+      ref_ptr<search_cache::implementation> search_info_imp =
+	search_info.dyn_downcast<search_cache::implementation>();
+      eassert(search_info_imp.valid());
+
+      // All the matches are the same placeholder, so this doesn't
+      // cost more than a vector of packages.
+      std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<structural_match> > > results;
+      {
+	boolean_only_scope scope(*search_info_imp);
+	search(p, search_info, results, cache, records, debug, progress_slot);
+      }
+
+      matches.reserve(matches.size() + results.size());
+      for(std::vector<std::pair<pkgCache::PkgIterator, ref_ptr<structural_match> > >::const_iterator
+	    it = results.begin(); it != results.end(); ++it)
+	matches.push_back(it->first);
+    }
+
     void search_versions(const ref_ptr<pattern> &p,
                          const ref_ptr<search_cache> &search_info,
                          std::vector<std::pair<pkgCache::VerIterator, ref_ptr<structural_match> > > &matches,
@@ -3242,6 +4205,8 @@ namespace aptitude
 	  const ref_ptr<search_cache::implementation> info = search_info.dyn_downcast<search_cache::implementation>();
 	  eassert(info.valid());
 
+	  info->begin_search();
+
 	  const xapian_info &xapian_results(info->get_toplevel_xapian_info(p, debug));
 
           const std::string filter_msg = _("Filtering packages");
@@ -3263,12 +4228,12 @@ namespace aptitude
                   for(pkgCache::VerIterator ver = pkg.VersionList();
                       !ver.end(); ++ver)
                     {
-                      ref_ptr<structural_match> m(get_match(p,
-                                                            pkg, ver,
-                                                            info,
-                                                            cache,
-                                                            records,
-                                                            debug));
+                      ref_ptr<structural_match> m(get_match_in_search(p,
+                                                                      pkg, ver,
+                                                                      info,
+                                                                      cache,
+                                                                      records,
+                                                                      debug));
 
                       if(m.valid())
                         matches.push_back(std::make_pair(ver, m));
@@ -3306,12 +4271,12 @@ namespace aptitude
                     for(pkgCache::VerIterator ver = pkg.VersionList();
                         !ver.end(); ++ver)
                       {
-                        ref_ptr<structural_match> m(get_match(p,
-                                                              pkg, ver,
-                                                              info,
-                                                              cache,
-                                                              records,
-                                                              debug));
+                        ref_ptr<structural_match> m(get_match_in_search(p,
+                                                                        pkg, ver,
+                                                                        info,
+                                                                        cache,
+                                                                        records,
+                                                                        debug));
 
                         if(m.valid())
                           matches.push_back(std::make_pair(ver, m));
@@ -3320,6 +4285,9 @@ namespace aptitude
 	    }
 
           progress_slot(progress_info::none());
+
+	  if(debug)
+	    print_bind_memo_statistics(std::cout, *info);
 	}
       catch(cwidget::util::Exception &e)
 	{
@@ -636,6 +636,73 @@ namespace aptitude
     public:
       /** \brief Construct a new search cache. */
       static cwidget::util::ref_ptr<search_cache> create();
+
+      /** \brief Statistics about the evaluation of one sub-pattern,
+       *  collected while profiling is enabled.
+       *
+       *  Statistics are kept for top-level patterns and for the
+       *  children of ?and and ?or patterns.
+       */
+      struct subpattern_profile
+      {
+	/** \brief The sub-pattern that was evaluated. */
+	cwidget::util::ref_ptr<pattern> p;
+
+	/** \brief The estimated cost of one evaluation, in arbitrary
+	 *  units (testing a flag of a package costs about one unit).
+	 */
+	double estimated_cost;
+
+	/** \brief The estimated fraction of evaluations that match. */
+	double estimated_selectivity;
+
+	/** \brief How many times the sub-pattern was evaluated. */
+	unsigned long evaluations;
+
+	/** \brief How many of those evaluations produced a match. */
+	unsigned long matches;
+
+	/** \brief The total time spent evaluating the sub-pattern
+	 *  (including its own children), in seconds.
+	 */
+	double elapsed;
+      };
+
+      /** \brief Enable or disable the collection of per-subpattern
+       *  statistics (disabled by default).
+       */
+      void set_profiling(bool enabled);
+
+      /** \brief Retrieve the statistics collected so far, in the
+       *  order in which the sub-patterns were first evaluated.
+       */
+      const std::vector<subpattern_profile> &get_profile() const;
+
+      /** \brief Statistics about the memo table in which the matches
+       *  of ?bind patterns are stored.
+       *
+       *  A ?bind pattern is evaluated once for each distinct set of
+       *  values of the variables that it refers to; the memo table is
+       *  emptied when the state of the package cache changes, and
+       *  along with these statistics whenever a new search, or a new
+       *  match against a single package, starts.
+       */
+      struct bind_memo_statistics
+      {
+	/** \brief How many times a ?bind pattern was evaluated. */
+	unsigned long lookups;
+
+	/** \brief How many of those evaluations were found in the
+	 *  memo table.
+	 */
+	unsigned long hits;
+
+	/** \brief The number of matches currently memoized. */
+	std::size_t entries;
+      };
+
+      /** \brief Retrieve the statistics of the ?bind memo table. */
+      bind_memo_statistics get_bind_memo_statistics() const;
     };
 
     /** \brief Test a version of a package against a pattern.
@@ -687,6 +754,50 @@ namespace aptitude
 	      pkgRecords &records,
 	      bool debug = false);
 
+    /** \brief Test whether a version of a package matches a
+     *  pattern.
+     *
+     *  This is equivalent to testing whether get_match() returns a
+     *  valid match, but no match objects are built while evaluating
+     *  the pattern, and ?or patterns stop at their first matching
+     *  alternative.  Use it when the details of the match are not
+     *  needed (limits, filters, hints, ...).
+     *
+     *  \param p   The pattern to execute.
+     *  \param pkg The package to compare.
+     *  \param ver The version of pkg to compare, or an end iterator to match the
+     *             package itself.
+     *  \param search_info  Where to store "side information"
+     *                      associated with this search.
+     *  \param cache   The cache in which to search.
+     *  \param records The package records with which to perform the match.
+     *  \param debug   If \b true, information about the search process
+     *                 will be printed to standard output.
+     *
+     *  \return \b true if the package matches.
+     */
+    bool matches(const cwidget::util::ref_ptr<pattern> &p,
+		 const pkgCache::PkgIterator &pkg,
+		 const pkgCache::VerIterator &ver,
+		 const cwidget::util::ref_ptr<search_cache> &search_info,
+		 aptitudeDepCache &cache,
+		 pkgRecords &records,
+		 bool debug = false);
+
+    /** \brief Test whether a package matches a pattern.
+     *
+     *  This tests the package as a package, not as a version.  See
+     *  the other overload for details.
+     *
+     *  \return \b true if the package matches.
+     */
+    bool matches(const cwidget::util::ref_ptr<pattern> &p,
+		 const pkgCache::PkgIterator &pkg,
+		 const cwidget::util::ref_ptr<search_cache> &search_info,
+		 aptitudeDepCache &cache,
+		 pkgRecords &records,
+		 bool debug = false);
+
     /** \brief Retrieve all the packages matching the given pattern.
      *
      *  This may use Xapian or other indices to accelerate the search
@@ -711,6 +822,21 @@ namespace aptitude
                 const sigc::slot<void, aptitude::util::progress_info> &progress_slot
                   = sigc::slot<void, aptitude::util::progress_info>());
 
+    /** \brief Retrieve all the packages matching the given pattern,
+     *  without information about how they matched.
+     *
+     *  Like the other overload, but no match objects are built (see
+     *  matches()).
+     */
+    void search(const cwidget::util::ref_ptr<pattern> &p,
+		const cwidget::util::ref_ptr<search_cache> &search_info,
+		std::vector<pkgCache::PkgIterator> &matches,
+		aptitudeDepCache &cache,
+		pkgRecords &records,
+		bool debug = false,
+                const sigc::slot<void, aptitude::util::progress_info> &progress_slot
+                  = sigc::slot<void, aptitude::util::progress_info>());
+
     /** \brief Retrieve all the package versions matching the given pattern.
      *
      *  This may use Xapian or other indices to accelerate the search
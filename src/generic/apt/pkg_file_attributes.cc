@@ -0,0 +1,95 @@
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+#include "pkg_file_attributes.h"
+
+#include <loggers.h>
+
+#include <apt-pkg/indexfile.h>
+#include <apt-pkg/sourcelist.h>
+
+#include <regex>
+
+using aptitude::Loggers;
+
+
+namespace aptitude {
+namespace apt {
+
+
+namespace {
+
+/** Whether the given site is security.debian.org or one of its mirrors */
+bool is_security_site(const char *site)
+{
+  static const std::regex site_regex { "^security\\.(.+\\.)?debian.org$" };
+
+  return site != nullptr && std::regex_search(site, site_regex);
+}
+
+}
+
+
+unsigned int pkg_file_table::intern(const char *s)
+{
+  if (s == nullptr)
+    return 0;
+
+  for (unsigned int i = 1; i < strings.size(); ++i)
+    {
+      if (strings[i] == s)
+	return i;
+    }
+
+  strings.push_back(s);
+  return strings.size() - 1;
+}
+
+pkg_file_table::pkg_file_table(pkgCache &cache, pkgSourceList *sources)
+  : files(cache.Head().PackageFileCount),
+    strings(1)
+{
+  for (pkgCache::PkgFileIterator f = cache.FileBegin(); !f.end(); ++f)
+    {
+      pkg_file_attributes &attrs = files[f->ID];
+
+      const char *label = f.Label();
+      attrs.security = is_security_site(f.Site()) &&
+	label != nullptr && std::string(label) == "Debian-Security";
+
+      // Files without an index correspond to the currently installed
+      // packages, which are always "trusted".
+      pkgIndexFile *index;
+      attrs.trusted = sources == nullptr ||
+	!sources->FindIndex(f, index) || index->IsTrusted();
+
+      attrs.archive = intern(f.Archive());
+      attrs.origin = intern(f.Origin());
+      attrs.label = intern(label);
+    }
+
+  LOG_DEBUG(Loggers::getAptitudeAptCache(),
+	    "Built the attribute table of " << files.size()
+	    << " package files with " << get_num_strings() - 1 << " distinct strings");
+}
+
+
+}
+}
@@ -0,0 +1,122 @@
+// pkg_file_attributes.h                  -*-c++-*-
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+/** @file
+ *
+ * Precomputed attributes of the package files (Packages indices and
+ * the dpkg status file) of the cache.
+ *
+ */
+
+#ifndef APTITUDE_GENERIC_APT_PKG_FILE_ATTRIBUTES_H
+#define APTITUDE_GENERIC_APT_PKG_FILE_ATTRIBUTES_H
+
+#include <apt-pkg/pkgcache.h>
+
+#include <string>
+#include <vector>
+
+
+class pkgSourceList;
+
+
+namespace aptitude {
+namespace apt {
+
+
+/** Attributes of one package file
+ *
+ * Strings are stored as identifiers into the string table of
+ * pkg_file_table, so that two files with the same archive (say) have
+ * the same identifier.  The identifier 0 means that the field is not
+ * set in the package file.
+ */
+struct pkg_file_attributes
+{
+  /** The file comes from the Debian security archive */
+  bool security;
+  /** The file is the status file, or comes from a trusted source */
+  bool trusted;
+  /** Identifier of Archive (the suite, e.g. "unstable") */
+  unsigned int archive;
+  /** Identifier of Origin */
+  unsigned int origin;
+  /** Identifier of Label */
+  unsigned int label;
+};
+
+
+/** Table of the attributes of every package file of a cache
+ *
+ * There are only a few dozen package files, but the attributes of the
+ * files of each version are consulted for every version when
+ * classifying or searching packages; looking them up here avoids
+ * comparing strings and searching the source list every time.
+ *
+ * Each aptitudeDepCache builds the table of its files when it is
+ * created (see aptitudeDepCache::get_pkg_file_table()); the table is
+ * not modified afterwards, so any thread may read it for as long as
+ * the cache exists.
+ */
+class pkg_file_table
+{
+  /** Attributes, indexed by the ID of each package file */
+  std::vector<pkg_file_attributes> files;
+
+  /** Distinct strings of all of the files, indexed by identifier */
+  std::vector<std::string> strings;
+
+  unsigned int intern(const char *s);
+
+public:
+  /** Compute the attributes of every package file in cache
+   *
+   * @param cache The cache whose files are described
+   *
+   * @param sources The source list used to determine trust, or @b
+   * nullptr to consider every file trusted
+   */
+  pkg_file_table(pkgCache &cache, pkgSourceList *sources);
+
+  /** @return The attributes of the given package file */
+  const pkg_file_attributes& get(const pkgCache::PkgFileIterator &file) const
+  {
+    return files[file->ID];
+  }
+
+  /** @return The string with the given identifier ("" for 0) */
+  const std::string& get_string(unsigned int id) const
+  {
+    return strings[id];
+  }
+
+  /** @return The number of string identifiers, including 0 */
+  unsigned int get_num_strings() const
+  {
+    return strings.size();
+  }
+};
+
+
+}
+}
+
+#endif
@@ -28,6 +28,8 @@
 #include "aptitude_resolver_universe.h"
 #include "config_signal.h"
 #include "dump_packages.h"
+#include "resolver_solution_cache.h"
+#include "resolver_solution_encoding.h"
 
 #include <boost/format.hpp>
 
@@ -38,20 +40,32 @@
 #include <generic/util/undo.h>
 
 #include <apt-pkg/error.h>
+#include <apt-pkg/fileutl.h>
 #include <apt-pkg/strutl.h>
 
 #include <sigc++/bind.h>
 #include <sigc++/functors/mem_fun.h>
 
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <sstream>
 
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 using aptitude::Loggers;
+using aptitude::apt::encode_dep;
+using aptitude::apt::encode_version;
 
 const int defaultStepLimit = 500000;
 
+/** The number of dependencies listed in a profile of the resolver's
+ *  search effort.
+ */
+const size_t profileReportLimit = 20;
+
 class resolver_manager::resolver_interaction
 {
 public:
@@ -174,6 +188,7 @@ resolver_manager::resolver_manager(aptitudeCacheFile *_cache_file,
    ticks_since_last_solution(0),
    solution_search_aborted(false),
    selected_solution(0),
+   cached_solution_count(0),
    background_thread_killed(false),
    background_thread_running(false),
    resolver_null(true),
@@ -181,7 +196,11 @@ resolver_manager::resolver_manager(aptitudeCacheFile *_cache_file,
    background_thread_in_resolver(false),
    initial_installations(_initial_installations),
    resolver_thread(NULL),
-   mutex(cwidget::threads::mutex::attr(PTHREAD_MUTEX_RECURSIVE))
+   mutex(cwidget::threads::mutex::attr(PTHREAD_MUTEX_RECURSIVE)),
+   search_graph_account("resolver search graph",
+			[this] { return get_search_graph_memory(); }),
+   promotions_account("resolver promotions",
+		      [this] { return get_promotions_memory(); })
 {
   (*cache_file)->pre_package_state_changed.connect(sigc::mem_fun(this, &resolver_manager::discard_resolver));
   (*cache_file)->package_state_changed.connect(sigc::mem_fun0(this, &resolver_manager::maybe_create_resolver));
@@ -212,6 +231,33 @@ resolver_manager::~resolver_manager()
   delete undos;
 }
 
+aptitude::util::memory_usage resolver_manager::get_search_graph_memory() const
+{
+  cwidget::threads::mutex::lock l(mutex);
+
+  if(resolver == NULL)
+    return aptitude::util::memory_usage();
+
+  // Only the steps themselves are counted; the sets that they refer
+  // to are largely shared between steps.
+  const aptitude_resolver::queue_counts c = resolver->get_counts();
+  return aptitude::util::memory_usage(c.steps * sizeof(aptitude_resolver::step),
+				      c.steps);
+}
+
+aptitude::util::memory_usage resolver_manager::get_promotions_memory() const
+{
+  cwidget::threads::mutex::lock l(mutex);
+
+  if(resolver == NULL)
+    return aptitude::util::memory_usage();
+
+  const aptitude_resolver::queue_counts c = resolver->get_counts();
+  const std::size_t count = c.promotions + c.conflicts;
+  return aptitude::util::memory_usage(count * sizeof(aptitude_resolver::promotion),
+				      count);
+}
+
 void resolver_manager::reset_resolver(bool consider_policybroken)
 {
   discard_resolver();
@@ -864,6 +910,7 @@ void resolver_manager::discard_resolver()
     solution_search_aborted = false;
     solution_search_abort_msg.clear();
     selected_solution = 0;
+    cached_solution_count = 0;
   }
 
   resolver = NULL;
@@ -967,6 +1014,9 @@ void resolver_manager::create_resolver()
 				 (*cache_file),
 				 cache_file->Policy);
 
+  resolver->set_beam_width(std::max(0, aptcfg->FindI(PACKAGE "::ProblemResolver::BeamWidth", 0)));
+  resolver->set_profile(aptcfg->FindB(PACKAGE "::ProblemResolver::Profile", false));
+
   // Set auto flags for initial installations as if the installs were
   // done by the user.  i.e., if the package is currently installed,
   // we use the current value of the Auto flag; otherwise we treat it
@@ -1024,6 +1074,24 @@ void resolver_manager::create_resolver()
 				aptcfg->FindI(PACKAGE "::ProblemResolver::OptionalScore", 1),
 				aptcfg->FindI(PACKAGE "::ProblemResolver::ExtraScore", 0));
 
+  const std::string solution_cache_dir =
+    aptcfg->Find(PACKAGE "::ProblemResolver::Solution-Cache-Directory", "");
+  // A cached solution would skip the search that a profile is
+  // supposed to measure.
+  if(solution_cache_dir.empty() ||
+     aptcfg->FindB(PACKAGE "::ProblemResolver::Profile", false))
+    solution_cache.reset();
+  else
+    {
+      solution_cache.reset(new aptitude::apt::resolver_solution_cache(solution_cache_dir));
+
+      cwidget::threads::mutex::lock l2(solutions_mutex);
+      solution_cache_key = aptitude::apt::resolver_solution_cache::chain_key("", get_problem_fingerprint());
+      LOG_DEBUG(Loggers::getAptitudeResolver(),
+		"Using the solution cache in " << solution_cache_dir
+		<< "; the key of the problem is " << solution_cache_key);
+    }
+
   {
     cwidget::threads::mutex::lock l2(background_control_mutex);
     resolver_null = false;
@@ -1131,6 +1199,7 @@ resolver_manager::state resolver_manager::state_snapshot()
       rval.closed_size    = c.closed;
       rval.deferred_size  = c.deferred;
       rval.conflicts_size = c.conflicts;
+      rval.pruned_size    = c.pruned;
       rval.solutions_exhausted = c.finished;
     }
   else
@@ -1139,6 +1208,7 @@ resolver_manager::state resolver_manager::state_snapshot()
       rval.closed_size    = 0;
       rval.deferred_size  = 0;
       rval.conflicts_size = 0;
+      rval.pruned_size    = 0;
 
       rval.solutions_exhausted = false;
     }
@@ -1146,6 +1216,221 @@ resolver_manager::state resolver_manager::state_snapshot()
   return rval;
 }
 
+std::string resolver_manager::get_problem_fingerprint() const
+{
+  std::ostringstream out;
+
+  // The package lists and the status file that the cache was built
+  // from; these determine which versions and dependencies exist.
+  // The priority of each file reflects the default release and the
+  // pins on origins.
+  pkgDepCache::Policy &policy = (*cache_file)->GetPolicy();
+  for(pkgCache::PkgFileIterator f = (*cache_file)->GetCache().FileBegin(); !f.end(); ++f)
+    out << "file " << (f.FileName() == NULL ? "" : f.FileName())
+	<< " " << f->Size << " " << f->mtime
+	<< " " << policy.GetPriority(f) << "\n";
+
+  // The preferences files, which hold the pins on packages.
+  std::vector<std::string> preferences =
+    GetListOfFilesInDir(_config->FindDir("Dir::Etc::preferencesparts"), "pref", true, true);
+  preferences.insert(preferences.begin(), _config->FindFile("Dir::Etc::preferences"));
+  for(const std::string &name : preferences)
+    {
+      struct stat buf;
+      if(stat(name.c_str(), &buf) == 0)
+	out << "preferences " << name << " " << buf.st_size
+	    << " " << buf.st_mtime << "\n";
+    }
+
+  // The states that the resolver starts from.  Packages that are not
+  // installed and have no pending change are left out: their
+  // candidates follow from the package lists and the pins.
+  for(pkgCache::PkgIterator p = (*cache_file)->PkgBegin(); !p.end(); ++p)
+    {
+      const pkgCache::VerIterator instver((*cache_file)[p].InstVerIter(*cache_file));
+      const pkgCache::VerIterator candver((*cache_file)[p].CandidateVerIter(*cache_file));
+      const aptitudeDepCache::aptitude_state &estate((*cache_file)->get_ext_state(p));
+
+      if(instver == p.CurrentVer() && p.CurrentVer().end() &&
+	 estate.selection_state != pkgCache::State::Hold && estate.forbidver.empty() &&
+	 estate.candver.empty())
+	continue;
+
+      out << "pkg " << p.FullName(false)
+	  << " " << (instver.end() ? "-" : instver.VerStr())
+	  << " " << (candver.end() ? "-" : candver.VerStr())
+	  << " " << (int)estate.selection_state
+	  << " " << estate.forbidver
+	  << " " << (((*cache_file)[p].Flags & pkgCache::Flag::Auto) != 0)
+	  << "\n";
+    }
+
+  for(imm::map<aptitude_resolver_package, aptitude_resolver_version>::const_iterator it =
+	initial_installations.begin(); it != initial_installations.end(); ++it)
+    out << "initial " << encode_version(it->second) << "\n";
+
+  // The configuration of the resolver, including the cost settings
+  // and the hints, except for the options that don't affect which
+  // solutions are found.
+  const Configuration::Item * const root = aptcfg->Tree(PACKAGE "::ProblemResolver");
+  std::vector<const Configuration::Item *> pending;
+  if(root != NULL && root->Child != NULL)
+    pending.push_back(root->Child);
+  while(!pending.empty())
+    {
+      const Configuration::Item * const item = pending.back();
+      pending.pop_back();
+
+      if(item->Next != NULL)
+	pending.push_back(item->Next);
+      if(item->Child != NULL)
+	pending.push_back(item->Child);
+
+      if(item->Tag == "Trace-Directory" || item->Tag == "Trace-File" ||
+	 item->Tag == "StepLimit" || item->Tag == "Solution-Cache-Directory")
+	continue;
+
+      out << "config " << item->FullTag() << "=" << item->Value << "\n";
+    }
+
+  const char * const options[] = {
+    "APT::Install-Recommends",
+    "APT::Install-Suggests",
+    PACKAGE "::Recommends-Important",
+    PACKAGE "::Suggests-Important",
+  };
+  for(const char * const option : options)
+    out << "config " << option << "=" << aptcfg->Find(option, "") << "\n";
+
+  return out.str();
+}
+
+std::string resolver_manager::describe_interactions(const std::vector<resolver_interaction> &interactions)
+{
+  std::string rval;
+
+  for(std::vector<resolver_interaction>::const_iterator it =
+	interactions.begin(); it != interactions.end(); ++it)
+    {
+      switch(it->get_type())
+	{
+	case resolver_interaction::reject_version:
+	  rval += "reject " + encode_version(it->get_version());
+	  break;
+	case resolver_interaction::unreject_version:
+	  rval += "unreject " + encode_version(it->get_version());
+	  break;
+	case resolver_interaction::mandate_version:
+	  rval += "mandate " + encode_version(it->get_version());
+	  break;
+	case resolver_interaction::unmandate_version:
+	  rval += "unmandate " + encode_version(it->get_version());
+	  break;
+	case resolver_interaction::harden_dep:
+	  rval += "harden " + encode_dep(it->get_dep());
+	  break;
+	case resolver_interaction::unharden_dep:
+	  rval += "unharden " + encode_dep(it->get_dep());
+	  break;
+	case resolver_interaction::approve_broken_dep:
+	  rval += "approve-broken " + encode_dep(it->get_dep());
+	  break;
+	case resolver_interaction::unapprove_broken_dep:
+	  rval += "unapprove-broken " + encode_dep(it->get_dep());
+	  break;
+	case resolver_interaction::undo:
+	  rval += "undo";
+	  break;
+	}
+
+      rval += "\n";
+    }
+
+  return rval;
+}
+
+bool resolver_manager::find_cached_solution(const std::string &key,
+					    generic_solution<aptitude_universe> &sol,
+					    bool &is_keep_all_solution)
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeResolver());
+
+  aptitude::apt::cached_resolver_outcome outcome;
+  if(!solution_cache->lookup(key, outcome))
+    {
+      LOG_TRACE(logger, "No cached solution for the key " << key);
+      return false;
+    }
+
+  if(!outcome.found)
+    {
+      LOG_DEBUG(logger, "The solution cache records that there are no more solutions for the key " << key);
+      throw NoMoreSolutions();
+    }
+
+  // The key already covers the problem, so checking the solution is
+  // only a safety net against stale or damaged entries.
+  generic_solution<aptitude_universe> rval;
+  std::string why;
+  if(!aptitude::apt::decode_solution(outcome, *cache_file,
+				     resolver->get_initial_state(),
+				     resolver->get_initial_broken(),
+				     rval, why))
+    {
+      LOG_WARN(logger, "Discarding the cached solution " << key << ": " << why << ".");
+      return false;
+    }
+
+  LOG_DEBUG(logger, "Using the cached solution " << key << ": " << rval);
+
+  sol = rval;
+  is_keep_all_solution = outcome.is_keep_all;
+  return true;
+}
+
+generic_solution<aptitude_universe>
+resolver_manager::find_new_solution(int max_steps, const std::string &key,
+				    std::set<aptitude_resolver_package> &visited_packages)
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeResolver());
+
+  generic_solution<aptitude_universe> sol;
+  while(true)
+    {
+      try
+	{
+	  sol = resolver->find_next_solution(max_steps, &visited_packages);
+	}
+      catch(const NoMoreSolutions&)
+	{
+	  if(!key.empty())
+	    solution_cache->store(key, aptitude::apt::cached_resolver_outcome());
+	  throw;
+	}
+
+      // Solutions that were read from the cache were never produced
+      // by this resolver, so it may produce them again.
+      bool duplicate = false;
+      {
+	cwidget::threads::mutex::lock sol_l(solutions_mutex);
+	if(cached_solution_count > 0)
+	  for(std::vector<const solution_information *>::const_iterator it =
+		solutions.begin(); it != solutions.end() && !duplicate; ++it)
+	    duplicate = (*it)->get_solution()->get_choices() == sol.get_choices();
+      }
+
+      if(!duplicate)
+	break;
+
+      LOG_DEBUG(logger, "Skipping a solution that was already read from the cache: " << sol);
+    }
+
+  if(!key.empty())
+    solution_cache->store(key, aptitude::apt::encode_solution(sol, sol.get_choices() == resolver->get_keep_all_solution()));
+
+  return sol;
+}
+
 const aptitude_resolver::solution *
 resolver_manager::do_get_solution(int max_steps, unsigned int solution_num,
 				  std::set<aptitude_resolver_package> &visited_packages)
@@ -1156,22 +1441,38 @@ resolver_manager::do_get_solution(int max_steps, unsigned int solution_num,
 
   while(solution_num >= solutions.size())
     {
+      std::string key;
+      if(solution_cache.get() != NULL)
+	key = aptitude::apt::resolver_solution_cache::chain_key(solution_cache_key,
+								describe_interactions(actions_since_last_solution));
+
       sol_l.release();
 
       try
 	{
-	  generic_solution<aptitude_universe> sol = resolver->find_next_solution(max_steps, &visited_packages);
+	  generic_solution<aptitude_universe> sol;
+	  bool is_keep_all_solution = false;
+	  const bool from_cache = !key.empty() &&
+	    find_cached_solution(key, sol, is_keep_all_solution);
 
-	  sol_l.acquire();
+	  if(!from_cache)
+	    {
+	      sol = find_new_solution(max_steps, key, visited_packages);
+	      is_keep_all_solution =
+		(sol.get_choices() == resolver->get_keep_all_solution());
+	    }
 
-	  bool is_keep_all_solution =
-	    (sol.get_choices() == resolver->get_keep_all_solution());
+	  sol_l.acquire();
 
 	  solutions.push_back(new solution_information(new std::vector<resolver_interaction>(actions_since_last_solution),
-						       ticks_since_last_solution + max_steps,
+						       ticks_since_last_solution + (from_cache ? 0 : max_steps),
 						       new aptitude_resolver::solution(sol.clone()),
 						       is_keep_all_solution));
 	  actions_since_last_solution.clear();
+	  if(!key.empty())
+	    solution_cache_key = key;
+	  if(from_cache)
+	    ++cached_solution_count;
 	  sol_l.release();
 	}
       catch(const InterruptedException &e)
@@ -1722,6 +2023,15 @@ void resolver_manager::tweak_score(const pkgCache::PkgIterator &pkg,
     res_ver = aptitude_resolver_version::make_install(ver, *cache_file);
 
   resolver->add_version_score(res_ver, score);
+
+  if(solution_cache.get() != NULL)
+    {
+      std::ostringstream tweak;
+      tweak << "tweak " << encode_version(res_ver) << " " << score;
+
+      cwidget::threads::mutex::lock l2(solutions_mutex);
+      solution_cache_key = aptitude::apt::resolver_solution_cache::chain_key(solution_cache_key, tweak.str());
+    }
 }
 
 void resolver_manager::dump(std::ostream &out)
@@ -1745,6 +2055,22 @@ void resolver_manager::dump(std::ostream &out)
   resolver->dump_scores(out);
 
   out << "EXPECT ( " << aptcfg->FindI(PACKAGE "::ProblemResolver::StepLimit", defaultStepLimit) << " ANY )" << std::endl;
+
+  // The profile is written as comments, so that the dump can still
+  // be replayed by the resolver test harness.
+  if(aptcfg->FindB(PACKAGE "::ProblemResolver::Profile", false))
+    resolver->dump_dep_efforts(out, profileReportLimit, "# ");
+}
+
+void resolver_manager::dump_profile(std::ostream &out)
+{
+  cwidget::threads::mutex::lock l(mutex);
+  background_suspender bs(*this);
+
+  if(!resolver_exists())
+    return;
+
+  resolver->dump_dep_efforts(out, profileReportLimit, "");
 }
 
 void resolver_manager::maybe_start_solution_calculation(const std::shared_ptr<background_continuation> &k,
@@ -35,9 +35,11 @@
 #include <memory>
 #include <queue>
 #include <set>
+#include <string>
 #include <vector>
 
 #include <generic/util/immset.h>
+#include <generic/util/memory_accounting.h>
 #include <generic/util/post_thunk.h>
 
 /** \brief A higher-level resolver interface
@@ -64,6 +66,14 @@ class aptitude_resolver;
 class undo_group;
 class undo_list;
 
+namespace aptitude
+{
+  namespace apt
+  {
+    class resolver_solution_cache;
+  }
+}
+
 /** Manages a resolver for a single cache object.  When broken
  *  packages arise, a new resolver is created; whenever the state of a
  *  package changes, the resolver is deleted and reset.  While a
@@ -151,6 +161,11 @@ public:
 
     /** The number of conflicts discovered by the resolver. */
     size_t conflicts_size;
+
+    /** The number of steps dropped from the open queue by beam
+     *  search (see Aptitude::ProblemResolver::BeamWidth).
+     */
+    size_t pruned_size;
   };
 
 private:
@@ -300,6 +315,30 @@ private:
   /** The index of the currently selected solution. */
   unsigned int selected_solution;
 
+  /** \brief The on-disk cache of solutions, or \b NULL if
+   *  PACKAGE::ProblemResolver::Solution-Cache-Directory is not set.
+   *
+   *  Set up when the resolver is created.
+   */
+  std::unique_ptr<aptitude::apt::resolver_solution_cache> solution_cache;
+
+  /** \brief The cache key of the last generated solution, or of the
+   *  problem itself if no solution has been generated yet.
+   *
+   *  The key of each solution chains this key with the interactions
+   *  that preceded the solution.  Protected by solutions_mutex.
+   */
+  std::string solution_cache_key;
+
+  /** \brief The number of solutions that were read from the
+   *  solution cache instead of being computed.
+   *
+   *  The resolver never saw these solutions, so it might find them
+   *  again; solutions that it finds twice are skipped.  Protected by
+   *  solutions_mutex.
+   */
+  unsigned int cached_solution_count;
+
   /** Save approved broken [soft] deps like Recommends from previous solutions
    * of the resolver, so we can break out of the loop when the resolver is
    * discarded and e-reated as part of applying a solution.
@@ -384,6 +423,15 @@ private:
    */
   mutable cwidget::threads::mutex mutex;
 
+  /** Memory accounts for the search graph and the promotions of the
+   *  active resolver.
+   */
+  aptitude::util::memory_account search_graph_account;
+  aptitude::util::memory_account promotions_account;
+
+  aptitude::util::memory_usage get_search_graph_memory() const;
+  aptitude::util::memory_usage get_promotions_memory() const;
+
   void discard_resolver();
   void create_resolver();
 
@@ -424,6 +472,48 @@ private:
   void dump_visited_packages(const std::set<aptitude_resolver_package> &visited_packages,
 			     int solution_number);
 
+  /** \brief Describe everything besides the user's interactions
+   *  that the resolver's solutions depend on: the package lists, the
+   *  initial package states, and the resolver configuration.
+   *
+   *  The digest of this description is the key of the first solution
+   *  in the solution cache.
+   */
+  std::string get_problem_fingerprint() const;
+
+  /** \brief Describe a sequence of interactions, to compute the cache
+   *  key of the solution that follows them.
+   */
+  static std::string describe_interactions(const std::vector<resolver_interaction> &interactions);
+
+  /** \brief Look up a solution in the solution cache and check it
+   *  against the current problem.
+   *
+   *  Must run in the background thread, like do_get_solution().
+   *
+   *  \param key                   The key of the solution.
+   *  \param sol                   Set to the cached solution if it
+   *                               is found and valid.
+   *  \param is_keep_all_solution  Set to \b true if sol is the
+   *                               "keep-all" solution.
+   *
+   *  \return \b true if sol was set.
+   *
+   *  \throw NoMoreSolutions if the cache records that the search was
+   *  exhausted at this point.
+   */
+  bool find_cached_solution(const std::string &key,
+			    generic_solution<aptitude_universe> &sol,
+			    bool &is_keep_all_solution);
+
+  /** \brief Run the resolver to find the next solution, and store
+   *  the outcome in the solution cache under the given key unless it
+   *  is empty.
+   */
+  generic_solution<aptitude_universe>
+  find_new_solution(int max_steps, const std::string &key,
+		    std::set<aptitude_resolver_package> &visited_packages);
+
   /** Low-level code to get a solution; it does not take the global
    *  lock, does not stop a background thread, and must run in the
    *  background.  It is called by background_thread_execution.
@@ -767,6 +857,13 @@ public:
    */
   void dump(std::ostream &out);
 
+  /** If a resolver exists, write a report of the dependencies that
+   *  took the most search effort to the given stream.  The report is
+   *  only filled in if Aptitude::ProblemResolver::Profile was set
+   *  when the resolver was created.
+   */
+  void dump_profile(std::ostream &out);
+
   /** This signal is emitted when the selected solution changes, when
    *  the user takes an action that might change the number of
    *  available solutions (such as un-rejecting a package), and when a
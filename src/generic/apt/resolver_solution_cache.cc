@@ -0,0 +1,147 @@
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+#include "resolver_solution_cache.h"
+
+#include <loggers.h>
+
+#include <generic/util/util.h>
+
+#include <apt-pkg/hashes.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+using aptitude::Loggers;
+
+
+namespace aptitude {
+namespace apt {
+
+
+namespace {
+
+/** The first line of every entry; bump it when the format changes */
+const char entry_magic[] = "aptitude-resolver-solution 2";
+
+}
+
+
+resolver_solution_cache::resolver_solution_cache(const std::string &_directory)
+  : directory(_directory)
+{
+}
+
+std::string resolver_solution_cache::get_path(const std::string &key) const
+{
+  return directory + "/" + key;
+}
+
+bool resolver_solution_cache::lookup(const std::string &key, cached_resolver_outcome &outcome) const
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeResolver());
+
+  std::ifstream in(get_path(key).c_str());
+  if (!in)
+    return false;
+
+  std::string magic, found, keep_all;
+  cached_resolver_outcome rval;
+  if (!std::getline(in, magic) || magic != entry_magic ||
+      !std::getline(in, found) || !std::getline(in, keep_all) ||
+      !(in >> rval.score) || !in.ignore(1) ||
+      !std::getline(in, rval.cost) ||
+      (found != "found" && found != "exhausted") ||
+      (keep_all != "keep-all" && keep_all != "changes"))
+    {
+      LOG_WARN(logger, "Ignoring the malformed resolver cache entry " << get_path(key));
+      return false;
+    }
+
+  rval.found = found == "found";
+  rval.is_keep_all = keep_all == "keep-all";
+
+  std::string choice;
+  while (std::getline(in, choice))
+    rval.choices.push_back(choice);
+
+  outcome = rval;
+  return true;
+}
+
+void resolver_solution_cache::store(const std::string &key, const cached_resolver_outcome &outcome) const
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeResolver());
+
+  if (!aptitude::util::mkdir_parents(directory, 0755))
+    {
+      LOG_WARN(logger, "Unable to create the resolver cache directory " << directory);
+      return;
+    }
+
+  const std::string path = get_path(key);
+  std::ostringstream tmp_path;
+  tmp_path << path << ".tmp." << getpid();
+
+  {
+    std::ofstream out(tmp_path.str().c_str());
+    out << entry_magic << "\n"
+	<< (outcome.found ? "found" : "exhausted") << "\n"
+	<< (outcome.is_keep_all ? "keep-all" : "changes") << "\n"
+	<< outcome.score << "\n"
+	<< outcome.cost << "\n";
+    for (std::vector<std::string>::const_iterator it = outcome.choices.begin();
+	 it != outcome.choices.end(); ++it)
+      out << *it << "\n";
+
+    if (!out.flush())
+      {
+	LOG_WARN(logger, "Unable to write the resolver cache entry " << tmp_path.str());
+	unlink(tmp_path.str().c_str());
+	return;
+      }
+  }
+
+  if (rename(tmp_path.str().c_str(), path.c_str()) != 0)
+    {
+      LOG_WARN(logger, "Unable to rename " << tmp_path.str() << " to " << path);
+      unlink(tmp_path.str().c_str());
+    }
+}
+
+std::string resolver_solution_cache::chain_key(const std::string &key, const std::string &text)
+{
+  Hashes hashes(Hashes::SHA256SUM);
+  hashes.Add(reinterpret_cast<const unsigned char *>(key.data()), key.size());
+  // Separate the two parts, so that moving text between them changes
+  // the digest.
+  hashes.Add(reinterpret_cast<const unsigned char *>("\n"), 1);
+  hashes.Add(reinterpret_cast<const unsigned char *>(text.data()), text.size());
+
+  return hashes.GetHashString(Hashes::SHA256SUM).HashValue();
+}
+
+
+}
+}
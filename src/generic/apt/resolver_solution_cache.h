@@ -0,0 +1,115 @@
+// resolver_solution_cache.h              -*-c++-*-
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+/** @file
+ *
+ * On-disk store of the outcomes of previous runs of the problem
+ * resolver, keyed by a fingerprint of the problem that was solved.
+ *
+ */
+
+#ifndef APTITUDE_GENERIC_APT_RESOLVER_SOLUTION_CACHE_H
+#define APTITUDE_GENERIC_APT_RESOLVER_SOLUTION_CACHE_H
+
+#include <string>
+#include <vector>
+
+
+namespace aptitude {
+namespace apt {
+
+
+/** One outcome of the resolver, as stored in the cache
+ *
+ * The cost and the choices are opaque to the cache: they are written
+ * and parsed back by resolver_solution_encoding.h, which also checks
+ * them against the live cache.
+ */
+struct cached_resolver_outcome
+{
+  /** @b false if the resolver found that there were no more solutions */
+  bool found;
+
+  /** The solution is the one that keeps every package at its version */
+  bool is_keep_all;
+
+  /** The score of the solution */
+  int score;
+
+  /** The cost of the solution, without newlines */
+  std::string cost;
+
+  /** The choices of the solution, without newlines */
+  std::vector<std::string> choices;
+
+  cached_resolver_outcome()
+    : found(false), is_keep_all(false), score(0)
+  {
+  }
+};
+
+
+/** A directory holding one file per cached outcome
+ *
+ * Keys are hexadecimal digests produced by chain_key().  The cache is
+ * only an optimization: failures to read or write it are logged and
+ * otherwise treated as misses, and entries are written to a temporary
+ * file and renamed into place so that concurrent readers never see a
+ * partial entry.
+ */
+class resolver_solution_cache
+{
+  std::string directory;
+
+  std::string get_path(const std::string &key) const;
+
+public:
+  /** Use the given directory, which is created on the first store() */
+  explicit resolver_solution_cache(const std::string &directory);
+
+  const std::string &get_directory() const { return directory; }
+
+  /** Look up an outcome
+   *
+   * @return @b true if the key was found and its entry is well-formed,
+   * in which case outcome is overwritten with it
+   */
+  bool lookup(const std::string &key, cached_resolver_outcome &outcome) const;
+
+  /** Store an outcome, replacing any previous entry for the key */
+  void store(const std::string &key, const cached_resolver_outcome &outcome) const;
+
+  /** Derive a key from a previous key and the text that distinguishes
+   * the new key from it
+   *
+   * This is used to fingerprint a problem incrementally: the key of
+   * the first solution digests the description of the problem, and
+   * the key of each following solution digests the key of the one
+   * before it and the user's interactions in between.
+   */
+  static std::string chain_key(const std::string &key, const std::string &text);
+};
+
+
+}
+}
+
+#endif
@@ -0,0 +1,338 @@
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+#include "resolver_solution_encoding.h"
+
+#include <apt-pkg/depcache.h>
+
+#include <climits>
+#include <cstring>
+#include <set>
+#include <sstream>
+
+
+namespace aptitude {
+namespace apt {
+
+
+namespace {
+
+typedef generic_choice<aptitude_universe> choice;
+typedef generic_choice_set<aptitude_universe> choice_set;
+
+/** Check that sol doesn't break d, unless it leaves d broken on purpose */
+bool check_dep(const aptitude_resolver_dep &d,
+	       const generic_solution<aptitude_universe> &sol,
+	       const std::set<aptitude_resolver_dep> &broken_choices,
+	       std::string &why)
+{
+  if (!d.broken_under(sol) || broken_choices.find(d) != broken_choices.end())
+    return true;
+
+  std::ostringstream out;
+  out << "it leaves " << d << " broken";
+  why = out.str();
+  return false;
+}
+
+}
+
+
+std::string encode_version(const aptitude_resolver_version &ver)
+{
+  const pkgCache::VerIterator v(ver.get_ver());
+
+  return ver.get_pkg().FullName(false) + " " + (v.end() ? "-" : v.VerStr());
+}
+
+std::string encode_dep(const aptitude_resolver_dep &d)
+{
+  const pkgCache::DepIterator dep(d.get_dep());
+  const pkgCache::VerIterator source(dep.ParentVer());
+
+  int dep_index = 0;
+  for (pkgCache::DepIterator it = source.DependsList(); !it.end() && it != dep; ++it)
+    ++dep_index;
+
+  int prv_index = -1;
+  const pkgCache::PrvIterator prv(d.get_prv());
+  if (is_conflict(dep->Type) && !prv.end())
+    {
+      prv_index = 0;
+      for (pkgCache::PrvIterator it = dep.TargetPkg().ProvidesList();
+	   !it.end() && it != prv; ++it)
+	++prv_index;
+    }
+
+  std::ostringstream out;
+  out << source.ParentPkg().FullName(false) << " " << source.VerStr()
+      << " " << dep_index << " " << prv_index;
+  return out.str();
+}
+
+bool decode_version(std::istream &in, pkgDepCache *cache,
+		    aptitude_resolver_version &out)
+{
+  std::string name, version;
+  if (!(in >> name >> version))
+    return false;
+
+  const pkgCache::PkgIterator pkg = cache->GetCache().FindPkg(name);
+  if (pkg.end())
+    return false;
+
+  if (version == "-")
+    {
+      out = aptitude_resolver_version::make_removal(pkg, cache);
+      return true;
+    }
+
+  for (pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver)
+    if (strcmp(ver.VerStr(), version.c_str()) == 0)
+      {
+	out = aptitude_resolver_version::make_install(ver, cache);
+	return true;
+      }
+
+  return false;
+}
+
+bool decode_dep(std::istream &in, pkgDepCache *cache,
+		aptitude_resolver_dep &out)
+{
+  aptitude_resolver_version source;
+  int dep_index, prv_index;
+  if (!decode_version(in, cache, source) || source.get_ver().end() ||
+      !(in >> dep_index >> prv_index))
+    return false;
+
+  pkgCache::DepIterator dep = source.get_ver().DependsList();
+  for (int i = 0; i < dep_index && !dep.end(); ++i)
+    ++dep;
+  if (dep.end())
+    return false;
+
+  const pkgCache::Provides *prv = NULL;
+  if (prv_index >= 0)
+    {
+      pkgCache::PrvIterator it = dep.TargetPkg().ProvidesList();
+      for (int i = 0; i < prv_index && !it.end(); ++i)
+	++it;
+      if (it.end())
+	return false;
+
+      prv = it;
+    }
+
+  out = aptitude_resolver_dep(dep, prv, cache);
+  return true;
+}
+
+std::string encode_cost(const cost &c)
+{
+  std::ostringstream out;
+  out << c.get_structural_level();
+
+  const std::vector<std::pair<int, level> > levels = c.get_user_levels();
+  for (std::vector<std::pair<int, level> >::const_iterator it = levels.begin();
+       it != levels.end(); ++it)
+    out << " " << it->first
+	<< (it->second.get_state() == level::added ? " add " : " advance ")
+	<< it->second.get_value();
+
+  return out.str();
+}
+
+bool decode_cost(const std::string &text, cost &out)
+{
+  std::istringstream in(text);
+
+  int structural_level;
+  if (!(in >> structural_level))
+    return false;
+
+  cost rval;
+  if (structural_level != INT_MIN)
+    rval = cost::make_advance_structural_level(structural_level);
+
+  int index, value;
+  std::string op;
+  while (in >> index >> op >> value)
+    {
+      if (index < 0)
+	return false;
+      else if (op == "add")
+	{
+	  // Costs never add a non-positive value to a level.
+	  if (value <= 0)
+	    return false;
+	  rval = rval + cost::make_add_to_user_level(index, value);
+	}
+      else if (op == "advance")
+	rval = rval + cost::make_advance_user_level(index, value);
+      else
+	return false;
+    }
+
+  if (!in.eof())
+    return false;
+
+  out = rval;
+  return true;
+}
+
+cached_resolver_outcome encode_solution(const generic_solution<aptitude_universe> &sol,
+					bool is_keep_all_solution)
+{
+  cached_resolver_outcome rval;
+  rval.found = true;
+  rval.is_keep_all = is_keep_all_solution;
+  rval.score = sol.get_score();
+  rval.cost = encode_cost(sol.get_cost());
+
+  for (choice_set::const_iterator it = sol.get_choices().begin();
+       it != sol.get_choices().end(); ++it)
+    {
+      std::string line;
+      switch (it->get_type())
+	{
+	case choice::install_version:
+	  line = std::string("install ")
+	    + (it->get_from_dep_source() ? "1 " : "0 ")
+	    + (it->get_has_dep() ? "1 " : "0 ")
+	    + encode_version(it->get_ver());
+	  if (it->get_has_dep())
+	    line += " " + encode_dep(it->get_dep());
+	  break;
+
+	case choice::break_soft_dep:
+	  line = "break " + encode_dep(it->get_dep());
+	  break;
+	}
+
+      rval.choices.push_back(line);
+    }
+
+  return rval;
+}
+
+bool decode_solution(const cached_resolver_outcome &outcome,
+		     pkgDepCache *cache,
+		     const resolver_initial_state<aptitude_universe> &initial_state,
+		     const imm::set<aptitude_resolver_dep> &initial_broken,
+		     generic_solution<aptitude_universe> &sol,
+		     std::string &why)
+{
+  choice_set choices;
+  std::set<aptitude_resolver_dep> broken_choices;
+  int id = 0;
+  for (std::vector<std::string>::const_iterator it = outcome.choices.begin();
+       it != outcome.choices.end(); ++it, ++id)
+    {
+      std::istringstream in(*it);
+      std::string type;
+      in >> type;
+
+      bool ok;
+      if (type == "install")
+	{
+	  int from_dep_source, has_dep;
+	  aptitude_resolver_version ver;
+	  aptitude_resolver_dep d;
+	  ok = (in >> from_dep_source >> has_dep) &&
+	    decode_version(in, cache, ver) &&
+	    (!has_dep || decode_dep(in, cache, d));
+
+	  if (ok && has_dep && from_dep_source)
+	    choices.insert_or_narrow(choice::make_install_version_from_dep_source(ver, d, id));
+	  else if (ok && has_dep)
+	    choices.insert_or_narrow(choice::make_install_version(ver, d, id));
+	  else if (ok)
+	    choices.insert_or_narrow(choice::make_install_version(ver, id));
+	}
+      else if (type == "break")
+	{
+	  aptitude_resolver_dep d;
+	  ok = decode_dep(in, cache, d) && d.is_soft();
+	  if (ok)
+	    {
+	      choices.insert_or_narrow(choice::make_break_soft_dep(d, id));
+	      broken_choices.insert(d);
+	    }
+	}
+      else
+	ok = false;
+
+      if (!ok)
+	{
+	  why = "unable to find \"" + *it + "\" in the cache";
+	  return false;
+	}
+    }
+
+  cost sol_cost;
+  if (!decode_cost(outcome.cost, sol_cost))
+    {
+      why = "malformed cost \"" + outcome.cost + "\"";
+      return false;
+    }
+
+  const generic_solution<aptitude_universe> rval(choices, initial_state,
+						 outcome.score, sol_cost);
+
+  for (imm::set<aptitude_resolver_dep>::const_iterator it = initial_broken.begin();
+       it != initial_broken.end(); ++it)
+    if (!check_dep(*it, rval, broken_choices, why))
+      return false;
+
+  // The same dependencies that the resolver looks at when it adds a
+  // choice: those of the versions that are replaced and of the
+  // versions that replace them, in both directions.
+  for (choice_set::const_iterator it = choices.begin(); it != choices.end(); ++it)
+    {
+      if (it->get_type() != choice::install_version)
+	continue;
+
+      const aptitude_resolver_version new_version = it->get_ver();
+      const aptitude_resolver_version old_version =
+	initial_state.version_of(new_version.get_package());
+
+      for (aptitude_resolver_version::revdep_iterator rd = old_version.revdeps_begin();
+	   !rd.end(); ++rd)
+	if (!check_dep(*rd, rval, broken_choices, why))
+	  return false;
+
+      for (aptitude_resolver_version::revdep_iterator rd = new_version.revdeps_begin();
+	   !rd.end(); ++rd)
+	if (!check_dep(*rd, rval, broken_choices, why))
+	  return false;
+
+      for (aptitude_resolver_version::dep_iterator d = new_version.deps_begin();
+	   !d.end(); ++d)
+	if (!check_dep(*d, rval, broken_choices, why))
+	  return false;
+    }
+
+  sol = rval;
+  return true;
+}
+
+
+}
+}
@@ -0,0 +1,114 @@
+// resolver_solution_encoding.h           -*-c++-*-
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+/** @file
+ *
+ * How resolver_manager writes solutions to the resolver solution
+ * cache and reads them back.
+ *
+ * Choices are written in terms of package names, version strings and
+ * positions in the dependency lists, so that they can be found again
+ * in a cache that was built later from the same package lists.  Every
+ * reference is checked when it is read back; anything that can't be
+ * found makes the entry unusable.
+ *
+ */
+
+#ifndef APTITUDE_GENERIC_APT_RESOLVER_SOLUTION_ENCODING_H
+#define APTITUDE_GENERIC_APT_RESOLVER_SOLUTION_ENCODING_H
+
+#include "aptitude_resolver_universe.h"
+#include "resolver_solution_cache.h"
+
+#include <generic/problemresolver/cost.h>
+#include <generic/problemresolver/solution.h>
+#include <generic/util/immset.h>
+
+#include <iosfwd>
+#include <string>
+
+class pkgDepCache;
+
+
+namespace aptitude {
+namespace apt {
+
+
+/** Describe a version as "package version", or "package -" for a removal */
+std::string encode_version(const aptitude_resolver_version &ver);
+
+/** Describe a dependency by its source version and its positions in
+ * the dependency list of the source and, for conflicts through a
+ * virtual package, in the list of providers of its target
+ */
+std::string encode_dep(const aptitude_resolver_dep &d);
+
+/** Read a version written by encode_version()
+ *
+ * @return @b false if the version isn't in the cache
+ */
+bool decode_version(std::istream &in, pkgDepCache *cache,
+		    aptitude_resolver_version &out);
+
+/** Read a dependency written by encode_dep()
+ *
+ * @return @b false if the dependency isn't in the cache
+ */
+bool decode_dep(std::istream &in, pkgDepCache *cache,
+		aptitude_resolver_dep &out);
+
+/** Describe a cost as its structural level followed by one "index
+ * add|advance value" triple per user level
+ */
+std::string encode_cost(const cost &c);
+
+/** Read a cost written by encode_cost()
+ *
+ * @return @b false if the text is malformed
+ */
+bool decode_cost(const std::string &text, cost &out);
+
+/** Describe a solution for the solution cache */
+cached_resolver_outcome encode_solution(const generic_solution<aptitude_universe> &sol,
+					bool is_keep_all_solution);
+
+/** Read a solution written by encode_solution() and check it
+ *
+ * The solution must fix every dependency in initial_broken, and must
+ * not break any dependency of the versions that it installs or
+ * removes, in either direction, unless it leaves that dependency
+ * broken on purpose.
+ *
+ * @param why  set to the reason if the solution can't be used
+ *
+ * @return @b true if sol was overwritten with a usable solution
+ */
+bool decode_solution(const cached_resolver_outcome &outcome,
+		     pkgDepCache *cache,
+		     const resolver_initial_state<aptitude_universe> &initial_state,
+		     const imm::set<aptitude_resolver_dep> &initial_broken,
+		     generic_solution<aptitude_universe> &sol,
+		     std::string &why);
+
+
+}
+}
+
+#endif
@@ -0,0 +1,135 @@
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+#include "source_index.h"
+
+#include "apt.h"
+
+#include <loggers.h>
+
+#include <apt-pkg/error.h>
+#include <apt-pkg/indexfile.h>
+#include <apt-pkg/metaindex.h>
+#include <apt-pkg/sourcelist.h>
+
+#include <sigc++/functors/ptr_fun.h>
+
+using aptitude::Loggers;
+
+
+namespace aptitude {
+namespace apt {
+
+
+namespace {
+
+std::unique_ptr<source_index> current_index;
+bool signals_connected = false;
+
+void reset_source_index()
+{
+  current_index.reset();
+}
+
+}
+
+
+source_index::source_index()
+{
+  logging::LoggerPtr logger(Loggers::getAptitudeAptCache());
+
+  if (apt_source_list == nullptr)
+    return;
+
+  for (pkgSourceList::const_iterator i = apt_source_list->begin(); i != apt_source_list->end(); ++i)
+    {
+      std::vector<pkgIndexFile*>* indexes = (*i)->GetIndexFiles();
+      for (std::vector<pkgIndexFile*>::const_iterator j = indexes->begin(); j != indexes->end(); ++j)
+	{
+	  std::unique_ptr<pkgSrcRecords::Parser> parser((*j)->CreateSrcParser());
+	  if (parser.get() == nullptr)
+	    continue;
+
+	  const size_t file = files.size();
+	  files.push_back(source_file{std::move(parser), (*i)->GetDist()});
+	  pkgSrcRecords::Parser* p = files.back().parser.get();
+
+	  p->Restart();
+	  while (p->Step())
+	    {
+	      const unsigned long offset = p->Offset();
+	      const std::string package = p->Package();
+	      records[package].push_back(location{file, offset, true});
+
+	      const char** binaries = p->Binaries();
+	      if (binaries == nullptr)
+		continue;
+	      for (const char** b = binaries; *b != nullptr; ++b)
+		{
+		  // Sources that build a binary of the same name are
+		  // already indexed under it.
+		  if (package != *b)
+		    records[*b].push_back(location{file, offset, false});
+		}
+	    }
+	}
+    }
+
+  LOG_DEBUG(logger, "Indexed " << records.size() << " source and binary names in " << files.size() << " Sources files");
+}
+
+const std::vector<source_index::location>* source_index::find(const std::string &name) const
+{
+  std::unordered_map<std::string, std::vector<location>>::const_iterator found = records.find(name);
+  if (found == records.end())
+    return nullptr;
+  else
+    return &found->second;
+}
+
+pkgSrcRecords::Parser* source_index::lookup(const location &loc) const
+{
+  pkgSrcRecords::Parser* parser = files[loc.file].parser.get();
+  if (!parser->Jump(loc.offset))
+    return nullptr;
+  else
+    return parser;
+}
+
+const source_index* get_source_index()
+{
+  if (apt_source_list == nullptr)
+    return nullptr;
+
+  if (!signals_connected)
+    {
+      cache_closed.connect(sigc::ptr_fun(&reset_source_index));
+      signals_connected = true;
+    }
+
+  if (current_index.get() == nullptr)
+    current_index.reset(new source_index);
+
+  return current_index.get();
+}
+
+
+}
+}
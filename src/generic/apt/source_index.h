@@ -0,0 +1,130 @@
+// source_index.h                       -*-c++-*-
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+/** @file
+ *
+ * Index from source package names to their records in the Sources
+ * files.
+ *
+ */
+
+#ifndef APTITUDE_GENERIC_APT_SOURCE_INDEX_H
+#define APTITUDE_GENERIC_APT_SOURCE_INDEX_H
+
+#include <apt-pkg/srcrecords.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace aptitude {
+namespace apt {
+
+
+/** Index of every record in the Sources files of apt_source_list
+ *
+ * pkgSrcRecords::Find() scans all of the Sources files from the start
+ * for every lookup.  This index is built with a single pass over the
+ * files, after which each lookup jumps directly to the matching
+ * records, so looking up a batch of source packages (for instance in
+ * "aptitude build-dep") reads the files only once.
+ *
+ * Records are indexed both under their source package name and under
+ * the names of the binary packages that they build, like
+ * pkgSrcRecords::Find() does; lookups visit them in the same order as
+ * repeated calls to pkgSrcRecords::Find() would.
+ *
+ * The index refers to the parsers of apt_source_list's index files,
+ * so it is discarded whenever the cache is closed.
+ */
+class source_index
+{
+public:
+  /** A record found in the index */
+  struct location
+  {
+    /** The parser of the Sources file that contains the record */
+    size_t file;
+    /** The offset of the record in that file */
+    unsigned long offset;
+    /** Whether the record was indexed under its source package name
+     * rather than under one of its binaries */
+    bool is_source;
+  };
+
+private:
+  struct source_file
+  {
+    std::unique_ptr<pkgSrcRecords::Parser> parser;
+    /** The distribution of the sources.list entry of the file */
+    std::string dist;
+  };
+
+  std::vector<source_file> files;
+  std::unordered_map<std::string, std::vector<location>> records;
+
+  source_index(const source_index &) = delete;
+  source_index& operator=(const source_index &) = delete;
+
+public:
+  /** Build the index by reading every Sources file of apt_source_list */
+  source_index();
+
+  /** @return @b true if there is at least one Sources file (that is, a
+   * deb-src entry in sources.list)
+   */
+  bool has_sources() const { return !files.empty(); }
+
+  /** @return The records indexed under the given name, in file order,
+   * or @b nullptr if there are none
+   */
+  const std::vector<location>* find(const std::string &name) const;
+
+  /** Position the parser of a record at that record
+   *
+   * @return The parser, ready to be queried for the fields of the
+   * record, or @b nullptr if it could not be read
+   */
+  pkgSrcRecords::Parser* lookup(const location &loc) const;
+
+  /** @return The distribution of the sources.list entry that a record
+   * comes from
+   */
+  const std::string& get_dist(const location &loc) const { return files[loc.file].dist; }
+
+  /** @return The number of distinct names in the index */
+  size_t size() const { return records.size(); }
+};
+
+
+/** Get the index of the current source list, building it if necessary
+ *
+ * @return The index, or @b nullptr if apt_source_list is not loaded
+ */
+const source_index* get_source_index();
+
+
+}
+}
+
+#endif
@@ -27,6 +27,8 @@
 
 #include "config_signal.h"
 
+#include <generic/util/memory_accounting.h>
+
 #include <algorithm>
 #include <map>
 #include <utility>
@@ -152,6 +154,31 @@ public:
 // to provide a progress bar to the user.
 tag_set *tagDB;
 
+static aptitude::util::memory_usage get_tag_db_memory()
+{
+  using aptitude::util::node_container_bytes;
+  using aptitude::util::string_heap_bytes;
+
+  aptitude::util::memory_usage rval;
+  if(!apt_cache_file || !tagDB)
+    return rval;
+
+  const unsigned long count = (*apt_cache_file)->Head().GroupCount;
+  rval.bytes = count * sizeof(tag_set);
+  for(unsigned long i = 0; i < count; ++i)
+    {
+      rval.objects += tagDB[i].size();
+      rval.bytes += node_container_bytes<aptitude::apt::tag>(tagDB[i].size());
+      for(const aptitude::apt::tag &t : tagDB[i])
+	rval.bytes += string_heap_bytes(t);
+    }
+
+  return rval;
+}
+
+static aptitude::util::memory_account tag_db_account("tag database",
+						      &get_tag_db_memory);
+
 static void insert_tags(const pkgCache::VerIterator &ver,
 			const pkgCache::VerFileIterator &vf)
 {
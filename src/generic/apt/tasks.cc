@@ -24,6 +24,8 @@
 
 #include <aptitude.h>
 
+#include <generic/util/memory_accounting.h>
+
 #include <apt-pkg/error.h>
 #include <apt-pkg/fileutl.h>
 #include <apt-pkg/pkgrecords.h>
@@ -57,6 +59,50 @@ map<string, task> *task_list=new map<string, task>;
 // (as usual, it's initialized to NULL)
 set<string> *tasks_by_package = nullptr;
 
+namespace
+{
+  util::memory_usage get_tasks_memory()
+  {
+    using util::node_container_bytes;
+    using util::string_heap_bytes;
+
+    util::memory_usage rval;
+
+    for(const pair<const string, task> &entry : *task_list)
+      {
+	const task &t = entry.second;
+	rval.objects += 1;
+	rval.bytes += node_container_bytes<pair<const string, task> >(1);
+	rval.bytes += string_heap_bytes(entry.first);
+	rval.bytes += string_heap_bytes(t.name) + string_heap_bytes(t.section);
+	rval.bytes += (t.shortdesc.capacity() + t.longdesc.capacity()) * sizeof(wchar_t);
+	rval.bytes += node_container_bytes<string>(t.keys.size());
+	for(const string &key : t.keys)
+	  rval.bytes += string_heap_bytes(key);
+	rval.bytes += t.packages.capacity() * sizeof(string);
+	for(const string &package : t.packages)
+	  rval.bytes += string_heap_bytes(package);
+      }
+
+    if(tasks_by_package && apt_cache_file)
+      {
+	const unsigned long count = (*apt_cache_file)->Head().PackageCount;
+	rval.bytes += count * sizeof(set<string>);
+	for(unsigned long i = 0; i < count; ++i)
+	  {
+	    rval.objects += tasks_by_package[i].size();
+	    rval.bytes += node_container_bytes<string>(tasks_by_package[i].size());
+	    for(const string &name : tasks_by_package[i])
+	      rval.bytes += string_heap_bytes(name);
+	  }
+      }
+
+    return rval;
+  }
+
+  util::memory_account tasks_account("tasks", &get_tasks_memory);
+}
+
 // for lazy initialization
 void load_tasks_lazy()
 {
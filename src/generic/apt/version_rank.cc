@@ -0,0 +1,131 @@
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+#include "version_rank.h"
+
+#include "apt.h"
+#include "aptcache.h"
+
+#include <loggers.h>
+
+#include <apt-pkg/pkgsystem.h>
+#include <apt-pkg/version.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+using aptitude::Loggers;
+
+
+namespace aptitude {
+namespace apt {
+
+
+namespace {
+
+/** Protects owned_table while it is built or discarded */
+std::mutex table_mutex;
+std::unique_ptr<version_rank_table> owned_table;
+/** Published once the table is built, so that readers don't lock */
+std::atomic<const version_rank_table*> current_table(nullptr);
+
+}
+
+
+version_rank_table::version_rank_table(pkgCache &cache)
+  : ranks(cache.Head().VersionCount)
+{
+  std::vector<pkgCache::VerIterator> versions;
+
+  for (pkgCache::GrpIterator grp = cache.GrpBegin(); !grp.end(); ++grp)
+    {
+      versions.clear();
+      for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg))
+	{
+	  for (pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver)
+	    versions.push_back(ver);
+	}
+
+      std::sort(versions.begin(), versions.end(),
+		[](const pkgCache::VerIterator &v1, const pkgCache::VerIterator &v2)
+		{
+		  return _system->VS->CmpVersion(v1.VerStr(), v2.VerStr()) < 0;
+		});
+
+      unsigned int rank = 0;
+      for (size_t i = 0; i < versions.size(); ++i)
+	{
+	  if (i > 0 && _system->VS->CmpVersion(versions[i - 1].VerStr(), versions[i].VerStr()) != 0)
+	    ++rank;
+	  ranks[versions[i]->ID] = rank;
+	}
+    }
+}
+
+
+const version_rank_table& get_version_rank_table()
+{
+  const version_rank_table* table = current_table.load(std::memory_order_acquire);
+  if (table != nullptr)
+    return *table;
+
+  std::lock_guard<std::mutex> lock(table_mutex);
+  if (owned_table.get() == nullptr)
+    {
+      logging::LoggerPtr logger(Loggers::getAptitudeAptCache());
+      LOG_DEBUG(logger, "Ranking " << (*apt_cache_file)->Head().VersionCount << " versions");
+
+      owned_table.reset(new version_rank_table((*apt_cache_file)->GetCache()));
+      current_table.store(owned_table.get(), std::memory_order_release);
+    }
+
+  return *owned_table;
+}
+
+void clear_version_rank_table()
+{
+  std::lock_guard<std::mutex> lock(table_mutex);
+  current_table.store(nullptr, std::memory_order_release);
+  owned_table.reset();
+}
+
+
+int compare_versions(const pkgCache::VerIterator &v1, const pkgCache::VerIterator &v2)
+{
+  if (v1.ParentPkg()->Group != v2.ParentPkg()->Group)
+    return _system->VS->CmpVersion(v1.VerStr(), v2.VerStr());
+
+  const version_rank_table &table = get_version_rank_table();
+  const unsigned int rank1 = table.get_rank(v1);
+  const unsigned int rank2 = table.get_rank(v2);
+
+  if (rank1 < rank2)
+    return -1;
+  else if (rank1 > rank2)
+    return 1;
+  else
+    return 0;
+}
+
+
+}
+}
@@ -0,0 +1,92 @@
+// version_rank.h                         -*-c++-*-
+//
+// Copyright (C) 2026 Aptitude developers
+//
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+/** @file
+ *
+ * Precomputed ordering of the versions of each package group, so
+ * that versions of the same group can be compared without parsing
+ * their version strings.
+ *
+ */
+
+#ifndef APTITUDE_GENERIC_APT_VERSION_RANK_H
+#define APTITUDE_GENERIC_APT_VERSION_RANK_H
+
+#include <apt-pkg/pkgcache.h>
+
+#include <vector>
+
+
+namespace aptitude {
+namespace apt {
+
+
+/** Rank of every version of a cache within its package group
+ *
+ * The versions of each group (all of the architectures of a package)
+ * are sorted once with the versioning system, and each version gets
+ * its position in that order: a version with a higher rank is newer,
+ * and versions with equal version strings have the same rank.
+ */
+class version_rank_table
+{
+  /** Ranks, indexed by the ID of each version */
+  std::vector<unsigned int> ranks;
+
+public:
+  /** Rank every version of the given cache */
+  explicit version_rank_table(pkgCache &cache);
+
+  /** @return The rank of the given version within its group */
+  unsigned int get_rank(const pkgCache::VerIterator &ver) const
+  {
+    return ranks[ver->ID];
+  }
+};
+
+
+/** Get the table of the global cache, building it on first use
+ *
+ * This may be called from any thread while apt_cache_file is open.
+ */
+const version_rank_table& get_version_rank_table();
+
+/** Discard the table of the global cache; called when it is closed */
+void clear_version_rank_table();
+
+
+/** Compare two versions of the global cache like
+ * debVersioningSystem::CmpVersion() does with their version strings
+ *
+ * Versions of the same package group are compared by rank; the
+ * versioning system is only consulted for versions of different
+ * groups.
+ *
+ * @return A value less than, equal to or greater than zero if v1 is
+ * older than, the same as or newer than v2
+ */
+int compare_versions(const pkgCache::VerIterator &v1, const pkgCache::VerIterator &v2);
+
+
+}
+}
+
+#endif
@@ -290,6 +290,13 @@ cost cost::greatest_lower_bound(const cost &cost1,
   return cost(cost1, cost2, lower_bound_tag());
 }
 
+std::vector<std::pair<int, level> > cost::get_user_levels() const
+{
+  const auto &actions = get_impl().get_actions();
+
+  return std::vector<std::pair<int, level> >(actions.begin(), actions.end());
+}
+
 std::size_t hash_value(const cost &cost)
 {
   return cost.get_hash_value();
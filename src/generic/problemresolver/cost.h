@@ -395,6 +395,11 @@ class cost
       return !actions.empty();
     }
 
+    const std::vector<std::pair<level_index, level> > &get_actions() const
+    {
+      return actions;
+    }
+
     /** Get an overall level number for the combined actions.
      *
      * level::combine() suggests that "lower_bounded" and "additive" levels
@@ -623,6 +628,11 @@ public:
     return get_impl().get_has_user_levels();
   }
 
+  /** \brief Get the user levels that this cost modifies, in
+   *  increasing order of their indices.
+   */
+  std::vector<std::pair<int, level> > get_user_levels() const;
+
   std::size_t get_hash_value() const
   {
     return get_impl().get_hash_value();
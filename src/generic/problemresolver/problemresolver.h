@@ -27,6 +27,7 @@
 #include <optional>
 #include <vector>
 
+#include <iomanip>
 #include <iostream>
 #include <sstream>
 
@@ -518,6 +519,12 @@ public:
      *  defer_cost.
      */
     size_t promotions;
+    /** \brief The number of steps in the search graph. */
+    size_t steps;
+    /** \brief The number of steps that beam search dropped from the
+     *  open queue.
+     */
+    size_t pruned;
 
     /** \b true if the resolver has finished searching for solutions.
      *  If open is empty, this member distinguishes between the start
@@ -531,12 +538,40 @@ public:
 
     queue_counts()
       : open(0), closed(0), deferred(0), conflicts(0), promotions(0),
-	finished(false),
+	steps(0), pruned(0), finished(false),
 	current_cost(cost_limits::minimum_cost)
     {
     }
   };
 
+  /** \brief How much of the search was spent on one dependency; only
+   *  collected if profiling is enabled (see set_profile()).
+   */
+  struct dep_effort
+  {
+    /** \brief The number of steps that branched on the dependency. */
+    size_t steps;
+    /** \brief The number of successors generated for the dependency. */
+    size_t successors;
+    /** \brief The number of times a promotion raised the cost of a
+     *  step or a solver that resolves the dependency.
+     */
+    size_t promotion_hits;
+    /** \brief The number of steps in which the dependency became
+     *  broken.
+     *
+     *  A step that inherits the broken dependency from its parent is
+     *  not counted again, so this is how many times a choice broke
+     *  the dependency (plus one if it was broken to begin with).
+     */
+    size_t unresolved;
+
+    dep_effort()
+      : steps(0), successors(0), promotion_hits(0), unresolved(0)
+    {
+    }
+  };
+
 private:
   logging::LoggerPtr logger;
   bool debug;
@@ -768,6 +803,50 @@ private:
    */
   int future_horizon;
 
+  /** The number of steps to keep at each cost in the open queue, or
+   *  0 to keep every step.
+   */
+  size_t beam_width;
+
+  /** The number of steps that were dropped from the open queue
+   *  because they fell outside the beam.
+   */
+  size_t num_pruned;
+
+  /** The size of the open queue after it was last pruned. */
+  size_t pending_size_after_prune;
+
+  /** If \b true, the search effort spent on each dependency is
+   *  recorded in dep_efforts.
+   */
+  bool profile;
+
+  /** The search effort spent on each dependency since the last
+   *  reset(), if profile is \b true.
+   */
+  std::map<dep, dep_effort> dep_efforts;
+
+  /** Ranks dependencies by how much search effort they took, most
+   *  expensive first.
+   */
+  struct compare_dep_efforts
+  {
+    bool operator()(const std::pair<dep, dep_effort> &e1,
+		    const std::pair<dep, dep_effort> &e2) const
+    {
+      if(e1.second.steps != e2.second.steps)
+	return e1.second.steps > e2.second.steps;
+      else if(e1.second.successors != e2.second.successors)
+	return e1.second.successors > e2.second.successors;
+      else if(e1.second.promotion_hits != e2.second.promotion_hits)
+	return e1.second.promotion_hits > e2.second.promotion_hits;
+      else if(e1.second.unresolved != e2.second.unresolved)
+	return e1.second.unresolved > e2.second.unresolved;
+      else
+	return e1.first < e2.first;
+    }
+  };
+
   /** The universe in which we are solving problems. */
   const PackageUniverse universe;
 
@@ -1846,6 +1925,69 @@ private:
 #endif
   }
 
+  /** \brief If beam search is enabled, drop every pending step that
+   *  is not among the best beam_width steps of its cost.
+   *
+   *  pending is sorted by cost first, so the steps of each cost are
+   *  adjacent and in order of goodness.  Deferred steps are skipped,
+   *  since they may become candidates again, as are blessed
+   *  solutions; pending_future_solutions is never pruned.  To keep
+   *  the cost of walking the queue down, it is only pruned once it
+   *  has grown by beam_width steps since the last time.
+   */
+  void prune_pending()
+  {
+    if(beam_width == 0 ||
+       pending.size() < pending_size_after_prune + beam_width)
+      return;
+
+    size_t pruned_now = 0;
+    bool have_tier = false;
+    cost tier_cost;
+    size_t tier_size = 0;
+
+    typename std::set<int, step_goodness_compare>::iterator it = pending.begin();
+    while(it != pending.end())
+      {
+	const step &s(graph.get_step(*it));
+
+	if(is_defer_cost(s.final_step_cost) ||
+	   is_discard_cost(s.final_step_cost) ||
+	   s.is_blessed_solution)
+	  {
+	    ++it;
+	    continue;
+	  }
+
+	if(!have_tier || tier_cost != s.final_step_cost)
+	  {
+	    have_tier = true;
+	    tier_cost = s.final_step_cost;
+	    tier_size = 0;
+	  }
+
+	++tier_size;
+	if(tier_size > beam_width)
+	  {
+	    LOG_TRACE(logger, "Pruning step " << s.step_num
+		      << ": it is outside the best " << beam_width
+		      << " steps at cost " << s.final_step_cost);
+	    pending.erase(it++);
+	    ++pruned_now;
+	  }
+	else
+	  ++it;
+      }
+
+    num_pruned += pruned_now;
+    pending_size_after_prune = pending.size();
+
+    if(pruned_now > 0)
+      LOG_DEBUG(logger, "Beam search pruned " << pruned_now
+		<< " steps (" << num_pruned << " in total); "
+		<< pending.size() << " steps remain open.");
+  }
+
   class do_drop_deps_solved_by
   {
     step &s;
@@ -2974,6 +3116,11 @@ private:
 
     if(!s.effective_step_cost.is_above_or_equal(p_cost))
       {
+	// Charge the promotion to the dependency that the parent
+	// branched on to create this step.
+	if(profile && s.parent != -1 && s.reason.get_has_dep())
+	  ++dep_efforts[s.reason.get_dep()].promotion_hits;
+
         cost new_effective_step_cost =
           cost::least_upper_bound(p_cost, s.effective_step_cost);
 
@@ -3089,6 +3236,8 @@ private:
     LOG_TRACE(logger, "Applying the promotion " << p
 	      << " to the solver " << solver
 	      << " in the step " << s.step_num);
+    if(profile && solver.get_has_dep())
+      ++dep_efforts[solver.get_dep()].promotion_hits;
     const cost &new_cost(p.get_cost());
     // There are really two cases here: either the cost was increased
     // to the point that the solver should be ejected, or the cost
@@ -3239,6 +3388,9 @@ private:
     LOG_TRACE(logger, "Marking the dependency " << d << " as unresolved in step "
 	      << s.step_num);
 
+    if(profile)
+      ++dep_efforts[d].unresolved;
+
     // Build up a list of the possible solvers of the dependency.
     typename step::dep_solvers solvers;
     for(typename dep::solver_iterator si = d.solvers_begin();
@@ -3404,7 +3556,9 @@ private:
 	  s.action_score -= old_score;
 
 	  // Look for joint score constraints triggered by adding this
-	  // choice.
+	  // choice.  Each choice is added once along a path from the
+	  // root, so a joint score is satisfied when the number of its
+	  // choices that were added reaches its size.
 	  const typename solution_weights<PackageUniverse>::joint_score_set::const_iterator
 	    joint_scores_found = weights.get_joint_scores().find(c);
 
@@ -3415,8 +3569,15 @@ private:
 		    joint_scores_found->second.begin();
 		  it != joint_scores_found->second.end(); ++it)
 		{
-		  if(s.actions.contains(it->get_choices()))
+		  const unsigned int hits =
+		    s.joint_score_hits.get(it->get_id(), 0) + 1;
+
+		  if(hits < it->get_num_choices())
+		    s.joint_score_hits.put(it->get_id(), hits);
+		  else
 		    {
+		      s.joint_score_hits.erase(it->get_id());
+
 		      LOG_TRACE(logger, "Adjusting the score of "
 				<< s.step_num << " by "
 				<< std::showpos << it->get_score()
@@ -3514,6 +3675,7 @@ private:
     output.unresolved_deps_by_num_solvers = parent.unresolved_deps_by_num_solvers;
     output.deps_solved_by_choice = parent.deps_solved_by_choice;
     output.forbidden_versions = parent.forbidden_versions;
+    output.joint_score_hits = parent.joint_score_hits;
     output.promotion_queue_location = promotion_queue_tail;
 
 
@@ -3700,10 +3862,20 @@ private:
 	      << " for the dependency " << bestDepSolvers
 	      << " with " << best.getVal().first << " solvers: "
 	      << bestDepSolvers.dump_solvers());
+    const dep best_dep(best.getVal().second);
+    const size_t num_steps_before = graph.get_num_steps();
+
     bool first_successor = false;
     do_generate_single_successor generate_successor_f(s.step_num, *this,
 						      first_successor);
     bestDepSolvers.for_each_solver(generate_successor_f);
+
+    if(profile)
+      {
+	dep_effort &effort(dep_efforts[best_dep]);
+	++effort.steps;
+	effort.successors += graph.get_num_steps() - num_steps_before;
+      }
   }
 
   void do_log(const char *sourceName,
@@ -3754,6 +3926,8 @@ public:
      unfixed_soft_cost(_unfixed_soft_cost),
      minimum_score(-infinity),
      future_horizon(_future_horizon),
+     beam_width(0), num_pruned(0), pending_size_after_prune(0),
+     profile(false),
      universe(_universe), finished(false),
      solver_executing(false), solver_cancelled(false),
      pending(step_goodness_compare(graph)),
@@ -3837,6 +4011,92 @@ public:
   int get_infinity() {return -minimum_score;}
   int get_full_solution_score() {return weights.full_solution_score;}
 
+  /** \brief Bound the open queue to the best steps of each cost.
+   *
+   *  When the width is nonzero, the resolver keeps at most that many
+   *  pending steps at each cost (the best-scored ones) and drops the
+   *  rest.  Deferred steps and blessed solutions are never dropped.
+   *  This makes large problems tractable at the price of
+   *  completeness: once steps have been dropped, running out of
+   *  solutions no longer means that no other solution exists.
+   *
+   *  \param new_beam_width  the number of steps to keep at each
+   *                         cost, or 0 to disable beam search.
+   */
+  void set_beam_width(size_t new_beam_width)
+  {
+    beam_width = new_beam_width;
+  }
+
+  /** \return the number of steps dropped by beam search since the
+   *  last reset().
+   */
+  size_t get_num_pruned() const
+  {
+    return num_pruned;
+  }
+
+  /** \brief Enable or disable recording how much search effort is
+   *  spent on each dependency.
+   *
+   *  Profiling slows the search down slightly, so it is off by
+   *  default.
+   */
+  void set_profile(bool new_profile)
+  {
+    profile = new_profile;
+  }
+
+  /** \return the search effort spent on each dependency since the
+   *  last reset(); empty unless profiling is enabled.
+   */
+  const std::map<dep, dep_effort> &get_dep_efforts() const
+  {
+    return dep_efforts;
+  }
+
+  /** \brief Write a report of the dependencies that took the most
+   *  search effort, most expensive first.
+   *
+   *  \param out     the stream to write to.
+   *  \param limit   the largest number of dependencies to list.
+   *  \param prefix  a string to write at the start of each line.
+   */
+  void dump_dep_efforts(std::ostream &out,
+			size_t limit,
+			const std::string &prefix) const
+  {
+    std::vector<std::pair<dep, dep_effort> > ranked(dep_efforts.begin(),
+						    dep_efforts.end());
+    std::sort(ranked.begin(), ranked.end(), compare_dep_efforts());
+
+    if(ranked.empty())
+      {
+	out << prefix << "No search effort has been recorded." << std::endl;
+	return;
+      }
+
+    out << prefix << "Search effort by dependency, most expensive first:" << std::endl;
+    out << prefix << std::setw(8) << "steps"
+	<< std::setw(12) << "successors"
+	<< std::setw(12) << "promotions"
+	<< std::setw(8) << "breaks"
+	<< "  dependency" << std::endl;
+
+    size_t shown = 0;
+    for(typename std::vector<std::pair<dep, dep_effort> >::const_iterator it = ranked.begin();
+	it != ranked.end() && shown < limit; ++it, ++shown)
+      out << prefix << std::setw(8) << it->second.steps
+	  << std::setw(12) << it->second.successors
+	  << std::setw(12) << it->second.promotion_hits
+	  << std::setw(8) << it->second.unresolved
+	  << "  " << it->first << std::endl;
+
+    if(shown < ranked.size())
+      out << prefix << "(" << ranked.size() - shown
+	  << " more dependencies)" << std::endl;
+  }
+
   /** Enables or disables debugging.  Debugging is initially
    *  disabled.
    *
@@ -3864,6 +4124,9 @@ public:
     finished=false;
     pending.clear();
     pending_future_solutions.clear();
+    num_pruned = 0;
+    pending_size_after_prune = 0;
+    dep_efforts.clear();
     promotion_queue_tail = std::make_shared<promotion_queue_entry>(0, 0);
     graph.clear();
     closed.clear();
@@ -4196,6 +4459,8 @@ public:
     counts.deferred   = get_num_deferred();
     counts.conflicts  = promotions.conflicts_size();
     counts.promotions = promotions.size() - counts.conflicts;
+    counts.steps      = graph.get_num_steps();
+    counts.pruned     = num_pruned;
     counts.finished   = finished;
     counts.current_cost = get_current_search_cost();
   }
@@ -4653,6 +4918,8 @@ public:
 	// search tree.
 	graph.run_scheduled_promotion_propagations(promotion_adder(*this));
 	process_pending_promotions();
+
+	prune_pending();
       }
 
     if(logger->isEnabledFor(logging::TRACE_LEVEL))
@@ -4684,7 +4951,8 @@ public:
 	    LOG_INFO(logger, " *** open: " << pending.size()
 		     << "; closed: " << closed.size()
 		     << "; promotions: " << promotions.size()
-		     << "; deferred: " << get_num_deferred());
+		     << "; deferred: " << get_num_deferred()
+		     << "; pruned: " << num_pruned);
 
 	    LOG_INFO(logger, "--- Returning the future solution "
 		     << rval << " from step " << best_future_solution);
@@ -4712,7 +4980,8 @@ public:
 	     " *** open: " << pending.size()
 	     << "; closed: " << closed.size()
 	     << "; promotions: " << promotions.size()
-	     << "; deferred: " << get_num_deferred());
+	     << "; deferred: " << get_num_deferred()
+	     << "; pruned: " << num_pruned);
 
     throw NoMoreSolutions();
   }
@@ -51,9 +51,11 @@
  *      or in the reverse dependency list of EACH version of
  *      that same package that is not a solver of the dependency.
  *    - Each broken dependency is broken in an empty solution.
+ *
+ *  \return The number of errors that were found.
  */
 template<typename PackageUniverse>
-void sanity_check_universe(const PackageUniverse &universe)
+unsigned long sanity_check_universe(const PackageUniverse &universe)
 {
   typedef typename PackageUniverse::package package;
   typedef typename PackageUniverse::version version;
@@ -67,6 +69,8 @@ void sanity_check_universe(const PackageUniverse &universe)
   std::set<package> seenPkgs;
   std::set<version> seenVers;
 
+  unsigned long errors = 0;
+
   for(package_iterator pIt = universe.packages_begin();
       !pIt.end(); ++pIt)
     {
@@ -95,18 +99,22 @@ void sanity_check_universe(const PackageUniverse &universe)
 			    << " is a forward dep of a different version "
 			    << *vIt
 			    << std::endl;
+		  ++errors;
 		}
 
 	      for(typename dep::solver_iterator sIt = (*dIt).solvers_begin();
 		  !sIt.end(); ++sIt)
 		{
 		  if(seenVers.find(*sIt) == seenVers.end())
-		    std::cout << "Error: "
-			      << *sIt
-			      << " exists as a solver of "
-			      << *dIt
-			      << " but is not a member of the global version list."
-			      << std::endl;
+		    {
+		      std::cout << "Error: "
+				<< *sIt
+				<< " exists as a solver of "
+				<< *dIt
+				<< " but is not a member of the global version list."
+				<< std::endl;
+		      ++errors;
+		    }
 		}
 
 	      seenDeps.insert(*dIt);
@@ -118,6 +126,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 			    << " belongs to the forward dependency list of "
 			    << (*vIt)
 			    <<std::endl;
+		  ++errors;
 		}
 	    }
 
@@ -125,27 +134,33 @@ void sanity_check_universe(const PackageUniverse &universe)
 	      !rdIt.end(); ++rdIt)
 	    {
 	      if(seenVers.find((*rdIt).get_source()) == seenVers.end())
-		std::cout << "Error: "
-			  << (*rdIt).get_source()
-			  << " exists as the source of the revdep "
-			  << *rdIt
-			  << " linked from version "
-			  << *vIt
-			  << " but is not a member of the global version list."
-			  << std::endl;
+		{
+		  std::cout << "Error: "
+			    << (*rdIt).get_source()
+			    << " exists as the source of the revdep "
+			    << *rdIt
+			    << " linked from version "
+			    << *vIt
+			    << " but is not a member of the global version list."
+			    << std::endl;
+		  ++errors;
+		}
 
 	      for(typename dep::solver_iterator sIt = (*rdIt).solvers_begin();
 		  !sIt.end(); ++sIt)
 		{
 		  if(seenVers.find(*sIt) == seenVers.end())
-		    std::cout << "Error: "
-			      << *sIt
-			      << " exists as a solver of the revdep "
-			      << *rdIt
-			      << " linked from "
-			      << *vIt
-			      << " but is not a member of the global version list."
-			      << std::endl;
+		    {
+		      std::cout << "Error: "
+				<< *sIt
+				<< " exists as a solver of the revdep "
+				<< *rdIt
+				<< " linked from "
+				<< *vIt
+				<< " but is not a member of the global version list."
+				<< std::endl;
+		      ++errors;
+		    }
 		}
 
 	      seenRevDeps.insert(*rdIt);
@@ -163,11 +178,14 @@ void sanity_check_universe(const PackageUniverse &universe)
 		}
 
 	      if(!found)
-		std::cout << "Error: spurious revdep link from "
-			  << (*vIt)
-			  << " to "
-			  << (*rdIt)
-			  << std::endl;
+		{
+		  std::cout << "Error: spurious revdep link from "
+			    << (*vIt)
+			    << " to "
+			    << (*rdIt)
+			    << std::endl;
+		  ++errors;
+		}
 	    }
 
 	  if((*vIt).get_package() != (*pIt))
@@ -177,6 +195,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 			<< " is a member of the version list of a different package "
 			<< (*pIt).get_name()
 			<< std::endl;
+	      ++errors;
 	    }
 	}
 
@@ -187,6 +206,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 		    << " is a version of another package, "
 		    << (*pIt).current_version()
 		    << std::endl;
+	  ++errors;
 	}
     }
 
@@ -221,6 +241,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 				<< *dIt
 				<< " but solved_by returned false."
 				<< std::endl;
+		      ++errors;
 		    }
 		}
 	      else
@@ -233,6 +254,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 				<< *dIt
 				<< " but solved_by returned true."
 				<< std::endl;
+		      ++errors;
 		    }
 		}
 	    }
@@ -244,17 +266,23 @@ void sanity_check_universe(const PackageUniverse &universe)
       !dIt.end(); ++dIt)
     {
       if(seenDeps.find(*dIt) == seenDeps.end())
-	std::cout << "Error: "
-		  << *dIt
-		  << " is not forward-linked from any package."
-		  << std::endl;
+	{
+	  std::cout << "Error: "
+		    << *dIt
+		    << " is not forward-linked from any package."
+		    << std::endl;
+	  ++errors;
+	}
 
       if(!(*dIt).solvers_begin().end() &&
 	 seenRevDeps.find(*dIt) == seenRevDeps.end())
-	std::cout << "Error: "
-		  << *dIt
-		  << " is not back-linked from any package."
-		  << std::endl;
+	   {
+	  std::cout << "Error: "
+		    << *dIt
+		    << " is not back-linked from any package."
+		    << std::endl;
+	     ++errors;
+	   }
 
     }
 
@@ -280,6 +308,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 		      << (*dIt)
 		      << " does not occur in its source's forward list."
 		      << std::endl;
+	    ++errors;
 	  }
       }
 
@@ -326,13 +355,16 @@ void sanity_check_universe(const PackageUniverse &universe)
 			{
 			  // TODO: check how many alternates *are* linked
 			  // (do all of them fail or just some?)
-			  std::cout << "Error: "
-				    << *dIt
-				    << " is not linked into the revdep list of "
-				    << *sIt
-				    << " and neither is the alternate version "
-				    << *vIt
-				    << std::endl;
+			    {
+			    std::cout << "Error: "
+				      << *dIt
+				      << " is not linked into the revdep list of "
+				      << *sIt
+				      << " and neither is the alternate version "
+				      << *vIt
+				      << std::endl;
+			      ++errors;
+			    }
 			}
 		    }
 		}
@@ -348,6 +380,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 		<< (*it)
 		<< " is contained in a package dep list but not the global dep list."
 		<< std::endl;
+      ++errors;
     }
 
   for(typename std::set<dep>::const_iterator it = seenRevDeps.begin();
@@ -357,6 +390,7 @@ void sanity_check_universe(const PackageUniverse &universe)
 		<< (*it)
 		<< " is contained in a package reverse dep list but not the global dep list."
 		<< std::endl;
+      ++errors;
     }
 
   resolver_initial_state<PackageUniverse>
@@ -371,6 +405,9 @@ void sanity_check_universe(const PackageUniverse &universe)
 		    << (*bdIt)
 		    <<" is in the broken dep list but isn't broken in the empty solution."
 		    << std::endl;
+	  ++errors;
 	}
     }
+
+  return errors;
 }
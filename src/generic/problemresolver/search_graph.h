@@ -857,6 +857,15 @@ public:
      */
     imm::map<version, choice> forbidden_versions;
 
+    /** \brief Maps the ID of each joint score (see solution_weights)
+     *  that some, but not all, of the actions of this step belong to
+     *  to the number of its choices that are in the actions.
+     *
+     *  Joint scores that were completed by this step or its parents
+     *  are not stored.
+     */
+    imm::map<unsigned int, unsigned int> joint_score_hits;
+
     // @}
 
     /** \brief Members related to backpropagating promotions. */
@@ -678,15 +678,31 @@ struct solution_weights
   {
     choice_set choices;
     int score;
+    unsigned int id;
+    unsigned int num_choices;
 
   public:
-    joint_score(const choice_set &_choices, int _score)
-      : choices(_choices), score(_score)
+    joint_score(const choice_set &_choices, int _score,
+		unsigned int _id, unsigned int _num_choices)
+      : choices(_choices), score(_score),
+	id(_id), num_choices(_num_choices)
     {
     }
 
     const choice_set &get_choices() const { return choices; }
     int get_score() const { return score; }
+
+    /** \brief The index of this score in the list of joint scores.
+     *
+     *  Steps use it to count how many of the choices of each joint
+     *  score they contain.
+     */
+    unsigned int get_id() const { return id; }
+
+    /** \brief The number of choices that must all be made for this
+     *  score to apply.
+     */
+    unsigned int get_num_choices() const { return num_choices; }
   };
 
   /** \brief Compare two choices only by the actions they take,
@@ -733,9 +749,13 @@ struct solution_weights
   int *version_scores;
 
 private:
-  /** \brief Scores that apply to simultaneous collections of choices.
+  /** \brief Scores that apply to simultaneous collections of
+   *  choices, indexed by each of their choices.
    *
-   *  \todo This should use smarter indexing, I think.
+   *  Steps keep a count of the choices of each joint score that
+   *  they contain, so that a joint score is only looked up when one
+   *  of its choices is added and applies when the count reaches its
+   *  size.
    */
   joint_score_set joint_scores;
 
@@ -846,10 +866,12 @@ public:
     if(any_is_current)
       return;
 
+    const unsigned int id = joint_scores_list.size();
     joint_scores_list.push_back(std::make_pair(versions, score));
 
     choices.for_each(add_to_joint_scores(joint_scores,
-					 typename solution_weights<PackageUniverse>::joint_score(choices, score)));
+					 typename solution_weights<PackageUniverse>::joint_score(choices, score,
+												 id, versions.size())));
   }
 
   const joint_score_set &get_joint_scores() const { return joint_scores; }
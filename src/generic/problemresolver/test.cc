@@ -82,6 +82,8 @@ logging::LoggerPtr aptitude::Loggers::getAptitudeResolverSearchCosts()
 //
 // The second DEP form is a Conflicts, and is implicitly converted to
 // dependency form internally.
+//
+// Between UNIVERSEs and TESTs, a line starting with "#" is a comment.
 
 namespace
 {
@@ -322,6 +324,13 @@ void run_test_file(istream &f, bool show_world)
 	// This is the only place where EOF is valid.
 	return;
 
+      if(f.peek() == '#')
+	{
+	  getline(f, s);
+	  f >> ws;
+	  continue;
+	}
+
       f >> s >> ws;
 
       if(s == "UNIVERSE")
@@ -0,0 +1,366 @@
+/** \file dense_id_set.h */   // -*-c++-*-
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+#ifndef APTITUDE_UTIL_DENSE_ID_SET_H
+#define APTITUDE_UTIL_DENSE_ID_SET_H
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief A set of objects that carry a small, dense ID, such as
+     *  the packages, versions or dependencies of a pkgCache.
+     *
+     *  Membership is stored as a bitset indexed by key->ID, so the
+     *  set must be created with room for every ID that it will hold
+     *  (for instance Head().PackageCount for packages).  Inserting,
+     *  erasing and testing keys take constant time and don't
+     *  allocate; iterating visits the members in the order in which
+     *  they were first inserted.
+     *
+     *  Keys that are erased stay in the iteration list (and are
+     *  skipped) until clear() is called, so a set that is used for
+     *  a long time with many insertions and erasures should be
+     *  cleared from time to time.
+     *
+     *  \tparam Key a copyable type such that key->ID is an integer
+     *  smaller than the number of IDs the set was created with; for
+     *  instance pkgCache::PkgIterator.
+     */
+    template<typename Key>
+    class dense_id_set
+    {
+      typedef unsigned long word;
+      static const std::size_t bits_per_word = sizeof(word) * 8;
+
+      /** The bit of each key that is currently a member. */
+      std::vector<word> members;
+      /** The bit of each key that is in "listed". */
+      std::vector<word> listed_bits;
+      /** Every key inserted since the last clear(), in order. */
+      std::vector<Key> listed;
+
+      std::size_t num_ids;
+      std::size_t count;
+
+      static bool get_bit(const std::vector<word> &bits, std::size_t id)
+      {
+	return (bits[id / bits_per_word] >> (id % bits_per_word)) & 1UL;
+      }
+
+      static void set_bit(std::vector<word> &bits, std::size_t id)
+      {
+	bits[id / bits_per_word] |= 1UL << (id % bits_per_word);
+      }
+
+      static void clear_bit(std::vector<word> &bits, std::size_t id)
+      {
+	bits[id / bits_per_word] &= ~(1UL << (id % bits_per_word));
+      }
+
+    public:
+      /** \brief Iterates over the members of a set in insertion order. */
+      class const_iterator
+      {
+	const dense_id_set *set;
+	typename std::vector<Key>::const_iterator it;
+
+	void skip_erased()
+	{
+	  while(it != set->listed.end() && !set->contains(*it))
+	    ++it;
+	}
+
+	friend class dense_id_set;
+
+	const_iterator(const dense_id_set *_set,
+		       typename std::vector<Key>::const_iterator _it)
+	  : set(_set), it(_it)
+	{
+	  skip_erased();
+	}
+
+      public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef Key value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const Key *pointer;
+	typedef const Key &reference;
+
+	const_iterator()
+	  : set(NULL)
+	{
+	}
+
+	const Key &operator*() const { return *it; }
+	const Key *operator->() const { return &*it; }
+
+	const_iterator &operator++()
+	{
+	  ++it;
+	  skip_erased();
+	  return *this;
+	}
+
+	const_iterator operator++(int)
+	{
+	  const_iterator rval(*this);
+	  ++*this;
+	  return rval;
+	}
+
+	bool operator==(const const_iterator &other) const { return it == other.it; }
+	bool operator!=(const const_iterator &other) const { return it != other.it; }
+      };
+
+      /** \brief Create an empty set that can hold no keys. */
+      dense_id_set()
+	: num_ids(0), count(0)
+      {
+      }
+
+      /** \brief Create an empty set that can hold keys whose IDs are
+       *  below _num_ids.
+       */
+      explicit dense_id_set(std::size_t _num_ids)
+	: members((_num_ids + bits_per_word - 1) / bits_per_word, 0),
+	  listed_bits((_num_ids + bits_per_word - 1) / bits_per_word, 0),
+	  num_ids(_num_ids), count(0)
+      {
+      }
+
+      /** \return the number of IDs that this set has room for. */
+      std::size_t get_num_ids() const { return num_ids; }
+
+      std::size_t size() const { return count; }
+      bool empty() const { return count == 0; }
+
+      bool contains(const Key &key) const
+      {
+	return get_bit(members, key->ID);
+      }
+
+      /** \brief Add a key to the set.
+       *
+       *  \return \b true if the key was not already a member.
+       */
+      bool insert(const Key &key)
+      {
+	const std::size_t id = key->ID;
+	if(get_bit(members, id))
+	  return false;
+
+	set_bit(members, id);
+	++count;
+	if(!get_bit(listed_bits, id))
+	  {
+	    set_bit(listed_bits, id);
+	    listed.push_back(key);
+	  }
+	return true;
+      }
+
+      /** \brief Remove a key from the set.
+       *
+       *  \return \b true if the key was a member.
+       */
+      bool erase(const Key &key)
+      {
+	const std::size_t id = key->ID;
+	if(!get_bit(members, id))
+	  return false;
+
+	clear_bit(members, id);
+	--count;
+	return true;
+      }
+
+      /** \brief Remove every key, in time proportional to the number
+       *  of keys inserted since the last call.
+       */
+      void clear()
+      {
+	for(typename std::vector<Key>::const_iterator it = listed.begin();
+	    it != listed.end(); ++it)
+	  {
+	    clear_bit(members, (*it)->ID);
+	    clear_bit(listed_bits, (*it)->ID);
+	  }
+
+	listed.clear();
+	count = 0;
+      }
+
+      /** \brief Add every member of other to this set (set union). */
+      void insert_all(const dense_id_set &other)
+      {
+	for(const_iterator it = other.begin(); it != other.end(); ++it)
+	  insert(*it);
+      }
+
+      /** \brief Remove every member of other from this set (set
+       *  difference).
+       */
+      void erase_all(const dense_id_set &other)
+      {
+	for(const_iterator it = other.begin(); it != other.end(); ++it)
+	  erase(*it);
+      }
+
+      /** \brief Remove every key that is not a member of other from
+       *  this set (set intersection).
+       */
+      void retain_all(const dense_id_set &other)
+      {
+	for(typename std::vector<Key>::const_iterator it = listed.begin();
+	    it != listed.end(); ++it)
+	  {
+	    if(!other.contains(*it))
+	      erase(*it);
+	  }
+      }
+
+      /** \return \b true if this set and other have a member in
+       *  common.
+       */
+      bool intersects(const dense_id_set &other) const
+      {
+	const dense_id_set &smaller = size() < other.size() ? *this : other;
+	const dense_id_set &larger = size() < other.size() ? other : *this;
+
+	for(const_iterator it = smaller.begin(); it != smaller.end(); ++it)
+	  {
+	    if(larger.contains(*it))
+	      return true;
+	  }
+
+	return false;
+      }
+
+      const_iterator begin() const { return const_iterator(this, listed.begin()); }
+      const_iterator end() const { return const_iterator(this, listed.end()); }
+
+      /** \return the number of bytes allocated by this set. */
+      std::size_t memory_size() const
+      {
+	return (members.capacity() + listed_bits.capacity()) * sizeof(word)
+	  + listed.capacity() * sizeof(Key);
+      }
+    };
+
+    /** \brief A map from objects that carry a small, dense ID to
+     *  values, stored as an array indexed by key->ID.
+     *
+     *  Every ID has a slot whether or not it is mapped, so this is
+     *  meant for values that are small or for maps that cover a
+     *  large part of the IDs.  Iterating over keys() visits the
+     *  mapped keys in the order in which they were first mapped.
+     *
+     *  \tparam Key as for dense_id_set.
+     *  \tparam Value a default-constructible, copyable type.
+     */
+    template<typename Key, typename Value>
+    class dense_id_map
+    {
+      dense_id_set<Key> mapped;
+      std::vector<Value> values;
+
+    public:
+      /** \brief Create an empty map that can hold no keys. */
+      dense_id_map()
+      {
+      }
+
+      /** \brief Create an empty map that can hold keys whose IDs are
+       *  below num_ids.
+       */
+      explicit dense_id_map(std::size_t num_ids)
+	: mapped(num_ids), values(num_ids)
+      {
+      }
+
+      std::size_t size() const { return mapped.size(); }
+      bool empty() const { return mapped.empty(); }
+
+      bool contains(const Key &key) const { return mapped.contains(key); }
+
+      /** \return the value of the given key, or \b NULL if it is not
+       *  mapped.
+       */
+      const Value *find(const Key &key) const
+      {
+	return mapped.contains(key) ? &values[key->ID] : NULL;
+      }
+
+      Value *find(const Key &key)
+      {
+	return mapped.contains(key) ? &values[key->ID] : NULL;
+      }
+
+      /** \return the value of the given key, mapping it to a
+       *  default-constructed value first if necessary.
+       */
+      Value &operator[](const Key &key)
+      {
+	if(mapped.insert(key))
+	  values[key->ID] = Value();
+	return values[key->ID];
+      }
+
+      /** \brief Remove the mapping of a key.
+       *
+       *  \return \b true if the key was mapped.
+       */
+      bool erase(const Key &key)
+      {
+	if(!mapped.erase(key))
+	  return false;
+
+	values[key->ID] = Value();
+	return true;
+      }
+
+      void clear()
+      {
+	for(typename dense_id_set<Key>::const_iterator it = mapped.begin();
+	    it != mapped.end(); ++it)
+	  values[(*it)->ID] = Value();
+
+	mapped.clear();
+      }
+
+      /** \return the set of mapped keys. */
+      const dense_id_set<Key> &keys() const { return mapped; }
+
+      /** \return the number of bytes allocated by this map, not
+       *  counting memory owned by the values.
+       */
+      std::size_t memory_size() const
+      {
+	return mapped.memory_size() + values.capacity() * sizeof(Value);
+      }
+    };
+  }
+}
+
+#endif // APTITUDE_UTIL_DENSE_ID_SET_H
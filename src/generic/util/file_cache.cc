@@ -19,6 +19,7 @@
 
 #include "file_cache.h"
 
+#include "memory_accounting.h"
 #include "sqlite.h"
 #include "util.h"
 
@@ -145,6 +146,11 @@ release upgrade23;							\
 	// (e.g., sqlite3_last_insert_rowid()) are not threadsafe.
 	cw::threads::mutex store_mutex;
 
+	/** \brief Reports the contents of the cache if it lives in
+	 *  memory; \b NULL for caches on disk.
+	 */
+	std::unique_ptr<memory_account> account;
+
 	static const int current_version_number = 3;
 
 	void create_new_database()
@@ -376,6 +382,51 @@ insert into globals(TotalBlobSize) values(0);				\
 	    create_new_database();
 	  else
 	    sanity_check_database();
+
+	  if(filename == ":memory:")
+	    account.reset(new memory_account("download cache (memory)",
+					     [this] { return get_memory_usage(); }));
+	}
+
+	~file_cache_sqlite()
+	{
+	  // Unregister before the database goes away.
+	  account.reset();
+	}
+
+	/** \brief Compute the size and number of the stored blobs. */
+	memory_usage get_memory_usage()
+	{
+	  cw::threads::mutex::lock l(store_mutex);
+
+	  try
+	    {
+	      memory_usage rval;
+
+	      sqlite::db::statement_proxy get_total_size_statement =
+		store->get_cached_statement("select TotalBlobSize from globals");
+	      {
+		statement::execution get_total_size_execution(*get_total_size_statement);
+		if(get_total_size_execution.step())
+		  rval.bytes = get_total_size_statement->get_int64(0);
+	      }
+
+	      sqlite::db::statement_proxy count_statement =
+		store->get_cached_statement("select count(*) from cache");
+	      {
+		statement::execution count_execution(*count_statement);
+		if(count_execution.step())
+		  rval.objects = count_statement->get_int64(0);
+	      }
+
+	      return rval;
+	    }
+	  catch(const cw::util::Exception &ex)
+	    {
+	      LOG_WARN(Loggers::getAptitudeDownloadCache(),
+		       "Can't compute the size of the in-memory cache: " << ex.errmsg());
+	      return memory_usage();
+	    }
 	}
 
 	void putItem(const std::string &key,
@@ -0,0 +1,287 @@
+/** \file memory_accounting.cc */   // -*-c++-*-
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+#include "memory_accounting.h"
+
+// System includes:
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <ostream>
+
+namespace aptitude
+{
+  namespace util
+  {
+    namespace
+    {
+      /** All the live accounts. */
+      struct account_registry
+      {
+	std::mutex mutex;
+	std::vector<memory_account *> accounts;
+
+	/** The number of samples of each account that were scheduled
+	 *  by a sampling_pass but not taken yet.  An account isn't
+	 *  destroyed until its count drops to zero.
+	 */
+	std::map<memory_account *, unsigned int> pending_samples;
+	std::condition_variable samples_taken;
+
+	/** The peaks of accounts that no longer exist, by subsystem,
+	 *  so that they survive closing and reloading the cache.
+	 */
+	std::map<std::string, memory_usage> retired_peaks;
+      };
+
+      // Constructed on first use, so that accounts that are static
+      // objects in other translation units can register themselves.
+      account_registry &get_registry()
+      {
+	static account_registry registry;
+	return registry;
+      }
+
+      /** \brief Samples the live accounts without holding the lock
+       *  of the registry.
+       *
+       *  Samplers take the locks of the structures that they walk
+       *  (for instance resolver_manager::mutex), and the threads
+       *  holding those locks may create or destroy accounts; invoking
+       *  the samplers with the registry locked could deadlock.
+       *  Instead, the accounts are listed with the lock held and
+       *  pinned until they have been sampled.
+       */
+      class sampling_pass
+      {
+	account_registry &registry;
+	std::vector<memory_account *> accounts;
+	std::vector<memory_account *>::size_type next;
+
+	void release(memory_account *account)
+	{
+	  std::lock_guard<std::mutex> l(registry.mutex);
+	  std::map<memory_account *, unsigned int>::iterator found =
+	    registry.pending_samples.find(account);
+	  if(--found->second == 0)
+	    {
+	      registry.pending_samples.erase(found);
+	      registry.samples_taken.notify_all();
+	    }
+	}
+
+      public:
+	explicit sampling_pass(account_registry &_registry)
+	  : registry(_registry), next(0)
+	{
+	  std::lock_guard<std::mutex> l(registry.mutex);
+	  accounts = registry.accounts;
+	  for(memory_account *account : accounts)
+	    ++registry.pending_samples[account];
+	}
+
+	sampling_pass(const sampling_pass &) = delete;
+	sampling_pass &operator=(const sampling_pass &) = delete;
+
+	/** \brief Release the accounts that weren't sampled, if a
+	 *  sampler threw an exception.
+	 */
+	~sampling_pass()
+	{
+	  for(; next < accounts.size(); ++next)
+	    release(accounts[next]);
+	}
+
+	/** \brief Sample each account and pass it to f. */
+	template<typename F>
+	void run(F f)
+	{
+	  for(; next < accounts.size(); ++next)
+	    {
+	      memory_account *account = accounts[next];
+	      f(*account, account->get_live());
+	      release(account);
+	    }
+	}
+      };
+
+      void raise_to(std::atomic<std::size_t> &peak, std::size_t value)
+      {
+	std::size_t current = peak.load();
+	while(value > current && !peak.compare_exchange_weak(current, value))
+	  ;
+      }
+    }
+
+    memory_account::memory_account(const std::string &_subsystem)
+      : subsystem(_subsystem),
+	live_bytes(0), live_objects(0),
+	peak_bytes(0), peak_objects(0)
+    {
+      account_registry &registry = get_registry();
+      std::lock_guard<std::mutex> l(registry.mutex);
+      registry.accounts.push_back(this);
+    }
+
+    memory_account::memory_account(const std::string &_subsystem,
+				   const sampler &_sample)
+      : subsystem(_subsystem),
+	sample(_sample),
+	live_bytes(0), live_objects(0),
+	peak_bytes(0), peak_objects(0)
+    {
+      account_registry &registry = get_registry();
+      std::lock_guard<std::mutex> l(registry.mutex);
+      registry.accounts.push_back(this);
+    }
+
+    memory_account::~memory_account()
+    {
+      account_registry &registry = get_registry();
+      std::unique_lock<std::mutex> l(registry.mutex);
+      registry.samples_taken.wait(l, [&registry, this] {
+	  return registry.pending_samples.find(this) == registry.pending_samples.end();
+	});
+      registry.accounts.erase(std::remove(registry.accounts.begin(),
+					  registry.accounts.end(),
+					  this),
+			      registry.accounts.end());
+
+      // Don't sample here: the structure that a sampler walks is
+      // usually gone by the time that its account is destroyed.
+      memory_usage &retired = registry.retired_peaks[subsystem];
+      retired.bytes = std::max<std::size_t>(retired.bytes, peak_bytes);
+      retired.objects = std::max<std::size_t>(retired.objects, peak_objects);
+    }
+
+    void memory_account::update_peaks(std::size_t bytes, std::size_t objects)
+    {
+      raise_to(peak_bytes, bytes);
+      raise_to(peak_objects, objects);
+    }
+
+    void memory_account::add(std::size_t bytes, std::size_t objects)
+    {
+      update_peaks(live_bytes += bytes, live_objects += objects);
+    }
+
+    void memory_account::remove(std::size_t bytes, std::size_t objects)
+    {
+      live_bytes -= bytes;
+      live_objects -= objects;
+    }
+
+    void memory_account::set(std::size_t bytes, std::size_t objects)
+    {
+      live_bytes = bytes;
+      live_objects = objects;
+      update_peaks(bytes, objects);
+    }
+
+    memory_usage memory_account::get_live()
+    {
+      if(sample)
+	{
+	  const memory_usage usage = sample();
+	  set(usage.bytes, usage.objects);
+	  return usage;
+	}
+
+      return memory_usage(live_bytes, live_objects);
+    }
+
+    memory_usage memory_account::get_peak() const
+    {
+      return memory_usage(peak_bytes, peak_objects);
+    }
+
+    std::vector<memory_report_entry> get_memory_report()
+    {
+      std::map<std::string, memory_report_entry> by_subsystem;
+      account_registry &registry = get_registry();
+
+      sampling_pass pass(registry);
+      pass.run([&by_subsystem] (memory_account &account, const memory_usage &live) {
+	  memory_report_entry &entry = by_subsystem[account.get_subsystem()];
+	  entry.subsystem = account.get_subsystem();
+	  entry.live += live;
+	  entry.peak += account.get_peak();
+	});
+
+      {
+	std::lock_guard<std::mutex> l(registry.mutex);
+
+	for(const std::pair<const std::string, memory_usage> &retired : registry.retired_peaks)
+	  {
+	    memory_report_entry &entry = by_subsystem[retired.first];
+	    entry.subsystem = retired.first;
+	    entry.peak.bytes = std::max(entry.peak.bytes, retired.second.bytes);
+	    entry.peak.objects = std::max(entry.peak.objects, retired.second.objects);
+	  }
+      }
+
+      std::vector<memory_report_entry> rval;
+      rval.reserve(by_subsystem.size());
+      for(const std::pair<const std::string, memory_report_entry> &entry : by_subsystem)
+	rval.push_back(entry.second);
+
+      return rval;
+    }
+
+    void sample_memory_accounts()
+    {
+      sampling_pass pass(get_registry());
+      pass.run([] (memory_account &, const memory_usage &) { });
+    }
+
+    void write_memory_report(std::ostream &out)
+    {
+      const std::vector<memory_report_entry> report = get_memory_report();
+
+      std::string::size_type name_width = 9;
+      for(const memory_report_entry &entry : report)
+	name_width = std::max(name_width, entry.subsystem.size());
+
+      const std::string row_format = (boost::format("%%-%ds %%14s %%10s %%14s %%10s\n") % name_width).str();
+
+      out << boost::format(row_format)
+	% "Subsystem" % "Live bytes" % "Objects" % "Peak bytes" % "Peak objs";
+
+      memory_usage total_live, total_peak;
+      for(const memory_report_entry &entry : report)
+	{
+	  out << boost::format(row_format)
+	    % entry.subsystem
+	    % entry.live.bytes % entry.live.objects
+	    % entry.peak.bytes % entry.peak.objects;
+
+	  total_live += entry.live;
+	  total_peak += entry.peak;
+	}
+
+      out << boost::format(row_format)
+	% "Total"
+	% total_live.bytes % total_live.objects
+	% total_peak.bytes % total_peak.objects;
+    }
+  }
+}
@@ -0,0 +1,177 @@
+/** \file memory_accounting.h */   // -*-c++-*-
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+#ifndef APTITUDE_UTIL_MEMORY_ACCOUNTING_H
+#define APTITUDE_UTIL_MEMORY_ACCOUNTING_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace aptitude
+{
+  namespace util
+  {
+    /** \brief An amount of memory and the number of objects using it. */
+    struct memory_usage
+    {
+      std::size_t bytes;
+      std::size_t objects;
+
+      memory_usage()
+	: bytes(0), objects(0)
+      {
+      }
+
+      memory_usage(std::size_t _bytes, std::size_t _objects)
+	: bytes(_bytes), objects(_objects)
+      {
+      }
+
+      memory_usage &operator+=(const memory_usage &other)
+      {
+	bytes += other.bytes;
+	objects += other.objects;
+	return *this;
+      }
+    };
+
+    /** \brief Keeps track of the memory used by one subsystem.
+     *
+     *  Accounts register themselves on construction and unregister
+     *  on destruction; get_memory_report() lists all the live ones.
+     *
+     *  An account is either maintained by its owner with add(),
+     *  remove() and set(), which is suitable for objects created and
+     *  destroyed one at a time, or computed on demand by a sampler
+     *  function, which is suitable for structures that are cheap to
+     *  walk but expensive to track.  In the latter case the peak is
+     *  the largest value seen by a sample; samples are taken by
+     *  get_memory_report() and sample_memory_accounts().
+     *
+     *  The figures are estimates: they cover the objects themselves
+     *  and the heap blocks that they own directly, but not allocator
+     *  overhead.
+     */
+    class memory_account
+    {
+    public:
+      typedef std::function<memory_usage ()> sampler;
+
+    private:
+      std::string subsystem;
+      sampler sample;
+
+      std::atomic<std::size_t> live_bytes, live_objects;
+      std::atomic<std::size_t> peak_bytes, peak_objects;
+
+      void update_peaks(std::size_t bytes, std::size_t objects);
+
+    public:
+      /** \brief Create an account maintained with add(), remove()
+       *  and set().
+       */
+      explicit memory_account(const std::string &_subsystem);
+
+      /** \brief Create an account computed by the given function.
+       *
+       *  The function may be invoked from any thread.  It is invoked
+       *  without holding the lock of the registry, so it may take
+       *  other locks and create accounts, but it must not destroy
+       *  accounts other than the ones that it created.
+       */
+      memory_account(const std::string &_subsystem,
+		     const sampler &_sample);
+
+      ~memory_account();
+
+      memory_account(const memory_account &) = delete;
+      memory_account &operator=(const memory_account &) = delete;
+
+      const std::string &get_subsystem() const { return subsystem; }
+
+      /** \brief Record that memory was allocated. */
+      void add(std::size_t bytes, std::size_t objects = 1);
+
+      /** \brief Record that memory was released. */
+      void remove(std::size_t bytes, std::size_t objects = 1);
+
+      /** \brief Replace the live figures. */
+      void set(std::size_t bytes, std::size_t objects);
+
+      /** \brief Get the live figures, sampling them if necessary. */
+      memory_usage get_live();
+
+      /** \brief Get the largest figures seen so far. */
+      memory_usage get_peak() const;
+    };
+
+    /** \brief The figures of one subsystem in a memory report. */
+    struct memory_report_entry
+    {
+      std::string subsystem;
+      memory_usage live;
+      memory_usage peak;
+    };
+
+    /** \brief Sample every account and return their figures.
+     *
+     *  Accounts with the same subsystem name are merged, and
+     *  subsystems whose accounts were all destroyed are listed with
+     *  their peak.  The entries are sorted by subsystem.
+     */
+    std::vector<memory_report_entry> get_memory_report();
+
+    /** \brief Sample every account computed on demand, so that their
+     *  peaks are up to date.
+     *
+     *  Invoke this before releasing large structures.
+     */
+    void sample_memory_accounts();
+
+    /** \brief Write a table of the current memory report. */
+    void write_memory_report(std::ostream &out);
+
+    /** \return The heap memory owned by the given string, or 0 if it
+     *  is stored inline.
+     */
+    inline std::size_t string_heap_bytes(const std::string &s)
+    {
+      static const std::string::size_type inline_capacity = std::string().capacity();
+      return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
+    }
+
+    /** \return An estimate of the memory used by the nodes of a
+     *  node-based container (std::set, std::map, std::list...) with
+     *  the given number of elements, not counting what the elements
+     *  themselves own.
+     */
+    template<typename T>
+    inline std::size_t node_container_bytes(std::size_t size)
+    {
+      // Red-black tree nodes carry a color and three pointers.
+      return size * (sizeof(T) + 4 * sizeof(void *));
+    }
+  }
+}
+
+#endif // APTITUDE_UTIL_MEMORY_ACCOUNTING_H
@@ -49,6 +49,7 @@
 #include <gtk/gui.h>
 #include <gtk/progress.h>
 
+#include <algorithm>
 #include <memory>
 
 using aptitude::Loggers;
@@ -138,147 +139,298 @@ namespace gui
     };
   }
 
-  // \todo Maybe support hiding older versions by default, with a
-  // clickable link at the end saying "show older versions...".
-  //
-  // NB: some changelogs aren't monotonically increasing, so that
-  // support should put a link wherever the "newness state" goes from
-  // newer to not-newer.
-  static Gtk::TextBuffer::iterator
-  do_render_changelog(const cwidget::util::ref_ptr<aptitude::apt::changelog> &cl,
-		      const Glib::RefPtr<Gtk::TextBuffer> &textBuffer,
-		      const std::string &current_version,
-		      Gtk::TextBuffer::iterator where,
-		      bool only_new)
+  namespace
   {
-    using aptitude::apt::changelog;
+    /** \brief How many changelog entries to render at once.
+     *
+     *  Entries newer than the installed version are always rendered
+     *  immediately; older history is rendered a chunk at a time when
+     *  the user asks for it, so that changelogs with decades of
+     *  history don't block the interface.
+     */
+    const aptitude::apt::changelog::size_type changelog_chunk_size = 50;
 
-    // Don't update the display until we finish everything.
-    TextBufferUserAction text_buffer_user_action_scope(textBuffer);
+    /** \brief The state of a changelog that is being rendered
+     *  incrementally.
+     */
+    struct changelog_render_state
+    {
+      cw::util::ref_ptr<aptitude::apt::changelog> cl;
+      std::string current_version;
+      bool only_new;
 
-    Glib::RefPtr<Gtk::TextBuffer::Tag> newer_tag(textBuffer->create_tag());
-    newer_tag->property_weight() = Pango::WEIGHT_SEMIBOLD;
-    newer_tag->property_weight_set() = true;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> newer_tag;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> number_tag;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_low_tag;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_medium_tag;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_high_tag;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_critical_tag;
+      Glib::RefPtr<Gtk::TextBuffer::Tag> date_tag;
+
+      /** \brief The index of the next entry to render. */
+      aptitude::apt::changelog::size_type next;
+      /** \brief Set once an entry ends the output in only_new mode. */
+      bool finished;
+      bool added_at_least_one;
+      std::string last_version;
+
+      changelog_render_state(const cw::util::ref_ptr<aptitude::apt::changelog> &_cl,
+			     const Glib::RefPtr<Gtk::TextBuffer> &_textBuffer,
+			     const std::string &_current_version,
+			     bool _only_new)
+	: cl(_cl),
+	  current_version(_current_version),
+	  only_new(_only_new),
+	  next(0),
+	  finished(false),
+	  added_at_least_one(false)
+      {
+	const Glib::RefPtr<Gtk::TextBuffer> &textBuffer(_textBuffer);
 
-    Glib::RefPtr<Gtk::TextBuffer::Tag> number_tag = textBuffer->create_tag();
-    number_tag->property_scale() = Pango::SCALE_LARGE;
+	newer_tag = textBuffer->create_tag();
+	newer_tag->property_weight() = Pango::WEIGHT_SEMIBOLD;
+	newer_tag->property_weight_set() = true;
 
-    Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_low_tag = textBuffer->create_tag();
+	number_tag = textBuffer->create_tag();
+	number_tag->property_scale() = Pango::SCALE_LARGE;
 
-    Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_medium_tag = textBuffer->create_tag();
-    urgency_medium_tag->property_weight() = Pango::WEIGHT_BOLD;
-    urgency_medium_tag->property_weight_set() = true;
+	urgency_low_tag = textBuffer->create_tag();
 
-    Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_high_tag = textBuffer->create_tag();
-    urgency_high_tag->property_weight() = Pango::WEIGHT_BOLD;
-    urgency_high_tag->property_weight_set() = true;
-    urgency_high_tag->property_foreground() = "#FF0000";
-    urgency_high_tag->property_foreground_set() = true;
+	urgency_medium_tag = textBuffer->create_tag();
+	urgency_medium_tag->property_weight() = Pango::WEIGHT_BOLD;
+	urgency_medium_tag->property_weight_set() = true;
 
-    // NB: "emergency" and "critical" are the same; thus saith
-    // Policy.
-    Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_critical_tag = textBuffer->create_tag();
-    urgency_critical_tag->property_weight() = Pango::WEIGHT_BOLD;
-    urgency_critical_tag->property_weight_set() = true;
-    urgency_critical_tag->property_scale() = Pango::SCALE_LARGE;
-    urgency_critical_tag->property_foreground() = "#FF0000";
-    urgency_critical_tag->property_foreground_set() = true;
+	urgency_high_tag = textBuffer->create_tag();
+	urgency_high_tag->property_weight() = Pango::WEIGHT_BOLD;
+	urgency_high_tag->property_weight_set() = true;
+	urgency_high_tag->property_foreground() = "#FF0000";
+	urgency_high_tag->property_foreground_set() = true;
 
-    Glib::RefPtr<Gtk::TextBuffer::Tag> date_tag = textBuffer->create_tag();
+	// NB: "emergency" and "critical" are the same; thus saith
+	// Policy.
+	urgency_critical_tag = textBuffer->create_tag();
+	urgency_critical_tag->property_weight() = Pango::WEIGHT_BOLD;
+	urgency_critical_tag->property_weight_set() = true;
+	urgency_critical_tag->property_scale() = Pango::SCALE_LARGE;
+	urgency_critical_tag->property_foreground() = "#FF0000";
+	urgency_critical_tag->property_foreground_set() = true;
 
-    // Remember whether we added any changelog entries, so we can show
-    // a message if there aren't any.
-    bool added_at_least_one = false;
-    std::string last_version;
+	date_tag = textBuffer->create_tag();
+      }
 
-    for(changelog::const_iterator it = cl->begin(); it != cl->end(); ++it)
+      bool is_newer(const cw::util::ref_ptr<aptitude::apt::changelog_entry> &ent) const
       {
-	cw::util::ref_ptr<aptitude::apt::changelog_entry> ent(*it);
+	return !current_version.empty() &&
+	  _system->VS->CmpVersion(ent->get_version(), current_version) > 0;
+      }
 
-	if(only_new)
-	  {
-	    // Check whether the version numbers in the changelog are
-	    // out-of-order.  We start with the most recent changelog
-	    // entry, so they should be decreasing.  If they aren't in
-	    // order, stop generating output.
-	    //
-	    // This is necessary because in practice, some package
-	    // changelogs contain many entries that are "newer" than
-	    // the most recent entry.  Including those entries
-	    // produces output that is both excessive and wrong.
-	    const bool retrograde =
-	      !last_version.empty() &&
-	      _system->VS->CmpVersion(ent->get_version(), last_version) > 0;
-	    if(retrograde)
-	      break;
-	    last_version = ent->get_version();
-	  }
+      /** \brief Return \b true if there are entries left to render. */
+      bool has_more() const
+      {
+	return !finished && next < cl->size();
+      }
+    };
 
-	bool newer =
-	  !current_version.empty() &&
-	  _system->VS->CmpVersion(ent->get_version(), current_version) > 0;
+    /** \brief Render up to count entries of the changelog, starting
+     *  at state->next.
+     */
+    Gtk::TextBuffer::iterator
+    render_changelog_entries(const std::shared_ptr<changelog_render_state> &state,
+			     const Glib::RefPtr<Gtk::TextBuffer> &textBuffer,
+			     Gtk::TextBuffer::iterator where,
+			     aptitude::apt::changelog::size_type count)
+    {
+      // Don't update the display until we finish the chunk.
+      TextBufferUserAction text_buffer_user_action_scope(textBuffer);
 
-	// If the current entry isn't newer, we would have to have
-	// out-of-order entries in order to see a newer one, so stop
-	// scanning the changelog at that point.
-	if(only_new && !newer)
-	  break;
+      for(; count > 0 && state->has_more(); --count, ++state->next)
+	{
+	  cw::util::ref_ptr<aptitude::apt::changelog_entry> ent(*(state->cl->begin() + state->next));
 
-	added_at_least_one = true;
+	  if(state->only_new)
+	    {
+	      // Check whether the version numbers in the changelog are
+	      // out-of-order.  We start with the most recent changelog
+	      // entry, so they should be decreasing.  If they aren't in
+	      // order, stop generating output.
+	      //
+	      // This is necessary because in practice, some package
+	      // changelogs contain many entries that are "newer" than
+	      // the most recent entry.  Including those entries
+	      // produces output that is both excessive and wrong.
+	      const bool retrograde =
+		!state->last_version.empty() &&
+		_system->VS->CmpVersion(ent->get_version(), state->last_version) > 0;
+	      if(retrograde)
+		{
+		  state->finished = true;
+		  break;
+		}
+	      state->last_version = ent->get_version();
+	    }
 
-	const bool use_newer_tag = !only_new && newer;
+	  const bool newer = state->is_newer(ent);
+
+	  // If the current entry isn't newer, we would have to have
+	  // out-of-order entries in order to see a newer one, so stop
+	  // scanning the changelog at that point.
+	  if(state->only_new && !newer)
+	    {
+	      state->finished = true;
+	      break;
+	    }
+
+	  state->added_at_least_one = true;
+
+	  const bool use_newer_tag = !state->only_new && newer;
+
+	  if(state->next > 0)
+	    where = textBuffer->insert(where, "\n\n");
+
+	  Glib::RefPtr<Gtk::TextBuffer::Mark> changelog_entry_mark;
+	  if(use_newer_tag)
+	    changelog_entry_mark = textBuffer->create_mark(where);
+
+	  // Can't hyperlink to the package name because it's a
+	  // source package name.  Plus, it might not exist.
+	  where = textBuffer->insert(where, ent->get_source());
+	  where = textBuffer->insert(where, " (");
+	  where = textBuffer->insert_with_tag(where,
+					      ent->get_version(),
+					      state->number_tag);
+	  where = textBuffer->insert(where, ") ");
+	  where = textBuffer->insert(where, ent->get_distribution());
+	  where = textBuffer->insert(where, "; urgency=");
+	  Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_tag;
+	  const std::string &urgency = ent->get_urgency();
+	  if(urgency == "low")
+	    urgency_tag = state->urgency_low_tag;
+	  else if(urgency == "medium")
+	    urgency_tag = state->urgency_medium_tag;
+	  else if(urgency == "high")
+	    urgency_tag = state->urgency_high_tag;
+	  else if(urgency == "critical" || urgency == "emergency")
+	    urgency_tag = state->urgency_critical_tag;
+
+	  if(urgency_tag)
+	    where = textBuffer->insert_with_tag(where, urgency, urgency_tag);
+	  else
+	    where = textBuffer->insert(where, urgency);
+
+	  where = textBuffer->insert(where, "\n");
+
+	  where = render_change_elements(ent->get_changes(), ent->get_elements()->get_elements(), textBuffer, where);
 
-	if(it != cl->begin())
 	  where = textBuffer->insert(where, "\n\n");
+	  where = textBuffer->insert(where, " -- ");
+	  where = textBuffer->insert(where, ent->get_maintainer());
+	  where = textBuffer->insert(where, " ");
+	  where = textBuffer->insert_with_tag(where, ent->get_date_str(), state->date_tag);
 
-	Glib::RefPtr<Gtk::TextBuffer::Mark> changelog_entry_mark;
-	if(use_newer_tag)
-	  changelog_entry_mark = textBuffer->create_mark(where);
-
-	// Can't hyperlink to the package name because it's a
-	// source package name.  Plus, it might not exist.
-	where = textBuffer->insert(where, ent->get_source());
-	where = textBuffer->insert(where, " (");
-	where = textBuffer->insert_with_tag(where,
-					    ent->get_version(),
-					    number_tag);
-	where = textBuffer->insert(where, ") ");
-	where = textBuffer->insert(where, ent->get_distribution());
-	where = textBuffer->insert(where, "; urgency=");
-	Glib::RefPtr<Gtk::TextBuffer::Tag> urgency_tag;
-	const std::string &urgency = ent->get_urgency();
-	if(urgency == "low")
-	  urgency_tag = urgency_low_tag;
-	else if(urgency == "medium")
-	  urgency_tag = urgency_medium_tag;
-	else if(urgency == "high")
-	  urgency_tag = urgency_high_tag;
-	else if(urgency == "critical" || urgency == "emergency")
-	  urgency_tag = urgency_critical_tag;
-
-	if(urgency_tag)
-	  where = textBuffer->insert_with_tag(where, urgency, urgency_tag);
-	else
-	  where = textBuffer->insert(where, urgency);
+	  if(use_newer_tag)
+	    {
+	      Gtk::TextBuffer::iterator start = textBuffer->get_iter_at_mark(changelog_entry_mark);
+	      textBuffer->apply_tag(state->newer_tag, start, where);
+	      textBuffer->delete_mark(changelog_entry_mark);
+	    }
+	}
+
+      return where;
+    }
 
-	where = textBuffer->insert(where, "\n");
+    Gtk::TextBuffer::iterator
+    add_show_older_link(const std::shared_ptr<changelog_render_state> &state,
+			const Glib::RefPtr<Gtk::TextBuffer> &textBuffer,
+			Gtk::TextBuffer::iterator where);
 
-	where = render_change_elements(ent->get_changes(), ent->get_elements()->get_elements(), textBuffer, where);
+    /** \brief Replace the "show older entries" link between the two
+     *  marks with the next chunk of entries.
+     */
+    void show_older_entries(const std::shared_ptr<changelog_render_state> &state,
+			    const Glib::RefPtr<Gtk::TextBuffer::Mark> &link_begin,
+			    const Glib::RefPtr<Gtk::TextBuffer::Mark> &link_end)
+    {
+      if(link_begin->get_deleted() || link_end->get_deleted())
+	return;
 
-	where = textBuffer->insert(where, "\n\n");
-	where = textBuffer->insert(where, " -- ");
-	where = textBuffer->insert(where, ent->get_maintainer());
-	where = textBuffer->insert(where, " ");
-	where = textBuffer->insert_with_tag(where, ent->get_date_str(), date_tag);
+      // The buffer is fetched from the marks rather than stored in
+      // the state, since the state is owned by the buffer's link.
+      Glib::RefPtr<Gtk::TextBuffer> textBuffer(link_begin->get_buffer());
 
-	if(use_newer_tag)
-	  {
-	    Gtk::TextBuffer::iterator start = textBuffer->get_iter_at_mark(changelog_entry_mark);
-	    textBuffer->apply_tag(newer_tag, start, where);
-	  }
-      }
+      Gtk::TextBuffer::iterator where =
+	textBuffer->erase(textBuffer->get_iter_at_mark(link_begin),
+			  textBuffer->get_iter_at_mark(link_end));
+      textBuffer->delete_mark(link_begin);
+      textBuffer->delete_mark(link_end);
+
+      where = render_changelog_entries(state, textBuffer, where, changelog_chunk_size);
+      add_show_older_link(state, textBuffer, where);
+    }
+
+    void show_older_entries_when_idle(const std::shared_ptr<changelog_render_state> &state,
+				      const Glib::RefPtr<Gtk::TextBuffer::Mark> &link_begin,
+				      const Glib::RefPtr<Gtk::TextBuffer::Mark> &link_end)
+    {
+      // The link is being clicked, so it can't be erased from here;
+      // render the next chunk once the click has been handled.
+      Glib::signal_idle().connect(sigc::bind_return(sigc::bind(sigc::ptr_fun(&show_older_entries),
+							       state, link_begin, link_end),
+						    false));
+    }
+
+    /** \brief If any entries remain, add a link that renders the next
+     *  chunk of them.
+     */
+    Gtk::TextBuffer::iterator
+    add_show_older_link(const std::shared_ptr<changelog_render_state> &state,
+			const Glib::RefPtr<Gtk::TextBuffer> &textBuffer,
+			Gtk::TextBuffer::iterator where)
+    {
+      if(!state->has_more() || state->only_new)
+	return where;
+
+      const unsigned long shown =
+	std::min(state->cl->size() - state->next, changelog_chunk_size);
+
+      // The begin mark stays put and the end mark moves forward as
+      // the link text is inserted, so together they delimit the link.
+      Glib::RefPtr<Gtk::TextBuffer::Mark> link_begin = textBuffer->create_mark(where, true);
+      Glib::RefPtr<Gtk::TextBuffer::Mark> link_end = textBuffer->create_mark(where, false);
+
+      where = textBuffer->insert(where, "\n\n");
+      where = add_hyperlink(textBuffer, where,
+			    cw::util::ssprintf(ngettext("Show %lu older entry...",
+							"Show %lu older entries...",
+							shown),
+					       shown),
+			    sigc::bind(sigc::ptr_fun(&show_older_entries_when_idle),
+				       state, link_begin, link_end));
+
+      return where;
+    }
+  }
+
+  static Gtk::TextBuffer::iterator
+  do_render_changelog(const cwidget::util::ref_ptr<aptitude::apt::changelog> &cl,
+		      const Glib::RefPtr<Gtk::TextBuffer> &textBuffer,
+		      const std::string &current_version,
+		      Gtk::TextBuffer::iterator where,
+		      bool only_new)
+  {
+    std::shared_ptr<changelog_render_state> state =
+      std::make_shared<changelog_render_state>(cl, textBuffer, current_version, only_new);
+
+    // Render every entry that is newer than the installed version,
+    // and at least one chunk.
+    aptitude::apt::changelog::size_type first_chunk = 0;
+    for(aptitude::apt::changelog::const_iterator it = cl->begin();
+	it != cl->end() && state->is_newer(*it); ++it)
+      ++first_chunk;
+    first_chunk = std::max(first_chunk, changelog_chunk_size);
 
-    if(!added_at_least_one)
+    where = render_changelog_entries(state, textBuffer, where, first_chunk);
+
+    if(!state->added_at_least_one)
       {
 	if(cl->size() == 0)
 	  where = textBuffer->insert(where, _("The changelog is empty."));
@@ -288,7 +440,7 @@ namespace gui
 	  where = textBuffer->insert(where, _("No new changelog entries; this is likely due to a binary-only upload of this package."));
       }
 
-    return where;
+    return add_show_older_link(state, textBuffer, where);
   }
 
   Gtk::TextBuffer::iterator
@@ -39,10 +39,15 @@
 #include <generic/apt/matching/pattern.h>
 #include <generic/apt/resolver_manager.h>
 
+#include <generic/util/job_queue_thread.h>
 #include <generic/util/undo.h>
 
+#include <apt-pkg/strutl.h>
+
 #include <cwidget/generic/util/ssprintf.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
 namespace cw = cwidget;
@@ -74,6 +79,144 @@ namespace
 
     return rval;
   }
+
+  // The number of the most recent upgrade summary request.  Jobs for
+  // older requests are skipped without looking at their snapshot,
+  // which might refer to a cache that has since been closed.
+  std::atomic<unsigned long> latest_upgrade_summary_request(0);
+
+  class upgrade_summary_job
+  {
+    unsigned long request;
+    std::shared_ptr<const aptitudeDepCache::state_snapshot> snapshot;
+    safe_slot1<void, std::shared_ptr<gui::upgrade_list> > upgrades_slot;
+    safe_slot1<void, gui::upgrade_summary_stats> stats_slot;
+
+  public:
+    upgrade_summary_job(unsigned long _request,
+			const std::shared_ptr<const aptitudeDepCache::state_snapshot> &_snapshot,
+			const safe_slot1<void, std::shared_ptr<gui::upgrade_list> > &_upgrades_slot,
+			const safe_slot1<void, gui::upgrade_summary_stats> &_stats_slot)
+      : request(_request),
+	snapshot(_snapshot),
+	upgrades_slot(_upgrades_slot),
+	stats_slot(_stats_slot)
+    {
+    }
+
+    unsigned long get_request() const { return request; }
+    const aptitudeDepCache::state_snapshot &get_snapshot() const { return *snapshot; }
+    const safe_slot1<void, std::shared_ptr<gui::upgrade_list> > &get_upgrades_slot() const { return upgrades_slot; }
+    const safe_slot1<void, gui::upgrade_summary_stats> &get_stats_slot() const { return stats_slot; }
+  };
+
+  std::ostream &operator<<(std::ostream &out, const std::shared_ptr<upgrade_summary_job> &job)
+  {
+    return out << "(request=" << job->get_request()
+	       << ", generation=" << job->get_snapshot().get_generation()
+	       << ")";
+  }
+
+  /** \brief Computes the dashboard's upgrade summaries.
+   *
+   *  This is a self-terminating singleton thread.
+   */
+  class upgrade_summary_thread
+    : public aptitude::util::job_queue_thread<upgrade_summary_thread,
+					      std::shared_ptr<upgrade_summary_job> >
+  {
+    // Set to true when the global signal handlers are connected up.
+    static bool signals_connected;
+
+    // Like aptitudeDepCache::get_upgradable(true), but reading the
+    // given snapshot.
+    static bool is_upgradable(const aptitudeDepCache::state_snapshot &state,
+			      const pkgCache::PkgIterator &pkg,
+			      const pkgCache::VerIterator &candver)
+    {
+      if(pkg.CurrentVer().end() || candver.end() || candver == pkg.CurrentVer())
+	return false;
+
+      const aptitude_state &estate = state.get_ext_state(pkg);
+      switch(estate.selection_state)
+	{
+	case pkgCache::State::Unknown:
+	case pkgCache::State::Install:
+	  return candver.VerStr() != estate.forbidver;
+	default:
+	  return false;
+	}
+    }
+
+  public:
+    static logging::LoggerPtr get_log_category()
+    {
+      return Loggers::getAptitudeGtkDashboardUpgradeResolver();
+    }
+
+    upgrade_summary_thread()
+    {
+      if(!signals_connected)
+	{
+	  cache_closed.connect(sigc::ptr_fun(&upgrade_summary_thread::stop));
+	  cache_reloaded.connect(sigc::ptr_fun(&upgrade_summary_thread::start));
+	  signals_connected = true;
+	}
+    }
+
+    void process_job(const std::shared_ptr<upgrade_summary_job> &job)
+    {
+      logging::LoggerPtr logger(get_log_category());
+
+      if(job->get_request() != latest_upgrade_summary_request.load())
+	{
+	  LOG_TRACE(logger, "Skipping the stale upgrade summary request " << job->get_request());
+	  return;
+	}
+
+      const aptitudeDepCache::state_snapshot &state = job->get_snapshot();
+      pkgCache &cache = state.get_cache();
+
+      // Stage 1: the upgrades themselves.
+      std::shared_ptr<gui::upgrade_list> upgrades = std::make_shared<gui::upgrade_list>();
+      for(pkgCache::PkgIterator pkg = cache.PkgBegin(); !pkg.end(); ++pkg)
+	{
+	  const pkgDepCache::StateCache &pkg_state = state[pkg];
+	  pkgCache::VerIterator candver = pkg_state.CandidateVerIter(cache);
+
+	  if(pkg->CurrentState == pkgCache::State::Installed &&
+	     pkg_state.Upgradable() && !candver.end())
+	    upgrades->versions.push_back(candver);
+
+	  if(is_upgradable(state, pkg, candver))
+	    upgrades->upgradable.push_back(pkg);
+	}
+
+      std::sort(upgrades->versions.begin(), upgrades->versions.end(), ver_name_lt());
+
+      LOG_DEBUG(logger, "Found " << upgrades->versions.size() << " upgrades, "
+		<< upgrades->upgradable.size() << " of which can be installed, in the state generation "
+		<< state.get_generation());
+
+      post_event(safe_bind(job->get_upgrades_slot(), upgrades));
+
+      // Stage 2: what the upgrades amount to.
+      gui::upgrade_summary_stats stats;
+      stats.num_security = 0;
+      stats.download_size = 0;
+      for(std::vector<pkgCache::VerIterator>::const_iterator it =
+	    upgrades->versions.begin(); it != upgrades->versions.end(); ++it)
+	{
+	  if(is_security(*it, state.get_pkg_file_table()))
+	    ++stats.num_security;
+
+	  stats.download_size += (*it)->Size;
+	}
+
+      post_event(safe_bind(job->get_stats_slot(), stats));
+    }
+  };
+  bool upgrade_summary_thread::signals_connected = false;
 }
 
 namespace gui
@@ -272,7 +415,7 @@ namespace gui
   }
 
   // Download all the changelogs and show the new entries.
-  void DashboardTab::create_upgrade_summary()
+  void DashboardTab::create_upgrade_summary(const std::vector<pkgCache::VerIterator> &versions)
   {
     if(apt_cache_file == NULL)
       return;
@@ -287,36 +430,6 @@ namespace gui
     header_tag->property_scale() = Pango::SCALE_X_LARGE;
     header_tag->property_scale_set() = true;
 
-    cwidget::util::ref_ptr<guiOpProgress> p(guiOpProgress::create());
-
-    std::vector<pkgCache::VerIterator> versions;
-
-    {
-      int i = 0;
-      p->OverallProgress(i, (*apt_cache_file)->Head().PackageCount, 1,
-			 _("Preparing to download changelogs"));
-
-      for(pkgCache::PkgIterator pkg = (*apt_cache_file)->PkgBegin();
-	  !pkg.end(); ++pkg)
-	{
-	  if(pkg->CurrentState == pkgCache::State::Installed &&
-	     (*apt_cache_file)[pkg].Upgradable())
-	    {
-	      pkgCache::VerIterator candver = (*apt_cache_file)[pkg].CandidateVerIter(*apt_cache_file);
-
-	      if(!candver.end())
-		versions.push_back(candver);
-	    }
-
-	  ++i;
-	  p->Progress(i);
-	}
-
-      p->Done();
-    }
-
-    std::sort(versions.begin(), versions.end(), ver_name_lt());
-
     upgrades_summary_textview->set_buffer(text_buffer);
 
     for(std::vector<pkgCache::VerIterator>::const_iterator it =
@@ -375,8 +488,96 @@ namespace gui
     changelog_locations.swap(changelog_locations_new);
   }
 
+  void DashboardTab::request_upgrade_summary(bool show_changelogs)
+  {
+    logging::LoggerPtr logger(Loggers::getAptitudeGtkDashboardUpgradeResolver());
+
+    if(apt_cache_file == NULL)
+      return;
+
+    const unsigned long request = ++latest_upgrade_summary_request;
+    upgrade_stats_valid = false;
+    changelogs_pending = changelogs_pending || show_changelogs;
+
+    LOG_TRACE(logger, "Requesting the upgrade summary " << request << " in the background.");
+
+    if(show_changelogs)
+      {
+	changelog_locations.clear();
+	Glib::RefPtr<Gtk::TextBuffer> text_buffer = Gtk::TextBuffer::create();
+	text_buffer->set_text(_("Preparing to download changelogs"));
+	upgrades_summary_textview->set_buffer(text_buffer);
+      }
+
+    sigc::slot1<void, std::shared_ptr<upgrade_list> > upgrades_slot =
+      sigc::bind(sigc::mem_fun(*this, &DashboardTab::upgrades_computed),
+		 request);
+    sigc::slot1<void, upgrade_summary_stats> stats_slot =
+      sigc::bind(sigc::mem_fun(*this, &DashboardTab::upgrade_stats_computed),
+		 request);
+
+    upgrade_summary_thread::add_job(std::make_shared<upgrade_summary_job>(request,
+									  (*apt_cache_file)->get_state_snapshot(),
+									  make_safe_slot(upgrades_slot),
+									  make_safe_slot(stats_slot)));
+
+    LOG_TRACE(logger, "Setting up the progress bar.");
+    upgrade_resolver_progress->show();
+    upgrade_resolver_progress->set_text(_("Calculating upgrade..."));
+    upgrade_resolver_progress->pulse();
+    upgrade_resolver_label->hide();
+    fix_manually_button->set_sensitive(false);
+    upgrade_button->set_sensitive(false);
+
+    pulse_progress_connection.disconnect(); // Just extra paranoia.
+    pulse_progress_connection = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &DashboardTab::pulse_progress_timeout),
+								       3);
+  }
+
+  void DashboardTab::upgrades_computed(std::shared_ptr<upgrade_list> upgrades,
+				       unsigned long request)
+  {
+    logging::LoggerPtr logger(Loggers::getAptitudeGtkDashboardUpgradeResolver());
+
+    if(apt_cache_file == NULL || request != latest_upgrade_summary_request.load())
+      {
+	LOG_TRACE(logger, "Discarding the upgrades of the stale summary request " << request);
+	return;
+      }
+
+    LOG_TRACE(logger, "Received the upgrades of the summary request " << request);
+
+    upgradable_packages.swap(upgrades->upgradable);
+
+    if(changelogs_pending)
+      {
+	changelogs_pending = false;
+	create_upgrade_summary(upgrades->versions);
+      }
+
+    make_resolver();
+  }
+
+  void DashboardTab::upgrade_stats_computed(upgrade_summary_stats stats,
+					    unsigned long request)
+  {
+    if(apt_cache_file == NULL || request != latest_upgrade_summary_request.load())
+      return;
+
+    upgrade_stats = stats;
+    upgrade_stats_valid = true;
+    update_available_upgrades_label();
+  }
+
   void DashboardTab::handle_cache_closed()
   {
+    // Drop any summary that is still being computed.
+    ++latest_upgrade_summary_request;
+    upgradable_packages.clear();
+    upgrade_stats_valid = false;
+
+    // The reload requests them again.
+    changelogs_pending = false;
     changelog_locations.clear();
     discard_resolver();
     available_upgrades_label->set_text(_("Available upgrades:"));
@@ -385,24 +586,41 @@ namespace gui
   void DashboardTab::handle_cache_reloaded()
   {
     (*apt_cache_file)->pre_package_state_changed.connect(sigc::mem_fun(*this, &DashboardTab::discard_resolver));
-    (*apt_cache_file)->package_state_changed.connect(sigc::mem_fun(*this, &DashboardTab::make_resolver));
-    make_resolver();
+    (*apt_cache_file)->package_state_changed.connect(sigc::bind(sigc::mem_fun(*this, &DashboardTab::request_upgrade_summary),
+								false));
+    request_upgrade_summary(true);
   }
 
-  void DashboardTab::handle_upgrades_store_reloaded()
+  void DashboardTab::update_available_upgrades_label()
   {
     // Slightly lame: we know that the upgrade view will have as
     // many rows as there are upgrades, so just count the number of
     // rows (rather than re-calculating that and maybe being slow or
     // inconsistent).
     int num_upgrades = upgrades_pkg_view->get_model()->children().size();
-    const char *text(ngettext("%d available upgrade:",
-			      "%d available upgrades:",
-			      num_upgrades));
-    std::string formatted_text = cw::util::ssprintf(text, num_upgrades);
+    std::string formatted_text;
+    if(upgrade_stats_valid)
+      formatted_text =
+	cw::util::ssprintf(ngettext("%d available upgrade (%d security, %sB to download):",
+				    "%d available upgrades (%d security, %sB to download):",
+				    num_upgrades),
+			   num_upgrades,
+			   upgrade_stats.num_security,
+			   SizeToStr(upgrade_stats.download_size).c_str());
+    else
+      formatted_text =
+	cw::util::ssprintf(ngettext("%d available upgrade:",
+				    "%d available upgrades:",
+				    num_upgrades),
+			   num_upgrades);
     available_upgrades_label->set_text(formatted_text);
   }
 
+  void DashboardTab::handle_upgrades_store_reloaded()
+  {
+    update_available_upgrades_label();
+  }
+
   class DashboardTab::upgrade_continuation : public resolver_manager::background_continuation
   {
     safe_slot1<void, generic_solution<aptitude_universe> > success_slot;
@@ -482,7 +700,18 @@ namespace gui
     else
       {
 	LOG_TRACE(logger, "Creating a new resolver for the dashboard tab.");
-	upgrade_resolver = new resolver_manager(apt_cache_file, get_upgradable());
+
+	imm::map<aptitude_resolver_package, aptitude_resolver_version> initial_installations;
+	for(std::vector<pkgCache::PkgIterator>::const_iterator it =
+	      upgradable_packages.begin(); it != upgradable_packages.end(); ++it)
+	  {
+	    pkgCache::VerIterator ver((*apt_cache_file)[*it].CandidateVerIter(*apt_cache_file));
+
+	    initial_installations.put(aptitude_resolver_package(*it, *apt_cache_file),
+				      aptitude_resolver_version::make_install(ver, *apt_cache_file));
+	  }
+
+	upgrade_resolver = new resolver_manager(apt_cache_file, initial_installations);
 
 	if(!upgrade_resolver->resolver_exists())
 	  {
@@ -519,18 +748,6 @@ namespace gui
 
 	  upgrade_resolver->safe_resolve_deps_background(false, true, k, &post_thunk);
 	}
-
-	LOG_TRACE(logger, "Setting up the progress bar.");
-	upgrade_resolver_progress->show();
-	upgrade_resolver_progress->set_text(_("Calculating upgrade..."));
-	upgrade_resolver_progress->pulse();
-	upgrade_resolver_label->hide();
-	fix_manually_button->set_sensitive(false);
-	upgrade_button->set_sensitive(false);
-
-	pulse_progress_connection.disconnect(); // Just extra paranoia.
-	pulse_progress_connection = Glib::signal_timeout().connect_seconds(sigc::mem_fun(*this, &DashboardTab::pulse_progress_timeout),
-									   3);
       }
   }
 
@@ -582,15 +799,14 @@ namespace gui
 
     fixing_upgrade.solution_calculated(upgrade_solution);
 
-    std::set<pkgCache::PkgIterator> upgrades;
-    (*apt_cache_file)->get_upgradable(true, upgrades);
+    const std::vector<pkgCache::PkgIterator> &upgrades(upgradable_packages);
 
     // Find out how many upgrades will be installed.
     int num_upgrades_selected;
     if(sol.valid())
       {
 	num_upgrades_selected = 0;
-	for(std::set<pkgCache::PkgIterator>::const_iterator it = upgrades.begin();
+	for(std::vector<pkgCache::PkgIterator>::const_iterator it = upgrades.begin();
 	    it != upgrades.end(); ++it)
 	  {
 	    aptitude_resolver_package pkg(*it, *apt_cache_file);
@@ -701,7 +917,9 @@ namespace gui
 	  Gnome::Glade::Xml::create(glade_main_file, "dashboard_main"),
 	  "dashboard_main"),
       upgrade_resolver(NULL),
-      background_upgrade_redirect(NULL)
+      background_upgrade_redirect(NULL),
+      upgrade_stats_valid(false),
+      changelogs_pending(false)
   {
     get_xml()->get_widget("dashboard_upgrades_selected_package_textview",
 			  upgrades_changelog_view);
@@ -760,9 +978,6 @@ namespace gui
     // packages that would be upgraded?
     upgrades_pkg_view->set_limit(aptitude::matching::pattern::make_upgradable());
 
-    cache_reloaded.connect(sigc::mem_fun(*this, &DashboardTab::create_upgrade_summary));
-    create_upgrade_summary();
-
     upgrade_button->set_image(*manage(new Gtk::Image(Gtk::Stock::GO_UP, Gtk::ICON_SIZE_BUTTON)));
     upgrade_button->signal_clicked().connect(sigc::mem_fun(*this, &DashboardTab::do_upgrade));
 
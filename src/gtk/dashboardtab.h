@@ -25,6 +25,9 @@
 
 #include <gtkmm.h>
 
+#include <memory>
+#include <vector>
+
 #include "tab.h"
 
 /** \file dashboardtab.h */
@@ -43,6 +46,31 @@ class resolver_manager;
 
 namespace gui
 {
+  /** \brief The upgrades shown by the dashboard, as computed from a
+   *  snapshot of the package states.
+   */
+  struct upgrade_list
+  {
+    /** \brief The candidate version of each installed package that
+     *  can be upgraded, sorted by package name.
+     */
+    std::vector<pkgCache::VerIterator> versions;
+
+    /** \brief The packages that would be upgraded, excluding held
+     *  and removed packages (see aptitudeDepCache::get_upgradable()).
+     */
+    std::vector<pkgCache::PkgIterator> upgradable;
+  };
+
+  /** \brief Statistics about the versions of an upgrade_list. */
+  struct upgrade_summary_stats
+  {
+    /** \brief How many of the upgrades come from a security archive. */
+    int num_security;
+    /** \brief The total size of the upgrades' archives. */
+    unsigned long long download_size;
+  };
+
   class PkgView;
   class PackageSearchEntry;
   class ResolverTab;
@@ -181,6 +209,23 @@ namespace gui
 
     Gtk::Label *available_upgrades_label;
 
+    // The packages that the upgrade resolver starts from, as computed
+    // by the most recent upgrade summary.
+    std::vector<pkgCache::PkgIterator> upgradable_packages;
+
+    // Set to true once the statistics of the most recent upgrade
+    // summary have arrived; until then, the label only shows the
+    // number of upgrades.
+    bool upgrade_stats_valid;
+    upgrade_summary_stats upgrade_stats;
+
+    // Set to true when a summary that shows the changelogs is
+    // requested, and back to false once they are displayed.  Requests
+    // that supersede it inherit it, so that the changelogs are shown
+    // even if the package states change before the first summary
+    // arrives.
+    bool changelogs_pending;
+
     // Maps each version displayed in the upgrade list to the location
     // of its changelog in the changelog text view.
     std::map<pkgCache::VerIterator, Glib::RefPtr<Gtk::TextBuffer::Mark> > changelog_locations;
@@ -191,12 +236,44 @@ namespace gui
 
     void do_fix_manually();
 
-    // Download all the changelogs and show the new entries.
-    void create_upgrade_summary();
+    // Download all the changelogs of the given versions and show the
+    // new entries.
+    void create_upgrade_summary(const std::vector<pkgCache::VerIterator> &versions);
+
+    /** \brief Start computing the upgrade summary in the background.
+     *
+     *  The upgradable packages are found in a snapshot of the package
+     *  states by a background thread, which publishes its results in
+     *  two stages: upgrades_computed() receives the list of upgrades
+     *  and starts the resolver, then upgrade_stats_computed()
+     *  receives the sizes and the number of security updates.
+     *  Results of earlier requests are discarded.
+     *
+     *  \param show_changelogs  If \b true, the changelogs of the
+     *                          upgrades are fetched and displayed
+     *                          when the list arrives.  They are
+     *                          also displayed if an earlier request
+     *                          that asked for them was superseded
+     *                          before its list arrived.
+     */
+    void request_upgrade_summary(bool show_changelogs);
+
+    /** \brief Invoked in the foreground with the first stage of an
+     *  upgrade summary.
+     */
+    void upgrades_computed(std::shared_ptr<upgrade_list> upgrades,
+			   unsigned long request);
+
+    /** \brief Invoked in the foreground with the second stage of an
+     *  upgrade summary.
+     */
+    void upgrade_stats_computed(upgrade_summary_stats stats,
+				unsigned long request);
 
     void handle_cache_closed();
     void handle_cache_reloaded();
 
+    void update_available_upgrades_label();
     void handle_upgrades_store_reloaded();
 
     void activated_upgrade_package_handler();
@@ -239,11 +316,12 @@ namespace gui
 
 
     class upgrade_continuation;
-    /** \brief Create the internal resolver if it doesn't exist and
-     *  start its calculation.
+    /** \brief Create the internal resolver from upgradable_packages
+     *  if it doesn't exist and start its calculation.
      *
-     *  Shows the progress bar and hides the label; makes the button
-     *  inactive and kicks off a timer to pulse the progress bar.
+     *  The progress bar is set up by request_upgrade_summary(), which
+     *  arranges for this to be invoked once the upgradable packages
+     *  are known.
      */
     void make_resolver();
     /** \brief Throw away the internal resolver and solution, and hide
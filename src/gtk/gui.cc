@@ -957,6 +957,8 @@ namespace gui
       std::shared_ptr<download_install_manager> m =
 	std::make_shared<download_install_manager>(false,
 						   sigc::ptr_fun(&gui_run_dpkg));
+      // dpkg runs in a forked terminal process here.
+      m->disable_pipelining();
 
       start_download(m,
 		     _("Downloading packages"),
@@ -973,10 +975,14 @@ namespace gui
   {
     if(apt_cache_file)
     {
-      aptitudeDepCache::action_group group(*apt_cache_file, NULL);
       undo_group *undo=new apt_undo_group;
 
-      (*apt_cache_file)->mark_all_upgradable(true, true, undo);
+      {
+	// The undo items are only added when the group ends.
+	aptitudeDepCache::action_group group(*apt_cache_file, undo);
+
+	(*apt_cache_file)->mark_all_upgradable(true, true, undo);
+      }
 
       if(!undo->empty())
 	apt_undos->add_item(undo);
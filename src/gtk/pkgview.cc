@@ -34,6 +34,7 @@
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
+#include <generic/apt/version_rank.h>
 
 #include <solution_fragment.h>
 
@@ -107,7 +108,7 @@ namespace gui
 	pkgCache::VerIterator currver = pkg.CurrentVer();
 	pkgCache::VerIterator instver = state.CandidateVerIter(*apt_cache_file);
 
-	if(_system->VS->CmpVersion(currver.VerStr(), instver.VerStr()) > 0)
+	if(aptitude::apt::compare_versions(currver, instver) > 0)
 	  return downgrade_columns;
 	else
 	  return upgrade_columns;
@@ -36,6 +36,7 @@
 #include <solution_item.h> // For action_type.
 
 #include <generic/apt/apt_undo_group.h>
+#include <generic/apt/version_rank.h>
 #include <generic/problemresolver/exceptions.h>
 #include <generic/problemresolver/solution.h>
 
@@ -1333,8 +1334,7 @@ namespace gui
 		    keep_packages.push_back(*i);
 		  else
 		    {
-		      int cmp=_system->VS->CmpVersion(curver.VerStr(),
-						      newver.VerStr());
+		      int cmp=aptitude::apt::compare_versions(curver, newver);
 
 		      // The versions shouldn't be equal -- otherwise
 		      // something is majorly wrong.
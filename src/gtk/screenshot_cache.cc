@@ -35,6 +35,7 @@
 #include <generic/apt/download_queue.h>
 
 #include <generic/util/job_queue_thread.h>
+#include <generic/util/memory_accounting.h>
 
 #include <sigc++/trackable.h>
 
@@ -500,6 +501,7 @@ namespace gui
 
       static cache_map cache;
       static int cache_size; // Last computed size of the cache.
+      static aptitude::util::memory_account cache_account;
 
 
       // Store references to stuff that's been ejected from the cache,
@@ -618,6 +620,8 @@ namespace gui
 		add_to_weak_cache(victim);
 	      }
 	  }
+
+	cache_account.set(cache_size, cache.size());
       }
 
       // Update the cache's stored knowledge of the entry's size.
@@ -814,6 +818,7 @@ namespace gui
 
     screenshot_cache::cache_map screenshot_cache::cache;
     int screenshot_cache::cache_size = 0;
+    aptitude::util::memory_account screenshot_cache::cache_account("screenshot cache");
 
     screenshot_cache::weak_cache_map screenshot_cache::weak_cache;
 
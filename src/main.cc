@@ -72,6 +72,7 @@
 #include <cmdline/cmdline_prompt.h>
 #include <cmdline/cmdline_search.h>
 #include <cmdline/cmdline_show.h>
+#include <cmdline/cmdline_stats.h>
 #include <cmdline/cmdline_update.h>
 #include <cmdline/cmdline_user_tag.h>
 #include <cmdline/cmdline_versions.h>
@@ -281,6 +282,7 @@ enum {
   OPTION_ARCH_ONLY,
   OPTION_NOT_ARCH_ONLY,
   OPTION_DISABLE_COLUMNS,
+  OPTION_EXPLAIN,
   OPTION_GUI,
   OPTION_NO_GUI,
   OPTION_QT_GUI,
@@ -318,6 +320,7 @@ option opts[]={
   {"sort", 1, NULL, 'O'},
   {"target-release", 1, NULL, 't'},
   {"disable-columns", 0, &getopt_result, OPTION_DISABLE_COLUMNS},
+  {"explain", 0, &getopt_result, OPTION_EXPLAIN},
   {"no-new-installs", 0, &getopt_result, OPTION_NO_NEW_INSTALLS},
   {"no-new-upgrades", 0, &getopt_result, OPTION_NO_NEW_UPGRADES},
   {"allow-new-installs", 0, &getopt_result, OPTION_ALLOW_NEW_INSTALLS},
@@ -715,6 +718,7 @@ int main(int argc, char *argv[])
     resolver_mode = resolver_mode_safe;
 
   bool disable_columns = aptcfg->FindB(PACKAGE "::CmdLine::Disable-Columns", false);
+  bool explain_search = aptcfg->FindB(PACKAGE "::CmdLine::Explain-Search", false);
 
   bool showvers=aptcfg->FindB(PACKAGE "::CmdLine::Show-Versions", false);
   bool showdeps=aptcfg->FindB(PACKAGE "::CmdLine::Show-Deps", false);
@@ -972,6 +976,9 @@ int main(int argc, char *argv[])
 	    case OPTION_DISABLE_COLUMNS:
 	      disable_columns = true;
 	      break;
+	    case OPTION_EXPLAIN:
+	      explain_search = true;
+	      break;
 #ifdef HAVE_GTK
 	    case OPTION_GUI:
 	      use_gtk_gui = true;
@@ -1182,7 +1189,8 @@ int main(int argc, char *argv[])
 				  package_display_format, width,
 				  sort_policy,
 				  disable_columns,
-				  debug_search);
+				  debug_search,
+				  explain_search);
           else if(!strcasecmp(argv[optind], "versions"))
             return cmdline_versions(argc - optind, argv + optind,
                                     status_fname,
@@ -1294,6 +1302,8 @@ int main(int argc, char *argv[])
 	    return cmdline_dump_resolver(argc-optind, argv+optind, status_fname);
 	  else if(!strcasecmp(argv[optind], "check-resolver"))
 	    return cmdline_check_resolver(argc-optind, argv+optind, status_fname);
+	  else if(!strcasecmp(argv[optind], "stats"))
+	    return cmdline_stats(argc-optind, argv+optind, status_fname);
 	  else if(!strcasecmp(argv[optind], "help"))
 	    {
 	      usage();
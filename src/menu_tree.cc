@@ -66,21 +66,21 @@ public:
     // EWW
     const pkg_item *pitem=dynamic_cast<const pkg_item *>(&item);
     if(pitem)
-      return matching::get_match(pattern,
-				 pitem->get_package(),
-				 cache,
-				 *apt_cache_file,
-				 *apt_package_records).valid();
+      return matching::matches(pattern,
+			       pitem->get_package(),
+			       cache,
+			       *apt_cache_file,
+			       *apt_package_records);
     else {
       const pkg_ver_item *pvitem=dynamic_cast<const pkg_ver_item *>(&item);
 
       if(pvitem)
-	return matching::get_match(pattern,
-				   pvitem->get_package(),
-				   pvitem->get_version(),
-				   cache,
-				   *apt_cache_file,
-				   *apt_package_records).valid();
+	return matching::matches(pattern,
+				 pvitem->get_package(),
+				 pvitem->get_version(),
+				 cache,
+				 *apt_cache_file,
+				 *apt_package_records);
       else
 	return false;
     }
@@ -538,7 +538,7 @@ public:
 
   virtual void add_package(const pkgCache::PkgIterator &pkg, pkg_subtree *root)
   {
-    if(matching::get_match(filter, pkg, search_info, *apt_cache_file, *apt_package_records).valid())
+    if(matching::matches(filter, pkg, search_info, *apt_cache_file, *apt_package_records))
       chain->add_package(pkg, root);
   }
 
@@ -37,11 +37,14 @@
 #include <generic/apt/apt.h>
 #include <generic/apt/apt_undo_group.h>
 #include <generic/apt/config_signal.h>
+#include <generic/apt/config_snapshot.h>
 #include <generic/apt/dpkg.h>
 #include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 
+#include <generic/util/memory_accounting.h>
+
 #include <apt-pkg/configuration.h>
 #include <apt-pkg/error.h>
 
@@ -60,6 +63,8 @@ namespace cwidget
   using namespace widgets;
 }
 
+static aptitude::util::memory_account pkg_items_account("package tree items");
+
 static void try_delete_essential(wstring s,
 				 const pkgCache::PkgIterator pkg,
 				 bool purge)
@@ -105,6 +110,12 @@ pkg_item::pkg_item(const pkgCache::PkgIterator &_package,
 :package(_package), info_signal(sig)
 {
   highlighted_changed.connect(sigc::mem_fun(this, &pkg_item::do_highlighted_changed));
+  pkg_items_account.add(sizeof(pkg_item));
+}
+
+pkg_item::~pkg_item()
+{
+  pkg_items_account.remove(sizeof(pkg_item));
 }
 
 void pkg_item::do_highlighted_changed(bool highlighted)
@@ -156,12 +167,12 @@ void pkg_item::do_select(undo_group *undo)
 	}
     }
 
-  (*apt_cache_file)->mark_install(package_to_install, aptcfg->FindB(PACKAGE "::Auto-Install", true), false, undo);
+  (*apt_cache_file)->mark_install(package_to_install, aptitude::apt::get_config_snapshot()->auto_install, false, undo);
 }
 
 void pkg_item::select(undo_group *undo)
 {
-  if(aptcfg->FindB(PACKAGE "::UI::New-Package-Commands", true))
+  if(aptitude::apt::get_config_snapshot()->new_package_commands)
     do_select(undo);
   else if(!(*apt_cache_file)[package].Delete())
     do_select(undo);
@@ -180,7 +191,7 @@ void pkg_item::hold(undo_group *undo)
   // current package version (which is the newest) should be kept even if/when
   // a newer version becomes available.
 {
-  if(aptcfg->FindB(PACKAGE "::UI::New-Package-Commands", true))
+  if(aptitude::apt::get_config_snapshot()->new_package_commands)
     do_hold(undo);
   else
     // Toggle the held state.
@@ -213,7 +224,7 @@ void pkg_item::do_remove(undo_group *undo)
 
 void pkg_item::remove(undo_group *undo)
 {
-  if(aptcfg->FindB(PACKAGE "::UI::New-Package-Commands", true))
+  if(aptitude::apt::get_config_snapshot()->new_package_commands)
     do_remove(undo);
   else if(!(*apt_cache_file)[package].Install() && !((*apt_cache_file)[package].iFlags&pkgDepCache::ReInstall))
     do_remove(undo);
@@ -241,7 +252,7 @@ void pkg_item::reinstall(undo_group *undo)
 {
   if(!package.CurrentVer().end())
     (*apt_cache_file)->mark_install(package,
-				    aptcfg->FindB(PACKAGE "::Auto-Install", true),
+				    aptitude::apt::get_config_snapshot()->auto_install,
 				    true,
 				    undo);
 }
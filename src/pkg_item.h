@@ -57,6 +57,7 @@ public:
 	   sigc::signal2<void,
 	   const pkgCache::PkgIterator &,
 	   const pkgCache::VerIterator &> *sig);
+  ~pkg_item();
 
   virtual void paint(cwidget::widgets::tree *win, int y, bool hierarchical, const cwidget::style &st);
 
@@ -24,6 +24,8 @@
 #include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/version.h>
 
+#include <generic/apt/version_rank.h>
+
 #include <cwidget/widgets/subtree.h>
 
 namespace cw = cwidget;
@@ -209,5 +211,4 @@ PKG_SORTPOLICY_SUBCLASS(pkg_sortpolicy_ver,
 			else if(ver2.end())
 			  return 1;
 			else
-			  return _system->VS->CmpVersion(ver1.VerStr(),
-							 ver2.VerStr()););
+			  return aptitude::apt::compare_versions(ver1, ver2););
@@ -20,7 +20,10 @@
 
 #include "pkg_subtree.h"
 
+#include "pkg_item.h"
+
 #include <generic/apt/apt.h>
+#include <generic/apt/aptcache.h>
 
 #include <cwidget/generic/util/ssprintf.h>
 #include <cwidget/generic/util/transcode.h>
@@ -28,12 +31,45 @@
 
 #include "aptitude.h"
 
+#include <vector>
+
 namespace cw = cwidget;
 namespace cwidget
 {
   using namespace widgets;
 }
 
+namespace
+{
+  /** While a subtree acts on its children, whether each package
+   *  (indexed by ID) was acted on; \b NULL otherwise.
+   */
+  std::vector<bool> *acted_packages = NULL;
+
+  /** Creates acted_packages for the outermost subtree that acts. */
+  class acted_packages_scope
+  {
+    bool outermost;
+
+  public:
+    acted_packages_scope()
+      : outermost(acted_packages == NULL)
+    {
+      if(outermost)
+	acted_packages = new std::vector<bool>((*apt_cache_file)->Head().PackageCount);
+    }
+
+    ~acted_packages_scope()
+    {
+      if(outermost)
+	{
+	  delete acted_packages;
+	  acted_packages = NULL;
+	}
+    }
+  };
+}
+
 void pkg_subtree::paint(cw::tree *win, int y, bool hierarchical,
 			const cw::style &st)
 {
@@ -66,60 +102,60 @@ bool pkg_subtree::dispatch_key(const cw::config::key &k, cw::tree *owner)
     return cw::subtree<pkg_tree_node>::dispatch_key(k, owner);
 }
 
-void pkg_subtree::select(undo_group *undo)
+void pkg_subtree::apply_to_children(const std::function<void (pkg_tree_node &)> &action,
+				    undo_group *undo)
 {
   aptitudeDepCache::action_group group(*apt_cache_file, undo);
+  acted_packages_scope scope;
 
   for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->select(undo);
+    {
+      pkg_item * const item = dynamic_cast<pkg_item *>(*i);
+      if(item != NULL)
+	{
+	  std::vector<bool>::reference acted = (*acted_packages)[item->get_package()->ID];
+	  if(acted)
+	    continue;
+	  acted = true;
+	}
+
+      action(**i);
+    }
 }
 
-void pkg_subtree::hold(undo_group *undo)
+void pkg_subtree::select(undo_group *undo)
 {
-  aptitudeDepCache::action_group group(*apt_cache_file, undo);
+  apply_to_children([undo](pkg_tree_node &node) { node.select(undo); }, undo);
+}
 
-  for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->hold(undo);
+void pkg_subtree::hold(undo_group *undo)
+{
+  apply_to_children([undo](pkg_tree_node &node) { node.hold(undo); }, undo);
 }
 
 void pkg_subtree::keep(undo_group *undo)
 {
-  aptitudeDepCache::action_group group(*apt_cache_file, undo);
-
-  for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->keep(undo);
+  apply_to_children([undo](pkg_tree_node &node) { node.keep(undo); }, undo);
 }
 
 void pkg_subtree::remove(undo_group *undo)
 {
-  aptitudeDepCache::action_group group(*apt_cache_file, undo);
-
-  for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->remove(undo);
+  apply_to_children([undo](pkg_tree_node &node) { node.remove(undo); }, undo);
 }
 
 void pkg_subtree::purge(undo_group *undo)
 {
-  aptitudeDepCache::action_group group(*apt_cache_file, undo);
-
-  for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->purge(undo);
+  apply_to_children([undo](pkg_tree_node &node) { node.purge(undo); }, undo);
 }
 
 void pkg_subtree::reinstall(undo_group *undo)
 {
-  aptitudeDepCache::action_group group(*apt_cache_file, undo);
-
-  for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->reinstall(undo);
+  apply_to_children([undo](pkg_tree_node &node) { node.reinstall(undo); }, undo);
 }
 
 void pkg_subtree::set_auto(bool isauto, undo_group *undo)
 {
-  aptitudeDepCache::action_group group(*apt_cache_file, undo);
-
-  for(child_iterator i=get_children_begin(); i!=get_children_end(); i++)
-    (*i)->set_auto(isauto, undo);
+  apply_to_children([isauto, undo](pkg_tree_node &node) { node.set_auto(isauto, undo); }, undo);
 }
 
 void pkg_subtree::forbid_upgrade(undo_group *undo)
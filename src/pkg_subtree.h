@@ -31,6 +31,8 @@
 
 #include <cwidget/widgets/subtree.h>
 
+#include <functional>
+
 
 class pkg_subtree:public cwidget::widgets::subtree<pkg_tree_node>,
 		  public pkg_tree_node
@@ -45,6 +47,16 @@ class pkg_subtree:public cwidget::widgets::subtree<pkg_tree_node>,
   int num_packages;
 
   void do_highlighted_changed(bool highlighted);
+
+  /** \brief Apply an action to each child of this subtree, as a
+   *  single change of the cache.
+   *
+   *  A package can be listed several times in the same tree (for
+   *  instance, under each of its tasks), but only its first item is
+   *  acted on, even if the action reaches it through nested subtrees.
+   */
+  void apply_to_children(const std::function<void (pkg_tree_node &)> &action,
+			 undo_group *undo);
 protected:
   void set_label(const std::wstring &_name) {name=_name;}
 public:
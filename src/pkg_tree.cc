@@ -186,7 +186,7 @@ bool pkg_tree::build_tree(OpProgress &progress)
 	{
 	  ref_ptr<matching::search_cache> search_info(matching::search_cache::create());
 
-	  std::vector<std::pair<pkgCache::PkgIterator, cwidget::util::ref_ptr<matching::structural_match> > > matches;
+	  std::vector<pkgCache::PkgIterator> matches;
 	  matching::search(limit, search_info,
 			   matches,
 			   *apt_cache_file,
@@ -199,10 +199,10 @@ bool pkg_tree::build_tree(OpProgress &progress)
 	  // avoid divide by zero)
 	  int update_progress_10pct = std::max(progress_total / 10, 1);
 
-	  for(std::vector<std::pair<pkgCache::PkgIterator, cwidget::util::ref_ptr<matching::structural_match> > >::const_iterator
+	  for(std::vector<pkgCache::PkgIterator>::const_iterator
 		it = matches.begin(); it != matches.end(); ++it)
 	    {
-	      pkgCache::PkgIterator pkg(it->first);
+	      pkgCache::PkgIterator pkg(*it);
 
 	      cache_empty = false;
 
@@ -35,6 +35,7 @@
 #include <generic/apt/apt.h>
 #include <generic/apt/apt_undo_group.h>
 #include <generic/apt/config_signal.h>
+#include <generic/apt/config_snapshot.h>
 
 #include <cwidget/generic/util/ssprintf.h>
 #include <cwidget/toplevel.h>
@@ -631,7 +632,7 @@ void pkg_ver_item::reinstall(undo_group *undo)
 {
   if(version.ParentPkg().CurrentVer()==version)
     (*apt_cache_file)->mark_install(version.ParentPkg(),
-				    aptcfg->FindB(PACKAGE "::Auto-Install", true),
+				    aptitude::apt::get_config_snapshot()->auto_install,
 				    true,
 				    undo);
 }
@@ -37,6 +37,8 @@
 #include <apt-pkg/depcache.h>
 #include <apt-pkg/pkgsystem.h>
 
+#include <generic/apt/version_rank.h>
+
 /** \brief Let you create tree nodes which refer to a particular version of a package.
  * 
  *  \file pkg_ver_item.h
@@ -136,8 +138,8 @@ public:
           return plt(pitem1->get_version().ParentPkg(),
                      pitem2->get_version().ParentPkg());
 
-        return _system->VS->CmpVersion(pitem1->get_version().VerStr(),
-                                       pitem2->get_version().VerStr()) < 0;
+        return aptitude::apt::compare_versions(pitem1->get_version(),
+                                                pitem2->get_version()) < 0;
       }
     else
       return false; // we shouldn't get here!
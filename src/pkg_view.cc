@@ -25,6 +25,7 @@
 #include "menu_redirect.h"
 #include "pkg_columnizer.h"
 #include "reason_fragment.h"
+#include "safe_slot_event.h"
 #include "trust.h"
 #include "ui.h"
 
@@ -47,6 +48,8 @@
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/match.h>
 
+#include <generic/util/job_queue_thread.h>
+
 #include <apt-pkg/error.h>
 #include <apt-pkg/pkgrecords.h>
 
@@ -56,6 +59,8 @@
 
 #include <ctype.h>
 
+#include <atomic>
+#include <map>
 #include <memory>
 #include <string>
 
@@ -174,11 +179,261 @@ static void do_set_column_format(string key, string the_default,
     l->set_columns(columns);
 }
 
+namespace
+{
+  typedef std::vector<std::vector<aptitude::why::action> > why_solutions;
+
+  // Incremented whenever the package states are about to change or
+  // the cache is closed: searches begun before then are abandoned,
+  // since they would read a cache that is changing under them.
+  std::atomic<unsigned long> why_search_epoch(0);
+
+  /** Thrown by the callbacks of a "why" search that was cancelled. */
+  class why_search_cancelled
+  {
+  };
+
+  /** A request to justify installing one package. */
+  class why_search_job
+  {
+    pkgCache::PkgIterator pkg;
+    // Kept separately for logging, which must not touch the cache
+    // once the job is cancelled.
+    unsigned long pkg_id;
+    unsigned long epoch;
+    std::shared_ptr<std::atomic<bool> > cancelled;
+    safe_slot1<void, std::shared_ptr<const why_solutions> > found_slot;
+
+  public:
+    why_search_job(const pkgCache::PkgIterator &_pkg,
+		   const std::shared_ptr<std::atomic<bool> > &_cancelled,
+		   const safe_slot1<void, std::shared_ptr<const why_solutions> > &_found_slot)
+      : pkg(_pkg),
+	pkg_id(_pkg->ID),
+	epoch(why_search_epoch.load()),
+	cancelled(_cancelled),
+	found_slot(_found_slot)
+    {
+    }
+
+    const pkgCache::PkgIterator &get_pkg() const { return pkg; }
+    unsigned long get_pkg_id() const { return pkg_id; }
+    const safe_slot1<void, std::shared_ptr<const why_solutions> > &get_found_slot() const { return found_slot; }
+
+    /** \return \b true if the widget moved on to another package or
+     *  the cache changed since this job was created.
+     */
+    bool is_cancelled() const
+    {
+      return *cancelled || epoch != why_search_epoch.load();
+    }
+  };
+
+  std::ostream &operator<<(std::ostream &out, const std::shared_ptr<why_search_job> &job)
+  {
+    return out << "(package ID=" << job->get_pkg_id() << ")";
+  }
+
+  /** Aborts a search as soon as its job is cancelled. */
+  class why_search_canceller : public why_callbacks
+  {
+    std::shared_ptr<why_search_job> job;
+
+    void check() const
+    {
+      if(job->is_cancelled())
+	throw why_search_cancelled();
+    }
+
+  public:
+    why_search_canceller(const std::shared_ptr<why_search_job> &_job)
+      : job(_job)
+    {
+    }
+
+    void examining_dep(const pkgCache::DepIterator &) { check(); }
+    void skip_because_not_a_conflict(const pkgCache::DepIterator &) { }
+    void skip_because_is_a_conflict(const pkgCache::DepIterator &) { }
+    void skip_according_to_parameters(const pkgCache::DepIterator &) { }
+    void skip_because_not_from_selected_version(const pkgCache::DepIterator &) { }
+    void skip_because_satisfied_by_current_version(const pkgCache::DepIterator &) { }
+    void skip_because_already_seen(const std::vector<aptitude::why::action> &) { }
+    void skip_because_version_check_failed(const pkgCache::DepIterator &) { }
+    void enqueued(const pkgCache::PkgIterator &) { check(); }
+    void enqueued(const pkgCache::PrvIterator &) { check(); }
+    void begin(const aptitude::why::search_params &) { check(); }
+    void start_target(const aptitude::why::target &,
+		      const imm::set<aptitude::why::action> &) { check(); }
+  };
+
+  /** \brief Searches for the justifications shown in the "why" pane
+   *  of the package views.
+   *
+   *  This is a self-terminating singleton thread.  It is stopped
+   *  while the package states change and while the cache is closed.
+   */
+  class why_search_thread
+    : public aptitude::util::job_queue_thread<why_search_thread,
+					      std::shared_ptr<why_search_job> >
+  {
+    // Set to true when the global signal handlers are connected up.
+    static bool signals_connected;
+
+    // The packages to build justifications from.  They are parsed by
+    // the first search and only used in the background thread, since
+    // patterns are not safe to share between threads.
+    static std::vector<ref_ptr<matching::pattern> > leaves;
+
+    static void connect_cache_signals()
+    {
+      (*apt_cache_file)->pre_package_state_changed.connect(sigc::ptr_fun(&why_search_thread::cancel_and_stop));
+      (*apt_cache_file)->package_state_changed.connect(sigc::ptr_fun(&why_search_thread::start));
+    }
+
+    static void handle_cache_reloaded()
+    {
+      connect_cache_signals();
+      start();
+    }
+
+  public:
+    static logging::LoggerPtr get_log_category()
+    {
+      return aptitude::Loggers::getAptitudeWhy();
+    }
+
+    /** Abandon the running search and wait for the thread to stop. */
+    static void cancel_and_stop()
+    {
+      ++why_search_epoch;
+      stop();
+    }
+
+    why_search_thread()
+    {
+      if(!signals_connected)
+	{
+	  cache_closed.connect(sigc::ptr_fun(&why_search_thread::cancel_and_stop));
+	  cache_reloaded.connect(sigc::ptr_fun(&why_search_thread::handle_cache_reloaded));
+	  if(apt_cache_file)
+	    connect_cache_signals();
+	  signals_connected = true;
+	}
+    }
+
+    void process_job(const std::shared_ptr<why_search_job> &job)
+    {
+      logging::LoggerPtr logger(get_log_category());
+
+      if(job->is_cancelled())
+	{
+	  LOG_TRACE(logger, "Skipping the cancelled search " << job);
+	  return;
+	}
+
+      if(leaves.empty())
+	// Search for package (versions) that are not automatically
+	// installed and that are or will be installed.
+	leaves.push_back(matching::parse("?not(?automatic)?any-version(?or(?version(CANDIDATE)?action(install), ?version(CURRENT)?installed))"));
+
+      std::shared_ptr<why_solutions> solutions = std::make_shared<why_solutions>();
+      try
+	{
+	  aptitude::why::find_best_justification(leaves,
+						 aptitude::why::target::Install(job->get_pkg()),
+						 false,
+						 0,
+						 std::make_shared<why_search_canceller>(job),
+						 *solutions);
+	}
+      catch(const why_search_cancelled &)
+	{
+	  LOG_TRACE(logger, "Cancelled the search " << job);
+	  return;
+	}
+
+      LOG_TRACE(logger, "Found " << solutions->size() << " justifications for " << job);
+
+      cw::toplevel::post_event(new aptitude::safe_slot_event(safe_bind(job->get_found_slot(),
+								       std::shared_ptr<const why_solutions>(solutions))));
+    }
+  };
+  bool why_search_thread::signals_connected = false;
+  std::vector<ref_ptr<matching::pattern> > why_search_thread::leaves;
+}
+
 class pkg_why_widget:public cw::text_layout
 {
+  /** Set by the pending search when it is superseded; \b NULL if no
+   *  search is pending.
+   */
+  std::shared_ptr<std::atomic<bool> > pending_search;
+
+  /** The state generation that cached_solutions describes. */
+  unsigned long cached_generation;
+
+  /** The justifications of the packages already shown, indexed by
+   *  package ID.
+   */
+  std::map<unsigned long, std::shared_ptr<const why_solutions> > cached_solutions;
+
+  void cancel_search()
+  {
+    if(pending_search)
+      {
+	*pending_search = true;
+	pending_search.reset();
+      }
+  }
+
+  void clear_cache()
+  {
+    cancel_search();
+    cached_solutions.clear();
+  }
+
+  void show_solutions(const pkgCache::PkgIterator &pkg,
+		      const why_solutions &solutions)
+  {
+    try
+      {
+	bool success = false;
+	set_fragment(render_why(solutions,
+				pkg,
+				aptitude::why::no_summary,
+				false,
+				false,
+				success));
+      }
+    catch(...)
+      {
+	; // Eat and hide errors.
+      }
+  }
+
+  void search_finished(std::shared_ptr<const why_solutions> solutions,
+		       pkgCache::PkgIterator pkg,
+		       unsigned long generation,
+		       std::shared_ptr<std::atomic<bool> > search)
+  {
+    // Drop the results of searches that were superseded after they
+    // completed.
+    if(search != pending_search || apt_cache_file == NULL)
+      return;
+
+    pending_search.reset();
+
+    if(generation == cached_generation)
+      cached_solutions[pkg->ID] = solutions;
+
+    show_solutions(pkg, *solutions);
+  }
+
 protected:
   pkg_why_widget()
+    : cached_generation(0)
   {
+    cache_closed.connect(sigc::mem_fun(*this, &pkg_why_widget::clear_cache));
   }
 public:
   static cw::util::ref_ptr<pkg_why_widget> create()
@@ -188,6 +443,11 @@ public:
     return rval;
   }
 
+  ~pkg_why_widget()
+  {
+    cancel_search();
+  }
+
   void set_package(const pkgCache::PkgIterator &pkg,
 		   const pkgCache::VerIterator &ver)
   {
@@ -197,29 +457,37 @@ public:
 	return;
       }
 
-    std::vector<ref_ptr<matching::pattern> > search_leaves;
-    // Search for package (versions) that are not automatically
-    // installed and that are or will be installed.
-    search_leaves.push_back(matching::parse("?not(?automatic)?any-version(?or(?version(CANDIDATE)?action(install), ?version(CURRENT)?installed))"));
-    try
+    cancel_search();
+
+    const unsigned long generation = (*apt_cache_file)->get_state_generation();
+    if(generation != cached_generation)
       {
-	bool success = false;
-	set_fragment(do_why(search_leaves,
-			    pkg,
-			    aptitude::why::no_summary,
-			    false,
-			    false,
-                            std::shared_ptr<why_callbacks>(),
-			    success));
+	cached_solutions.clear();
+	cached_generation = generation;
       }
-    catch(...)
+
+    std::map<unsigned long, std::shared_ptr<const why_solutions> >::const_iterator
+      found = cached_solutions.find(pkg->ID);
+    if(found != cached_solutions.end())
       {
-	; // Eat and hide errors.
+	show_solutions(pkg, *found->second);
+	return;
       }
+
+    set_fragment(wrapbox(cw::fragf(_("Searching for the reasons to install %s..."),
+				   pkg.FullName(true).c_str())));
+
+    pending_search = std::make_shared<std::atomic<bool> >(false);
+    sigc::slot1<void, std::shared_ptr<const why_solutions> > found_slot =
+      sigc::bind(sigc::mem_fun(*this, &pkg_why_widget::search_finished),
+		 pkg, generation, pending_search);
+    why_search_thread::add_job(std::make_shared<why_search_job>(pkg, pending_search,
+								make_safe_slot(found_slot)));
   }
 
   void set_no_package()
   {
+    cancel_search();
     set_fragment(wrapbox(cw::text_fragment(_("If you select a package, an explanation of why it should be installed or removed will appear in this space."))));
   }
 };
@@ -52,6 +52,13 @@ namespace aptitude
 	 */
 	void handle_cache_closed();
 
+	/** \brief Method invoked after an install run refreshed the cache.
+	 *
+	 *  This method informs other classes about the packages which dpkg
+	 *  changed, through the same signal as cache_state_changed()
+	 */
+	void handle_cache_refreshed(const std::vector<pkgCache::PkgIterator> &changed);
+
 	/** \brief Metod invoked after changing cache state.
 	 *
 	 *  This method uses package_aware_object to inform others classes about
@@ -92,6 +99,7 @@ namespace aptitude
       {
 	cache_closed.connect(sigc::mem_fun(*this, &package_pool::package_pool_impl::handle_cache_closed));
         cache_reloaded.connect(sigc::mem_fun(*this, &package_pool::package_pool_impl::handle_cache_reloaded));
+	cache_refreshed.connect(sigc::mem_fun(*this, &package_pool::package_pool_impl::handle_cache_refreshed));
 
 	handle_cache_reloaded();
       }
@@ -128,6 +136,25 @@ namespace aptitude
 	packages.clear();
       }
 
+      void package_pool::package_pool_impl::handle_cache_refreshed(const std::vector<pkgCache::PkgIterator> &changed)
+      {
+	if(changed.empty())
+	  return;
+
+	std::vector<bool> is_changed((*apt_cache_file)->Head().PackageCount, false);
+	for(std::vector<pkgCache::PkgIterator>::const_iterator it = changed.begin();
+	    it != changed.end(); ++it)
+	  is_changed[(*it)->ID] = true;
+
+	std::vector<package_ptr> changed_packages;
+	for(std::vector<package_ptr>::const_iterator it = packages.begin();
+	    it != packages.end(); ++it)
+	  if(is_changed[(*it)->get_pkg()->ID])
+	    changed_packages.push_back(*it);
+
+	cache_state_changed_signal(changed_packages);
+      }
+
       void package_pool::package_pool_impl::cache_state_changed()
       {
 	// TODO
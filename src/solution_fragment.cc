@@ -25,6 +25,7 @@
 
 #include <generic/apt/aptitude_resolver_universe.h>
 #include <generic/apt/resolver_manager.h>
+#include <generic/apt/version_rank.h>
 
 #include <generic/problemresolver/solution.h>
 
@@ -364,8 +365,7 @@ cw::fragment *solution_fragment_with_ids(const aptitude_solution &sol,
 	      keep_packages.push_back(std::make_pair(pkg, *i));
 	    else
 	      {
-		int cmp=_system->VS->CmpVersion(curver.VerStr(),
-						newver.VerStr());
+		int cmp=aptitude::apt::compare_versions(curver, newver);
 
 		// The versions shouldn't be equal -- otherwise
 		// something is majorly wrong.
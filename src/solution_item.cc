@@ -30,6 +30,7 @@
 #include <apt-pkg/pkgrecords.h>
 
 #include <generic/apt/resolver_manager.h>
+#include <generic/apt/version_rank.h>
 
 #include <generic/util/util.h>
 
@@ -67,8 +68,7 @@ action_type analyze_action(const aptitude_universe::version &ver)
     return action_keep;
   else
     {
-      int cmp=_system->VS->CmpVersion(curver.VerStr(),
-				      newver.VerStr());
+      int cmp=aptitude::apt::compare_versions(curver, newver);
 
       // The versions shouldn't be equal -- otherwise
       // something is majorly wrong.
@@ -100,6 +100,7 @@
 #include <generic/problemresolver/exceptions.h>
 #include <generic/problemresolver/solution.h>
 
+#include <generic/util/memory_accounting.h>
 #include <generic/util/temp.h>
 #include <generic/util/util.h>
 
@@ -1100,6 +1101,27 @@ static void do_help_about()
   popup_widget(w);
 }
 
+static void do_help_memory_stats()
+{
+  std::ostringstream report;
+  aptitude::util::write_memory_report(report);
+
+  // One fragment per line, so that the columns stay aligned.
+  std::vector<cw::fragment *> lines;
+  std::istringstream in(report.str());
+  std::string line;
+  while(std::getline(in, line))
+    {
+      lines.push_back(cw::text_fragment(line));
+      lines.push_back(cw::newline_fragment());
+    }
+
+  cw::widget_ref w = cw::dialogs::ok(cw::sequence_fragment(lines));
+  w->show_all();
+
+  popup_widget(w);
+}
+
 /** Set up a new top-level file-viewing widget with a scrollbar. */
 static cw::widget_ref setup_fileview(const std::string &filename,
 				    const char *encoding,
@@ -2050,26 +2072,31 @@ static void do_mark_upgradable()
     {
       undo_group *undo=new apt_undo_group;
 
-      (*apt_cache_file)->mark_all_upgradable(true, true, undo);
+      {
+	// Sweep and redraw once, and undo everything in one step.
+	aptitudeDepCache::action_group group(*apt_cache_file, undo);
 
-      // same implementation in CmdLine full-upgrade and UI MarkUpgradable
-      //
-      // install Essential/Required packages -- #555896 and #757028
-      for (pkgCache::GrpIterator grp = (*apt_cache_file)->GrpBegin(); !grp.end(); ++grp)
-	{
-	  for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg))
-	    {
-	      bool is_essential = (pkg->Flags & pkgCache::Flag::Essential) == pkgCache::Flag::Essential;
-	      if (!is_essential || is_installed(pkg))
-		continue;
+	(*apt_cache_file)->mark_all_upgradable(true, true, undo);
 
-	      pkgCache::PkgIterator preferred_pkg = grp.FindPreferredPkg();
-	      if (is_installed(preferred_pkg) || (*apt_cache_file)[preferred_pkg].Install())
-		continue;
+	// same implementation in CmdLine full-upgrade and UI MarkUpgradable
+	//
+	// install Essential/Required packages -- #555896 and #757028
+	for (pkgCache::GrpIterator grp = (*apt_cache_file)->GrpBegin(); !grp.end(); ++grp)
+	  {
+	    for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg))
+	      {
+		bool is_essential = (pkg->Flags & pkgCache::Flag::Essential) == pkgCache::Flag::Essential;
+		if (!is_essential || is_installed(pkg))
+		  continue;
 
-	      (*apt_cache_file)->mark_install(preferred_pkg, false, false, nullptr);
-	    }
-	}
+		pkgCache::PkgIterator preferred_pkg = grp.FindPreferredPkg();
+		if (is_installed(preferred_pkg) || (*apt_cache_file)[preferred_pkg].Install())
+		  continue;
+
+		(*apt_cache_file)->mark_install(preferred_pkg, false, false, nullptr);
+	      }
+	  }
+      }
 
       if(!undo->empty())
 	apt_undos->add_item(undo);
@@ -2844,6 +2871,10 @@ cw::menu_info help_menu_info[]={
 	       N_("View the terms under which you may copy and distribute aptitude"),
 	       sigc::ptr_fun(do_help_license)),
 
+  cw::menu_info(cw::menu_info::MENU_ITEM, N_("Memory ^Usage"), NULL,
+	       N_("View how much memory each part of aptitude is using"),
+	       sigc::ptr_fun(do_help_memory_stats)),
+
   cw::menu_info::MENU_END
 };
 
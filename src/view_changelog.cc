@@ -47,9 +47,12 @@
 #include <sigc++/adaptors/bind.h>
 #include <sigc++/functors/mem_fun.h>
 
+#include <apt-pkg/error.h>
+#include <apt-pkg/fileutl.h>
 #include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/version.h>
 
+#include <algorithm>
 #include <memory>
 
 using namespace std;
@@ -123,42 +126,138 @@ cw::fragment *change_text_fragment(const std::string &s)
   return cw::sequence_fragment(lines);
 }
 
-static
-cw::fragment *render_changelog(const cw::util::ref_ptr<aptitude::apt::changelog> &cl,
-			       const std::string &curver)
+namespace
 {
-  bool first = true;
+  /** \brief How many older changelog entries to lay out at once.
+   *
+   *  Entries newer than the installed version are always laid out
+   *  immediately; the rest of the history is appended a chunk at a
+   *  time as the user scrolls towards the end of what is displayed.
+   */
+  const aptitude::apt::changelog::size_type changelog_chunk_size = 50;
+
+  /** \brief The part of a changelog that hasn't been laid out yet. */
+  struct changelog_render_state
+  {
+    cw::util::ref_ptr<aptitude::apt::changelog> cl;
+    std::string curver;
+    /** \brief The index of the next entry to render. */
+    aptitude::apt::changelog::size_type next;
+    /** \brief Set while an append is waiting in the event queue. */
+    bool append_pending;
+
+    changelog_render_state(const cw::util::ref_ptr<aptitude::apt::changelog> &_cl,
+			   const std::string &_curver)
+      : cl(_cl), curver(_curver), next(0), append_pending(false)
+    {
+    }
 
-  std::vector<cw::fragment *> fragments;
+    bool is_newer(const cw::util::ref_ptr<aptitude::apt::changelog_entry> &ent) const
+    {
+      return !curver.empty() && _system->VS->CmpVersion(ent->get_version(), curver) > 0;
+    }
 
-  for(aptitude::apt::changelog::const_iterator it = cl->begin();
-      it != cl->end(); ++it)
+    bool has_more() const
     {
-      const cw::util::ref_ptr<aptitude::apt::changelog_entry>ent(*it);
+      return next < cl->size();
+    }
+  };
+}
 
-      cw::fragment *taglineFrag =
-	cw::hardwrapbox(cw::fragf("%n -- %s  %s",
-				  ent->get_maintainer().c_str(),
-				  ent->get_date_str().c_str()));
-      cw::fragment *f =
-	cw::fragf(first ? "%F%F" : "%n%F%F",
-		  change_text_fragment(ent->get_changes()),
-		  taglineFrag);
+static
+cw::fragment *render_changelog_entry(const cw::util::ref_ptr<aptitude::apt::changelog_entry> &ent,
+				     bool first,
+				     bool newer)
+{
+  cw::fragment *taglineFrag =
+    cw::hardwrapbox(cw::fragf("%n -- %s  %s",
+			      ent->get_maintainer().c_str(),
+			      ent->get_date_str().c_str()));
+  cw::fragment *f =
+    cw::fragf(first ? "%F%F" : "%n%F%F",
+	      change_text_fragment(ent->get_changes()),
+	      taglineFrag);
+
+  if(newer)
+    {
+      cw::style s = cw::get_style("ChangelogNewerVersion");
+      return cw::style_fragment(f, s);
+    }
+  else
+    return f;
+}
 
-      first = false;
+/** \brief Render up to count entries of the changelog, starting at
+ *  state.next.
+ */
+static
+cw::fragment *render_changelog_chunk(changelog_render_state &state,
+				     aptitude::apt::changelog::size_type count)
+{
+  std::vector<cw::fragment *> fragments;
 
-      if(!curver.empty() && _system->VS->CmpVersion(ent->get_version(), curver) > 0)
-	{
-	  cw::style s = cw::get_style("ChangelogNewerVersion");
-	  fragments.push_back(cw::style_fragment(f, s));
-	}
-      else
-	fragments.push_back(f);
+  for(; count > 0 && state.has_more(); --count, ++state.next)
+    {
+      const cw::util::ref_ptr<aptitude::apt::changelog_entry> ent(*(state.cl->begin() + state.next));
+
+      fragments.push_back(render_changelog_entry(ent, state.next == 0, state.is_newer(ent)));
     }
 
   return cw::sequence_fragment(fragments);
 }
 
+/** \brief Render the initial part of a changelog: every entry newer
+ *  than the current version, and at least one chunk.
+ */
+static
+cw::fragment *render_changelog(changelog_render_state &state)
+{
+  aptitude::apt::changelog::size_type first_chunk = 0;
+  for(aptitude::apt::changelog::const_iterator it = state.cl->begin();
+      it != state.cl->end() && state.is_newer(*it); ++it)
+    ++first_chunk;
+
+  return render_changelog_chunk(state, std::max(first_chunk, changelog_chunk_size));
+}
+
+namespace
+{
+  void do_post_thunk(const sigc::slot<void> &thunk)
+  {
+    cw::toplevel::post_event(new aptitude::safe_slot_event(make_safe_slot(thunk)));
+  }
+
+  void append_changelog_chunk(const std::shared_ptr<changelog_render_state> &state,
+			      const menu_text_layout_ref &l)
+  {
+    state->append_pending = false;
+
+    if(state->has_more())
+      l->append_fragment(render_changelog_chunk(*state, changelog_chunk_size));
+  }
+
+  /** \brief Lay out more of the changelog when the user scrolls
+   *  within a screen of the end of what has been laid out so far.
+   *
+   *  The append is posted to the event queue rather than done here,
+   *  since it changes the layout that is emitting the signal.
+   */
+  void changelog_location_changed(int start, int size,
+				  const std::shared_ptr<changelog_render_state> &state,
+				  menu_text_layout *l)
+  {
+    if(!state->has_more() || state->append_pending)
+      return;
+
+    if(start + 2 * l->getmaxy() < size)
+      return;
+
+    state->append_pending = true;
+    do_post_thunk(sigc::bind(sigc::ptr_fun(&append_changelog_chunk),
+			     state, menu_text_layout_ref(l)));
+  }
+}
+
 class pkg_changelog_screen : public cw::file_pager, public menu_redirect
 {
   std::string changelog_filename;
@@ -268,7 +367,15 @@ public:
 typedef cw::util::ref_ptr<pkg_changelog_screen> pkg_changelog_screen_ref;
 
 
-static void do_view_changelog(const string& filename,
+/** \brief Display a parsed changelog.
+ *
+ *  \param changelog the parsed changelog, or an invalid pointer if
+ *                   the changelog couldn't be parsed; in that case
+ *                   the raw text is displayed instead.
+ *  \param filename  the file containing the raw changelog.
+ */
+static void do_view_changelog(const cw::util::ref_ptr<aptitude::apt::changelog> &changelog,
+			      const temp::name &filename,
 			      string pkgname,
 			      string curverstr)
 {
@@ -277,19 +384,23 @@ static void do_view_changelog(const string& filename,
   string tablabel = ssprintf(_("%s changes"), pkgname.c_str());
   string desclabel = _("View the list of changes made to this Debian package.");
 
-  cw::util::ref_ptr<aptitude::apt::changelog> changelog(aptitude::apt::parse_changelog(filename));
-  cw::fragment *f = changelog.valid() ? render_changelog(changelog, curverstr) : NULL;
-
   cw::table_ref           t = cw::table::create();
-  if(f != NULL)
+  if(changelog.valid())
     {
+      std::shared_ptr<changelog_render_state> state =
+	std::make_shared<changelog_render_state>(changelog, curverstr);
+
       cw::scrollbar_ref   s = cw::scrollbar::create(cw::scrollbar::VERTICAL);
       menu_text_layout_ref l = menu_text_layout::create();
 
 
       l->location_changed.connect(sigc::mem_fun(s.unsafe_get_ref(), &cw::scrollbar::set_slider));
       s->scrollbar_interaction.connect(sigc::mem_fun(l.unsafe_get_ref(), &cw::text_layout::scroll));
-      l->set_fragment(f);
+      l->set_fragment(render_changelog(*state));
+
+      if(state->has_more())
+	l->location_changed.connect(sigc::bind(sigc::ptr_fun(&changelog_location_changed),
+					       state, l.unsafe_get_ref()));
 
       t->add_widget_opts(l, 0, 0, 1, 1,
 			 cw::table::EXPAND|cw::table::SHRINK, cw::table::EXPAND);
@@ -300,7 +411,7 @@ static void do_view_changelog(const string& filename,
     }
   else
     {
-      pkg_changelog_screen_ref cs = pkg_changelog_screen::create(filename);
+      pkg_changelog_screen_ref cs = pkg_changelog_screen::create(filename.get_name());
       cw::scrollbar_ref          s = cw::scrollbar::create(cw::scrollbar::VERTICAL);
 
       cs->line_changed.connect(sigc::mem_fun(s.unsafe_get_ref(), &cw::scrollbar::set_slider));
@@ -320,14 +431,6 @@ static void do_view_changelog(const string& filename,
   insert_main_widget(t, menulabel, desclabel, tablabel);
 }
 
-namespace
-{
-  void do_post_thunk(const sigc::slot<void> &thunk)
-  {
-    cw::toplevel::post_event(new aptitude::safe_slot_event(make_safe_slot(thunk)));
-  }
-}
-
 class changelog_callbacks : public aptitude::download_callbacks
 {
   progress_ref download_progress;
@@ -361,7 +464,31 @@ public:
         download_progress->destroy();
         download_progress.clear();
       }
-    do_view_changelog(filename, pkgname, curverstr);
+
+    // The downloaded file may be removed as soon as we return, so
+    // parse (and if necessary display) a copy of it.
+    temp::name copy("changelog");
+    {
+      FileFd in(filename, FileFd::ReadOnly);
+      FileFd out(copy.get_name(), FileFd::WriteEmpty);
+      if(!in.IsOpen() || !out.IsOpen() || !CopyFile(in, out))
+	{
+	  _error->Discard();
+	  show_message(ssprintf(_("Unable to read the changelog of %s."),
+				pkgname.c_str()));
+	  return;
+	}
+    }
+
+    // Parse the changelog in the background, so that the interface
+    // stays responsive while aptitude-changelog-parser runs.
+    const sigc::slot1<void, cw::util::ref_ptr<aptitude::apt::changelog> > view_slot =
+      sigc::bind(sigc::ptr_fun(&do_view_changelog),
+		 copy, pkgname, curverstr);
+    aptitude::apt::parse_changelog_background(copy,
+					      make_safe_slot(view_slot),
+					      "", "", "", false,
+					      &do_post_thunk);
   }
 
   void failure(const std::string& msg)
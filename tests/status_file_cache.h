@@ -0,0 +1,141 @@
+/** \file status_file_cache.h */     // -*-c++-*-
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+#ifndef STATUS_FILE_CACHE_H
+#define STATUS_FILE_CACHE_H
+
+// Local includes:
+#include <generic/apt/apt.h>
+#include <generic/apt/aptcache.h>
+#include <generic/apt/config_signal.h>
+#include <generic/apt/config_snapshot.h>
+#include <generic/util/temp.h>
+
+// System includes:
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/error.h>
+#include <apt-pkg/init.h>
+#include <apt-pkg/pkgsystem.h>
+
+#include <fstream>
+#include <string>
+
+/** \brief A package cache whose only packages are those of a dpkg
+ *  status file written by the test.
+ *
+ *  While it exists, the cache is the global apt_cache_file.  The
+ *  temporary directory module must be initialized.
+ */
+class status_file_cache
+{
+  temp::dir root;
+  aptitudeCacheFile *cache_file;
+  signalling_config *old_aptcfg;
+  aptitudeCacheFile *old_cache_file;
+
+  status_file_cache(const status_file_cache &);
+
+public:
+  /** \param status  The contents of the status file. */
+  explicit status_file_cache(const std::string &status)
+    : root("statusfilecache"),
+      cache_file(new aptitudeCacheFile),
+      old_aptcfg(aptcfg),
+      old_cache_file(apt_cache_file)
+  {
+    const std::string dir = root.get_name();
+    {
+      std::ofstream status_file((dir + "/status").c_str());
+      status_file << status;
+
+      std::ofstream sources_file((dir + "/sources.list").c_str());
+    }
+
+    pkgInitConfig(*_config);
+    _config->Set("Dir::State::status", dir + "/status");
+    // The directories don't exist, so nothing else is read.
+    _config->Set("Dir::State::lists", dir + "/lists/");
+    _config->Set("Dir::Etc::sourcelist", dir + "/sources.list");
+    _config->Set("Dir::Etc::sourceparts", dir + "/sources.list.d/");
+    _config->Set("Dir::Etc::preferences", dir + "/preferences");
+    _config->Set("Dir::Etc::preferencesparts", dir + "/preferences.d/");
+    _config->Set("Dir::Cache::pkgcache", "");
+    _config->Set("Dir::Cache::srcpkgcache", "");
+    pkgInitSystem(*_config, _system);
+
+    if(aptcfg == NULL)
+      {
+	aptcfg = new signalling_config(new Configuration, _config,
+				       new Configuration);
+	aptitude::apt::register_config_snapshot_keys();
+      }
+
+    if(cache_file->Open(NULL, false, false,
+			(dir + "/pkgstates").c_str(), false))
+      apt_cache_file = cache_file;
+    _error->Discard();
+  }
+
+  ~status_file_cache()
+  {
+    apt_cache_file = old_cache_file;
+    delete cache_file;
+
+    if(aptcfg != old_aptcfg)
+      {
+	delete aptcfg;
+	aptcfg = old_aptcfg;
+      }
+  }
+
+  /** \return \b true if the cache was loaded. */
+  bool is_open() const
+  {
+    return apt_cache_file == cache_file;
+  }
+
+  aptitudeDepCache &operator*()
+  {
+    return **cache_file;
+  }
+
+  aptitudeDepCache *operator->()
+  {
+    return &**cache_file;
+  }
+};
+
+/** \brief Describe an installed package for a status file. */
+inline std::string installed_package(const std::string &name,
+				     const std::string &depends = "")
+{
+  std::string rval = "Package: " + name + "\n"
+    "Status: install ok installed\n"
+    "Version: 1.0\n"
+    "Architecture: all\n"
+    "Maintainer: Nobody <nobody@example.org>\n";
+  if(!depends.empty())
+    rval += "Depends: " + depends + "\n";
+  rval += "Description: test package\n\n";
+
+  return rval;
+}
+
+#endif // STATUS_FILE_CACHE_H
@@ -0,0 +1,119 @@
+/** \file test_aptcache.cc */
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+// Local includes:
+#include "status_file_cache.h"
+
+#include <generic/apt/apt_undo_group.h>
+#include <generic/apt/aptcache.h>
+#include <generic/util/temp.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <sigc++/functors/mem_fun.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+  /** Loads a cache whose only packages are "a" and "b", both
+   *  installed, and records the signals that it emits.
+   */
+  class AptCache : public ::testing::Test
+  {
+  protected:
+    std::unique_ptr<status_file_cache> cache;
+
+    /** The signals emitted by the cache, in order. */
+    std::vector<std::string> events;
+
+    void pre_changed()
+    {
+      events.push_back("pre");
+    }
+
+    void changed()
+    {
+      events.push_back("changed");
+    }
+
+    void SetUp()
+    {
+      temp::initialize("testAptCache");
+
+      cache.reset(new status_file_cache(installed_package("a") +
+					installed_package("b")));
+      ASSERT_TRUE(cache->is_open());
+
+      (*cache)->pre_package_state_changed.connect(sigc::mem_fun(*this, &AptCache::pre_changed));
+      (*cache)->package_state_changed.connect(sigc::mem_fun(*this, &AptCache::changed));
+    }
+
+    void TearDown()
+    {
+      cache.reset();
+      temp::shutdown();
+    }
+  };
+}
+
+// Undoing several changes at once announces them once, and tells
+// listeners before the first of them.
+TEST_F(AptCache, UndoCandidateVersionsInOneGroup)
+{
+  pkgCache::PkgIterator a = (*cache)->FindPkg("a");
+  pkgCache::PkgIterator b = (*cache)->FindPkg("b");
+  ASSERT_FALSE(a.end());
+  ASSERT_FALSE(b.end());
+
+  apt_undo_group undo;
+  (*cache)->set_candidate_version(a.CurrentVer(), &undo);
+  (*cache)->set_candidate_version(b.CurrentVer(), &undo);
+  ASSERT_FALSE(undo.empty());
+
+  events.clear();
+  undo.undo();
+
+  const std::vector<std::string> expected { "pre", "changed" };
+  EXPECT_EQ(expected, events);
+}
+
+// A change announced in the middle of a group makes listeners start
+// over, so they must be told about the next change again.
+TEST_F(AptCache, PreSignalAfterChangeInsideGroup)
+{
+  pkgCache::PkgIterator a = (*cache)->FindPkg("a");
+  pkgCache::PkgIterator b = (*cache)->FindPkg("b");
+
+  events.clear();
+  {
+    aptitudeDepCache::action_group group(**cache);
+
+    (*cache)->set_candidate_version(a.CurrentVer(), NULL);
+    (*cache)->package_state_changed();
+    (*cache)->set_candidate_version(b.CurrentVer(), NULL);
+  }
+
+  const std::vector<std::string> expected { "pre", "changed", "pre", "changed" };
+  EXPECT_EQ(expected, events);
+}
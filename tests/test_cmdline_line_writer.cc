@@ -0,0 +1,142 @@
+/** \file test_cmdline_line_writer.cc */
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+
+
+// Local includes:
+#include <cmdline/cmdline_util.h>
+
+#include <gtest/gtest.h>
+
+#include <clocale>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+using aptitude::cmdline::buffered_line_writer;
+
+namespace
+{
+  std::string read_all(FILE *f)
+  {
+    std::string rval;
+
+    fflush(f);
+    rewind(f);
+
+    char buf[4096];
+    size_t len;
+    while((len = fread(buf, 1, sizeof(buf), f)) > 0)
+      rval.append(buf, len);
+
+    return rval;
+  }
+
+  /** Render the lines with printf() and with buffered_line_writer. */
+  void render(const std::vector<std::wstring> &lines,
+	      std::string &expected,
+	      std::string &actual)
+  {
+    FILE *printf_out = tmpfile();
+    FILE *writer_out = tmpfile();
+    ASSERT_NE(nullptr, printf_out);
+    ASSERT_NE(nullptr, writer_out);
+
+    {
+      buffered_line_writer writer(writer_out);
+      for(const std::wstring &line : lines)
+	{
+	  fprintf(printf_out, "%ls\n", line.c_str());
+	  writer.write_line(line);
+	}
+    }
+
+    expected = read_all(printf_out);
+    actual = read_all(writer_out);
+
+    fclose(printf_out);
+    fclose(writer_out);
+  }
+
+  class CmdlineLineWriter : public ::testing::Test
+  {
+    std::string old_locale;
+
+  protected:
+    void SetUp()
+    {
+      old_locale = setlocale(LC_CTYPE, NULL);
+    }
+
+    void TearDown()
+    {
+      setlocale(LC_CTYPE, old_locale.c_str());
+    }
+  };
+}
+
+TEST_F(CmdlineLineWriter, SameAsPrintf)
+{
+  setlocale(LC_CTYPE, "C");
+
+  std::vector<std::wstring> lines;
+  lines.push_back(L"i A aptitude                           - terminal-based package manager");
+  lines.push_back(L"");
+  lines.push_back(std::wstring(L"embedded\0null", 13));
+  lines.push_back(L"p   zzz");
+
+  std::string expected, actual;
+  render(lines, expected, actual);
+
+  EXPECT_EQ(expected, actual);
+}
+
+TEST_F(CmdlineLineWriter, UnrepresentableLinesAreDropped)
+{
+  setlocale(LC_CTYPE, "C");
+
+  std::vector<std::wstring> lines;
+  lines.push_back(L"before");
+  lines.push_back(L"caf\x00e9");
+  lines.push_back(L"after");
+
+  std::string expected, actual;
+  render(lines, expected, actual);
+
+  EXPECT_EQ(expected, actual);
+  EXPECT_EQ("before\nafter\n", actual);
+}
+
+TEST_F(CmdlineLineWriter, MultibyteLocale)
+{
+  if(setlocale(LC_CTYPE, "C.UTF-8") == NULL)
+    return;
+
+  std::vector<std::wstring> lines;
+  lines.push_back(L"caf\x00e9 \x4e2d\x6587");
+  for(int i = 0; i < 10000; ++i)
+    lines.push_back(L"p   libfoo" + std::to_wstring(i) + L"  - \x00fcber");
+
+  std::string expected, actual;
+  render(lines, expected, actual);
+
+  EXPECT_EQ(expected, actual);
+}
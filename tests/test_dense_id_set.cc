@@ -0,0 +1,181 @@
+/** \file test_dense_id_set.cc */
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+// Local includes:
+#include <generic/util/dense_id_set.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using aptitude::util::dense_id_map;
+using aptitude::util::dense_id_set;
+
+namespace
+{
+  // Stands in for a cache object: keys are pointers to it, as
+  // pkgCache::PkgIterator points to a pkgCache::Package.
+  struct object
+  {
+    unsigned long ID;
+  };
+
+  typedef dense_id_set<const object *> object_set;
+  typedef dense_id_map<const object *, int> object_map;
+
+  class DenseIdSet : public ::testing::Test
+  {
+  protected:
+    std::vector<object> objects;
+
+    void SetUp()
+    {
+      // More than one word of IDs.
+      for(unsigned long i = 0; i < 200; ++i)
+	{
+	  object o;
+	  o.ID = i;
+	  objects.push_back(o);
+	}
+    }
+
+    const object *get(unsigned long id) const
+    {
+      return &objects[id];
+    }
+
+    std::vector<unsigned long> ids(const object_set &set) const
+    {
+      std::vector<unsigned long> rval;
+      for(object_set::const_iterator it = set.begin(); it != set.end(); ++it)
+	rval.push_back((*it)->ID);
+      return rval;
+    }
+  };
+}
+
+TEST_F(DenseIdSet, InsertAndErase)
+{
+  object_set set(objects.size());
+
+  EXPECT_TRUE(set.empty());
+  EXPECT_TRUE(set.insert(get(5)));
+  EXPECT_TRUE(set.insert(get(150)));
+  EXPECT_FALSE(set.insert(get(5)));
+  EXPECT_EQ(2U, set.size());
+  EXPECT_TRUE(set.contains(get(5)));
+  EXPECT_TRUE(set.contains(get(150)));
+  EXPECT_FALSE(set.contains(get(6)));
+
+  EXPECT_TRUE(set.erase(get(5)));
+  EXPECT_FALSE(set.erase(get(5)));
+  EXPECT_FALSE(set.contains(get(5)));
+  EXPECT_EQ(1U, set.size());
+}
+
+TEST_F(DenseIdSet, IteratesInInsertionOrder)
+{
+  object_set set(objects.size());
+
+  set.insert(get(199));
+  set.insert(get(3));
+  set.insert(get(64));
+  set.erase(get(3));
+  // Inserting an erased key again doesn't list it twice.
+  set.insert(get(3));
+  set.insert(get(0));
+  set.erase(get(64));
+
+  std::vector<unsigned long> expected;
+  expected.push_back(199);
+  expected.push_back(3);
+  expected.push_back(0);
+  EXPECT_EQ(expected, ids(set));
+}
+
+TEST_F(DenseIdSet, Clear)
+{
+  object_set set(objects.size());
+
+  set.insert(get(1));
+  set.insert(get(100));
+  set.erase(get(100));
+  set.clear();
+
+  EXPECT_TRUE(set.empty());
+  EXPECT_FALSE(set.contains(get(1)));
+  EXPECT_TRUE(ids(set).empty());
+
+  set.insert(get(100));
+  EXPECT_EQ(std::vector<unsigned long>(1, 100), ids(set));
+}
+
+TEST_F(DenseIdSet, SetAlgebra)
+{
+  object_set a(objects.size()), b(objects.size());
+
+  for(unsigned long i = 0; i < 10; ++i)
+    a.insert(get(i));
+  for(unsigned long i = 5; i < 15; ++i)
+    b.insert(get(i));
+
+  object_set intersection(a);
+  intersection.retain_all(b);
+  EXPECT_EQ(5U, intersection.size());
+  for(unsigned long i = 0; i < 15; ++i)
+    EXPECT_EQ(i >= 5 && i < 10, intersection.contains(get(i))) << i;
+
+  object_set difference(a);
+  difference.erase_all(b);
+  EXPECT_EQ(5U, difference.size());
+  for(unsigned long i = 0; i < 15; ++i)
+    EXPECT_EQ(i < 5, difference.contains(get(i))) << i;
+
+  object_set set_union(a);
+  set_union.insert_all(b);
+  EXPECT_EQ(15U, set_union.size());
+
+  EXPECT_TRUE(a.intersects(b));
+  EXPECT_FALSE(difference.intersects(b));
+}
+
+TEST_F(DenseIdSet, Map)
+{
+  object_map map(objects.size());
+
+  EXPECT_EQ(NULL, map.find(get(7)));
+
+  map[get(7)] = 3;
+  map[get(130)] += 2;
+  EXPECT_EQ(2U, map.size());
+  ASSERT_NE(static_cast<int *>(NULL), map.find(get(7)));
+  EXPECT_EQ(3, *map.find(get(7)));
+  EXPECT_EQ(2, *map.find(get(130)));
+
+  EXPECT_TRUE(map.erase(get(7)));
+  EXPECT_FALSE(map.contains(get(7)));
+  // Mapping a key again starts from a default value.
+  EXPECT_EQ(0, map[get(7)]);
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_EQ(0, map[get(130)]);
+}
@@ -0,0 +1,87 @@
+/** \file test_download_install_manager.cc */
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+// Local includes:
+#include <generic/apt/download_install_manager.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+namespace
+{
+  download_manager::result outcome(pkgPackageManager::OrderResult pre_fork_result,
+				   bool installing_batch,
+				   bool pending_actions)
+  {
+    return download_install_manager::pre_fork_outcome(pre_fork_result,
+						      installing_batch,
+						      pending_actions);
+  }
+}
+
+TEST(DownloadInstallManager, PreForkCompleted)
+{
+  EXPECT_EQ(download_manager::success,
+	    outcome(pkgPackageManager::Completed, false, true));
+  EXPECT_EQ(download_manager::success,
+	    outcome(pkgPackageManager::Completed, true, true));
+}
+
+// The first package of the ordering is still being downloaded: apt
+// gives up before queueing anything, and the batch is retried later.
+TEST(DownloadInstallManager, PreForkHeadStillDownloading)
+{
+  EXPECT_EQ(download_manager::do_again,
+	    outcome(pkgPackageManager::Failed, true, false));
+}
+
+TEST(DownloadInstallManager, PreForkNothingArrivedYet)
+{
+  EXPECT_EQ(download_manager::do_again,
+	    outcome(pkgPackageManager::Incomplete, true, false));
+}
+
+TEST(DownloadInstallManager, PreForkPartialBatch)
+{
+  EXPECT_EQ(download_manager::success,
+	    outcome(pkgPackageManager::Incomplete, true, true));
+}
+
+// Once the download is over, a missing archive is a real failure.
+TEST(DownloadInstallManager, PreForkFailedAfterDownload)
+{
+  EXPECT_EQ(download_manager::failure,
+	    outcome(pkgPackageManager::Failed, false, false));
+  EXPECT_EQ(download_manager::failure,
+	    outcome(pkgPackageManager::Failed, false, true));
+}
+
+TEST(DownloadInstallManager, PreForkFailedAfterQueueing)
+{
+  EXPECT_EQ(download_manager::failure,
+	    outcome(pkgPackageManager::Failed, true, true));
+}
+
+// Without pipelining, Incomplete means that a medium must be swapped.
+TEST(DownloadInstallManager, PreForkIncompleteWithoutPipelining)
+{
+  EXPECT_EQ(download_manager::success,
+	    outcome(pkgPackageManager::Incomplete, false, false));
+}
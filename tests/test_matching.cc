@@ -19,7 +19,10 @@
 
 #include <cppunit/extensions/HelperMacros.h>
 
+#include "status_file_cache.h"
+
 #include <generic/apt/matching/compare_patterns.h>
+#include <generic/apt/matching/match.h>
 #include <generic/apt/matching/parse.h>
 #include <generic/apt/matching/pattern.h>
 #include <generic/apt/matching/serialize.h>
@@ -27,6 +30,7 @@
 #include <cwidget/generic/util/ssprintf.h>
 
 #include <apt-pkg/error.h>
+#include <apt-pkg/pkgrecords.h>
 
 using namespace aptitude::matching;
 using cwidget::util::ref_ptr;
@@ -820,6 +824,7 @@ class MatchingTest : public CppUnit::TestFixture
   CPPUNIT_TEST(testParseThenSerialize);
   CPPUNIT_TEST(testSerialize);
   CPPUNIT_TEST(testSerializationParse);
+  CPPUNIT_TEST(testSequentialFor);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -999,6 +1004,39 @@ public:
 						      test.expected_pattern));
       }
   }
+
+  // Two ?for patterns in a row bind their variables at the same stack
+  // position, so the first one must take its variable out of scope
+  // before the second one binds its own.
+  void testSequentialFor()
+  {
+    temp::initialize("testMatching");
+
+    {
+      status_file_cache cache(installed_package("a", "b") +
+			      installed_package("b"));
+      CPPUNIT_ASSERT(cache.is_open());
+
+      pkgRecords records(*cache);
+      ref_ptr<search_cache> info(search_cache::create());
+
+      // x is bound to the versions of b, and y to the versions of a.
+      ref_ptr<pattern> p(parse("?and(?depends(?for x: ?name(^b$)), ?for y: ?bind(y, ?name(^a$)))"));
+      _error->DumpErrors();
+      CPPUNIT_ASSERT(p.valid());
+
+      const pkgCache::PkgIterator a = cache->FindPkg("a");
+      CPPUNIT_ASSERT(!a.end());
+
+      CPPUNIT_ASSERT(matches(p, a, info, *cache, records));
+
+      // Each match starts over with the ?bind memo table.
+      CPPUNIT_ASSERT(matches(p, a, info, *cache, records));
+      CPPUNIT_ASSERT_EQUAL(1UL, info->get_bind_memo_statistics().lookups);
+    }
+
+    temp::shutdown();
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(MatchingTest);
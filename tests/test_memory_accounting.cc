@@ -0,0 +1,141 @@
+/** \file test_memory_accounting.cc */
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+// Local includes:
+#include <generic/util/memory_accounting.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+
+using aptitude::util::get_memory_report;
+using aptitude::util::memory_account;
+using aptitude::util::memory_report_entry;
+using aptitude::util::memory_usage;
+using aptitude::util::write_memory_report;
+
+namespace
+{
+  const memory_report_entry *find_entry(const std::vector<memory_report_entry> &report,
+					const std::string &subsystem)
+  {
+    for(const memory_report_entry &entry : report)
+      if(entry.subsystem == subsystem)
+	return &entry;
+
+    return nullptr;
+  }
+}
+
+TEST(MemoryAccounting, PushAccountTracksPeak)
+{
+  memory_account account("test push");
+
+  account.add(100);
+  account.add(50);
+  account.remove(100);
+
+  EXPECT_EQ(50U, account.get_live().bytes);
+  EXPECT_EQ(1U, account.get_live().objects);
+  EXPECT_EQ(150U, account.get_peak().bytes);
+  EXPECT_EQ(2U, account.get_peak().objects);
+
+  account.set(10, 3);
+  EXPECT_EQ(10U, account.get_live().bytes);
+  EXPECT_EQ(3U, account.get_live().objects);
+  EXPECT_EQ(150U, account.get_peak().bytes);
+  EXPECT_EQ(3U, account.get_peak().objects);
+}
+
+TEST(MemoryAccounting, SampledAccount)
+{
+  memory_usage current(1000, 4);
+  memory_account account("test sampled", [&current] { return current; });
+
+  EXPECT_EQ(1000U, account.get_live().bytes);
+
+  current = memory_usage(200, 1);
+  EXPECT_EQ(200U, account.get_live().bytes);
+  EXPECT_EQ(1000U, account.get_peak().bytes);
+  EXPECT_EQ(4U, account.get_peak().objects);
+}
+
+TEST(MemoryAccounting, ReportMergesSubsystems)
+{
+  memory_account first("test merged");
+  memory_account second("test merged");
+
+  first.add(10);
+  second.add(20, 2);
+
+  const std::vector<memory_report_entry> report = get_memory_report();
+  const memory_report_entry *entry = find_entry(report, "test merged");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(30U, entry->live.bytes);
+  EXPECT_EQ(3U, entry->live.objects);
+}
+
+TEST(MemoryAccounting, SamplerRunsWithoutRegistryLock)
+{
+  // Creating and destroying an account needs the lock of the
+  // registry, which used to be held while samplers ran.
+  memory_account account("test unlocked sampler",
+			 [] {
+			   memory_account inner("test inner");
+			   inner.add(7);
+			   return inner.get_live();
+			 });
+
+  const std::vector<memory_report_entry> report = get_memory_report();
+  const memory_report_entry *entry = find_entry(report, "test unlocked sampler");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(7U, entry->live.bytes);
+}
+
+TEST(MemoryAccounting, PeakOutlivesAccount)
+{
+  {
+    memory_account account("test retired");
+    account.add(4096, 8);
+    account.remove(4096, 8);
+  }
+
+  const std::vector<memory_report_entry> report = get_memory_report();
+  const memory_report_entry *entry = find_entry(report, "test retired");
+  ASSERT_NE(nullptr, entry);
+  EXPECT_EQ(0U, entry->live.bytes);
+  EXPECT_EQ(4096U, entry->peak.bytes);
+  EXPECT_EQ(8U, entry->peak.objects);
+}
+
+TEST(MemoryAccounting, WriteReport)
+{
+  memory_account account("test written");
+  account.add(12345);
+
+  std::ostringstream out;
+  write_memory_report(out);
+
+  EXPECT_NE(std::string::npos, out.str().find("test written"));
+  EXPECT_NE(std::string::npos, out.str().find("12345"));
+  EXPECT_NE(std::string::npos, out.str().find("Total"));
+}
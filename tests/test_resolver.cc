@@ -121,6 +121,20 @@ UNIVERSE [ \
   SOFTDEP a v1 -?> < b v2  b v3 > \
 ]";
 
+// Used to test joint scores with more than two choices: one solution
+// needs three changes, the other only one.
+const char *dummy_universe_7 = "\
+UNIVERSE [ \
+  PACKAGE a < v1 v2 > v1 \
+  PACKAGE b < v1 v2 > v1 \
+  PACKAGE c < v1 v2 > v1 \
+  PACKAGE d < v1 v2 > v1 \
+\
+  DEP a v1 -> < b v2 > \
+  DEP a v1 -> < c v2 > \
+  DEP a v1 -> < d v2 > \
+]";
+
 // Done this way so meaningful line numbers are generated.
 #define assertEqEquivalent(x1, x2) \
   do {									\
@@ -206,8 +220,11 @@ class ResolverTest : public CppUnit::TestFixture
   CPPUNIT_TEST(testCostOperations);
   CPPUNIT_TEST(testInitialState);
   CPPUNIT_TEST(testJointScores);
+  CPPUNIT_TEST(testJointScoresNeedAllChoices);
   CPPUNIT_TEST(testDropSolutionSupersets);
   CPPUNIT_TEST(testBreakSoftDepCost);
+  CPPUNIT_TEST(testBeamSearch);
+  CPPUNIT_TEST(testEffortProfile);
 
   CPPUNIT_TEST_SUITE_END();
 
@@ -1456,6 +1473,78 @@ private:
       }
   }
 
+  // Test that a joint score applies only to solutions that contain
+  // all of its choices, and that it applies only once however many
+  // choices it has.
+  void testJointScoresNeedAllChoices()
+  {
+    dummy_universe_ref u = parseUniverse(dummy_universe_7);
+    dummy_resolver r(10, -300, -100, 10000000, 500,
+                     cost_limits::minimum_cost,
+                     500,
+		     imm::map<package, version>(),
+		     u);
+    version av2 = u.find_package("a").version_from_name("v2");
+    version bv2 = u.find_package("b").version_from_name("v2");
+    version cv2 = u.find_package("c").version_from_name("v2");
+    version dv2 = u.find_package("d").version_from_name("v2");
+
+    std::vector<imm::set<version> > joint_choices(2);
+    joint_choices[0].insert(bv2);
+    joint_choices[0].insert(cv2);
+    joint_choices[0].insert(dv2);
+    joint_choices[1].insert(av2);
+    joint_choices[1].insert(bv2);
+    joint_choices[1].insert(cv2);
+
+    const int joint_scores[2] = { 100000, -200000 };
+    r.add_joint_score(joint_choices[0], joint_scores[0]);
+    r.add_joint_score(joint_choices[1], joint_scores[1]);
+
+    std::vector<solution> sols;
+    try
+      {
+	find_all_solutions(r, 1000000, NULL, sols);
+      }
+    catch(const NoMoreTime&)
+      {
+	CPPUNIT_FAIL("Unable to solve the solution in the ridiculous amount of time I allocated.");
+      }
+
+    bool saw_complete = false;
+    bool saw_partial = false;
+    for(std::vector<solution>::const_iterator it = sols.begin();
+	it != sols.end(); ++it)
+      {
+	int expected_score =
+	  ((int)it->get_choices().size()) * r.get_step_score() + r.get_full_solution_score();
+
+	for(int i = 0; i < 2; ++i)
+	  {
+	    std::size_t present = 0;
+	    for(imm::set<version>::const_iterator v = joint_choices[i].begin();
+		v != joint_choices[i].end(); ++v)
+	      if(it->version_of(v->get_package()) == *v)
+		++present;
+
+	    if(present == joint_choices[i].size())
+	      {
+		saw_complete = true;
+		expected_score += joint_scores[i];
+	      }
+	    else if(present > 0)
+	      saw_partial = true;
+	  }
+
+	CPPUNIT_ASSERT_EQUAL(expected_score, it->get_score());
+      }
+
+    CPPUNIT_ASSERT_MESSAGE("Expected a solution containing all the choices of a joint score",
+			   saw_complete);
+    CPPUNIT_ASSERT_MESSAGE("Expected a solution containing some of the choices of a joint score",
+			   saw_partial);
+  }
+
   // Test that the resolver ignores already-generated solutions when
   // generating successors.  Also tests that the resolver generates
   // solutions in the expected order in a simple situation.
@@ -1600,6 +1689,102 @@ private:
       CPPUNIT_ASSERT_EQUAL(cost::make_add_to_user_level(0, 1), sols[1].get_cost());
     }
   }
+
+  // Check that beam search drops the steps that fall outside the
+  // beam, and with them the solutions that they lead to.
+  void testBeamSearch()
+  {
+    // The broken dependency has four solvers, each of which is a
+    // solution by itself and all of which have the same cost.
+    dummy_universe_ref u = parseUniverse(dummy_universe_4_not_soft);
+
+    {
+      dummy_resolver r(10, -300, -100, 100000, 50000,
+                       cost_limits::minimum_cost,
+                       50,
+                       imm::map<dummy_universe::package, dummy_universe::version>(),
+                       u);
+
+      std::vector<solution> sols;
+      try
+        {
+          find_all_solutions(r, 50, NULL, sols);
+        }
+      catch(const NoMoreTime&)
+        {
+          CPPUNIT_FAIL("Ran out of time trying to solve a simple problem.");
+        }
+
+      CPPUNIT_ASSERT_EQUAL((std::size_t)4, sols.size());
+      CPPUNIT_ASSERT_EQUAL((std::size_t)0, r.get_num_pruned());
+    }
+
+    {
+      dummy_resolver r(10, -300, -100, 100000, 50000,
+                       cost_limits::minimum_cost,
+                       50,
+                       imm::map<dummy_universe::package, dummy_universe::version>(),
+                       u);
+      r.set_beam_width(1);
+
+      std::vector<solution> sols;
+      try
+        {
+          find_all_solutions(r, 50, NULL, sols);
+        }
+      catch(const NoMoreTime&)
+        {
+          CPPUNIT_FAIL("Ran out of time trying to solve a simple problem.");
+        }
+
+      CPPUNIT_ASSERT_EQUAL((std::size_t)1, sols.size());
+      CPPUNIT_ASSERT_EQUAL((std::size_t)3, r.get_num_pruned());
+      CPPUNIT_ASSERT_EQUAL((std::size_t)3, r.get_counts().pruned);
+    }
+  }
+
+  // Check that the search effort is charged to the dependency that
+  // caused it.
+  void testEffortProfile()
+  {
+    dummy_universe_ref u = parseUniverse(dummy_universe_4_not_soft);
+    dep av1d1 = *u.find_package("a").version_from_name("v1").deps_begin();
+
+    dummy_resolver r(10, -300, -100, 100000, 50000,
+                     cost_limits::minimum_cost,
+                     50,
+                     imm::map<dummy_universe::package, dummy_universe::version>(),
+                     u);
+    r.set_profile(true);
+
+    std::vector<solution> sols;
+    try
+      {
+        find_all_solutions(r, 50, NULL, sols);
+      }
+    catch(const NoMoreTime&)
+      {
+        CPPUNIT_FAIL("Ran out of time trying to solve a simple problem.");
+      }
+
+    // The root step branches on the only broken dependency, which
+    // has four solvers; each successor is a solution.
+    const std::map<dep, dummy_resolver::dep_effort> &efforts(r.get_dep_efforts());
+    CPPUNIT_ASSERT_EQUAL((std::size_t)1, efforts.size());
+
+    std::map<dep, dummy_resolver::dep_effort>::const_iterator found = efforts.find(av1d1);
+    CPPUNIT_ASSERT(found != efforts.end());
+    CPPUNIT_ASSERT_EQUAL((std::size_t)1, found->second.steps);
+    CPPUNIT_ASSERT_EQUAL((std::size_t)4, found->second.successors);
+    CPPUNIT_ASSERT_EQUAL((std::size_t)1, found->second.unresolved);
+
+    std::ostringstream report;
+    r.dump_dep_efforts(report, 10, "# ");
+    CPPUNIT_ASSERT(report.str().find("# Search effort by dependency") == 0);
+
+    r.reset();
+    CPPUNIT_ASSERT(r.get_dep_efforts().empty());
+  }
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(ResolverTest);
@@ -0,0 +1,281 @@
+/** \file test_resolver_solution_cache.cc */
+
+
+// Copyright (C) 2026 Aptitude developers
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License as
+// published by the Free Software Foundation; either version 2 of the
+// License, or (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; see the file COPYING.  If not, write to
+// the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+// Boston, MA 02110-1301, USA.
+
+// Local includes:
+#include "status_file_cache.h"
+
+#include <generic/apt/aptitude_resolver_universe.h>
+#include <generic/apt/resolver_solution_cache.h>
+#include <generic/apt/resolver_solution_encoding.h>
+#include <generic/util/temp.h>
+
+// System includes:
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+
+using aptitude::apt::cached_resolver_outcome;
+using aptitude::apt::decode_cost;
+using aptitude::apt::decode_solution;
+using aptitude::apt::encode_cost;
+using aptitude::apt::encode_solution;
+using aptitude::apt::resolver_solution_cache;
+
+namespace
+{
+  class ResolverSolutionCache : public ::testing::Test
+  {
+  protected:
+    void SetUp()
+    {
+      temp::initialize("testResolverSolutionCache");
+    }
+
+    void TearDown()
+    {
+      temp::shutdown();
+    }
+  };
+
+  /** Loads a cache in which the installed package "a" depends on the
+   *  installed package "b".
+   */
+  class ResolverSolutionEncoding : public ::testing::Test
+  {
+  protected:
+    typedef generic_choice<aptitude_universe> choice;
+    typedef generic_choice_set<aptitude_universe> choice_set;
+    typedef generic_solution<aptitude_universe> solution;
+
+    std::unique_ptr<status_file_cache> cache;
+
+    void SetUp()
+    {
+      temp::initialize("testResolverSolutionEncoding");
+
+      cache.reset(new status_file_cache(installed_package("a", "b") +
+					installed_package("b")));
+      ASSERT_TRUE(cache->is_open());
+    }
+
+    void TearDown()
+    {
+      cache.reset();
+      temp::shutdown();
+    }
+
+    aptitude_resolver_version removal(const std::string &name)
+    {
+      return aptitude_resolver_version::make_removal((*cache)->FindPkg(name),
+						     &**cache);
+    }
+
+    aptitude_resolver_version current(const std::string &name)
+    {
+      return aptitude_resolver_version::make_install((*cache)->FindPkg(name).CurrentVer(),
+						     &**cache);
+    }
+
+    /** \return the dependency of "a" on "b". */
+    aptitude_resolver_dep a_depends_b()
+    {
+      return *current("a").deps_begin();
+    }
+
+    solution make_solution(const choice_set &choices, const cost &c)
+    {
+      return solution(choices, resolver_initial_state<aptitude_universe>(),
+		      -42, c);
+    }
+
+    bool decode(const cached_resolver_outcome &outcome, solution &out,
+		std::string &why)
+    {
+      return decode_solution(outcome, &**cache,
+			     resolver_initial_state<aptitude_universe>(),
+			     imm::set<aptitude_resolver_dep>(),
+			     out, why);
+    }
+  };
+}
+
+TEST_F(ResolverSolutionCache, StoreAndLookup)
+{
+  temp::name tn("cache");
+  resolver_solution_cache cache(tn.get_name() + "/solutions");
+
+  cached_resolver_outcome outcome;
+  outcome.found = true;
+  outcome.is_keep_all = false;
+  outcome.score = -120;
+  outcome.cost = "1 0 add 10";
+  outcome.choices.push_back("install 0 0 foo 1.0");
+  outcome.choices.push_back("break bar 2.0 1 -1");
+
+  const std::string key = resolver_solution_cache::chain_key("", "problem");
+  cache.store(key, outcome);
+
+  cached_resolver_outcome found;
+  ASSERT_TRUE(cache.lookup(key, found));
+  EXPECT_TRUE(found.found);
+  EXPECT_FALSE(found.is_keep_all);
+  EXPECT_EQ(-120, found.score);
+  EXPECT_EQ(outcome.cost, found.cost);
+  EXPECT_EQ(outcome.choices, found.choices);
+}
+
+TEST_F(ResolverSolutionCache, StoreExhausted)
+{
+  temp::name tn("cache");
+  resolver_solution_cache cache(tn.get_name());
+
+  cache.store("exhausted", cached_resolver_outcome());
+
+  cached_resolver_outcome found;
+  found.found = true;
+  found.choices.push_back("install 0 0 foo 1.0");
+  ASSERT_TRUE(cache.lookup("exhausted", found));
+  EXPECT_FALSE(found.found);
+  EXPECT_TRUE(found.choices.empty());
+}
+
+TEST_F(ResolverSolutionCache, Missing)
+{
+  temp::name tn("cache");
+  resolver_solution_cache cache(tn.get_name());
+
+  cached_resolver_outcome found;
+  EXPECT_FALSE(cache.lookup("missing", found));
+}
+
+TEST_F(ResolverSolutionCache, Malformed)
+{
+  temp::name tn("cache");
+  resolver_solution_cache cache(tn.get_name());
+
+  cache.store("entry", cached_resolver_outcome());
+  {
+    std::ofstream out((tn.get_name() + "/entry").c_str());
+    out << "aptitude-resolver-solution 0\nfound\nchanges\n10\n";
+  }
+
+  cached_resolver_outcome found;
+  EXPECT_FALSE(cache.lookup("entry", found));
+}
+
+TEST_F(ResolverSolutionCache, ChainKey)
+{
+  const std::string key = resolver_solution_cache::chain_key("", "problem");
+
+  EXPECT_EQ(64U, key.size());
+  EXPECT_EQ(key, resolver_solution_cache::chain_key("", "problem"));
+  EXPECT_NE(key, resolver_solution_cache::chain_key("", "problem\n"));
+  EXPECT_NE(resolver_solution_cache::chain_key("a", "b"),
+	    resolver_solution_cache::chain_key("ab", ""));
+  EXPECT_NE(key, resolver_solution_cache::chain_key(key, ""));
+}
+
+TEST(ResolverSolutionCost, RoundTrip)
+{
+  const cost costs[] = {
+    cost(),
+    cost::make_advance_structural_level(2),
+    cost::make_add_to_user_level(0, 5) + cost::make_advance_user_level(3, 100),
+    cost::make_advance_structural_level(1) + cost::make_advance_user_level(1, -7),
+  };
+
+  for(const cost &c : costs)
+    {
+      cost decoded;
+      ASSERT_TRUE(decode_cost(encode_cost(c), decoded)) << c;
+      EXPECT_EQ(c, decoded) << c;
+    }
+}
+
+TEST(ResolverSolutionCost, Malformed)
+{
+  cost decoded;
+  EXPECT_FALSE(decode_cost("", decoded));
+  EXPECT_FALSE(decode_cost("0 1 frobnicate 3", decoded));
+  EXPECT_FALSE(decode_cost("0 1 add 0", decoded));
+  EXPECT_FALSE(decode_cost("0 1 add", decoded));
+}
+
+TEST_F(ResolverSolutionEncoding, RoundTrip)
+{
+  choice_set choices;
+  choices.insert_or_narrow(choice::make_install_version(removal("a"), 0));
+  choices.insert_or_narrow(choice::make_install_version(current("b"), a_depends_b(), 1));
+  const solution sol = make_solution(choices,
+				     cost::make_advance_structural_level(1) +
+				     cost::make_add_to_user_level(0, 10));
+
+  const cached_resolver_outcome outcome = encode_solution(sol, false);
+  EXPECT_TRUE(outcome.found);
+  EXPECT_FALSE(outcome.is_keep_all);
+  EXPECT_EQ(2U, outcome.choices.size());
+
+  solution decoded;
+  std::string why;
+  ASSERT_TRUE(decode(outcome, decoded, why)) << why;
+  EXPECT_EQ(sol.get_choices(), decoded.get_choices());
+  EXPECT_EQ(sol.get_score(), decoded.get_score());
+  EXPECT_EQ(sol.get_cost(), decoded.get_cost());
+}
+
+// Removing "b" breaks the dependency of "a" on it; this is only
+// found by looking at the reverse dependencies of the removed version.
+TEST_F(ResolverSolutionEncoding, RejectBrokenReverseDependency)
+{
+  choice_set choices;
+  choices.insert_or_narrow(choice::make_install_version(removal("b"), 0));
+
+  solution decoded;
+  std::string why;
+  EXPECT_FALSE(decode(encode_solution(make_solution(choices, cost()), false),
+		      decoded, why));
+  EXPECT_FALSE(why.empty());
+}
+
+TEST_F(ResolverSolutionEncoding, RejectUnknownVersion)
+{
+  cached_resolver_outcome outcome;
+  outcome.found = true;
+  outcome.cost = encode_cost(cost());
+  outcome.choices.push_back("install 0 0 b 2.0");
+
+  solution decoded;
+  std::string why;
+  EXPECT_FALSE(decode(outcome, decoded, why));
+  EXPECT_FALSE(why.empty());
+}
+
+TEST_F(ResolverSolutionEncoding, RejectMissingCost)
+{
+  choice_set choices;
+  choices.insert_or_narrow(choice::make_install_version(removal("a"), 0));
+  cached_resolver_outcome outcome = encode_solution(make_solution(choices, cost()), false);
+  outcome.cost.clear();
+
+  solution decoded;
+  std::string why;
+  EXPECT_FALSE(decode(outcome, decoded, why));
+}
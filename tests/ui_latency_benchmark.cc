@@ -0,0 +1,621 @@
+// ui_latency_benchmark.cc
+//
+//   Copyright (C) 2026 Aptitude developers
+//
+//   This program is free software; you can redistribute it and/or
+//   modify it under the terms of the GNU General Public License as
+//   published by the Free Software Foundation; either version 2 of
+//   the License, or (at your option) any later version.
+//
+//   This program is distributed in the hope that it will be useful,
+//   but WITHOUT ANY WARRANTY; without even the implied warranty of
+//   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+//   General Public License for more details.
+//
+//   You should have received a copy of the GNU General Public License
+//   along with this program; see the file COPYING.  If not, write to
+//   the Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+//   Boston, MA 02110-1301, USA.
+//
+// Measures how quickly the curses interface responds to keystrokes.
+//
+// The benchmark generates a synthetic dpkg status file, starts
+// aptitude on a pseudo-terminal with every apt directory redirected to
+// a scratch directory, and replays a script of keystrokes.  After each
+// keystroke it reads the screen updates until the terminal has been
+// quiet for a while; the latency of the keystroke is the time between
+// sending it and receiving the last byte of its update.  Percentiles
+// are reported for each step of the script.
+//
+// Usage:
+//
+//   ui_latency_benchmark [--packages N] [--quiet-ms N] [--script FILE]
+//                        APTITUDE [ARGUMENTS...]
+//
+// Each line of a script names a step and lists its keystrokes, for
+// instance "scroll <Down>*40".  Printable characters stand for
+// themselves, <Name> is a special key (Enter, Esc, Tab, Space, Up,
+// Down, Left, Right, Home, End, PageUp, PageDown, or C-x for a
+// control character), and *N repeats the preceding keystroke.
+// Whitespace between keystrokes is ignored and "#" starts a comment.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  typedef std::chrono::steady_clock clock_type;
+
+  // Uses the default keybindings.  The synthetic cache makes pkg00000
+  // a dependency of every other package, so removing it gives the
+  // resolver something to do.
+  const char *default_script =
+    "expand     [\n"
+    "scroll     <Down>*40\n"
+    "page       <PageDown>*5 <PageUp>*5\n"
+    "search     /pkg01000<Enter>\n"
+    "search-next n*5\n"
+    "info       i*3\n"
+    "limit      l~npkg001<Enter>\n"
+    "unlimit    l<C-u><Enter>\n"
+    "mark       /pkg00500<Enter> -*3 +*3\n"
+    "break      /^pkg00000$<Enter> -\n"
+    "resolver   .*3 ,*2\n"
+    "preview    g\n"
+    "preview-scroll <Down>*20\n"
+    "close      q\n"
+    "undo       <C-u>\n";
+
+  struct options
+  {
+    int packages;
+    int quiet_ms;
+    int startup_timeout_s;
+    std::string script_file;
+    std::vector<std::string> aptitude_argv;
+
+    options()
+      : packages(2000), quiet_ms(150), startup_timeout_s(120)
+    {
+    }
+  };
+
+  struct step
+  {
+    std::string name;
+    std::vector<std::string> keys;
+  };
+
+  void usage(const char *argv0)
+  {
+    std::cerr << "Usage: " << argv0
+	      << " [--packages N] [--quiet-ms N] [--startup-timeout S] [--script FILE]"
+	      << " APTITUDE [ARGUMENTS...]" << std::endl;
+  }
+
+  bool parse_options(int argc, char **argv, options &opts)
+  {
+    int i = 1;
+    for(; i < argc && argv[i][0] == '-'; ++i)
+      {
+	const std::string arg(argv[i]);
+	if(i + 1 >= argc)
+	  return false;
+
+	if(arg == "--packages")
+	  opts.packages = atoi(argv[++i]);
+	else if(arg == "--quiet-ms")
+	  opts.quiet_ms = atoi(argv[++i]);
+	else if(arg == "--startup-timeout")
+	  opts.startup_timeout_s = atoi(argv[++i]);
+	else if(arg == "--script")
+	  opts.script_file = argv[++i];
+	else
+	  return false;
+      }
+
+    for(; i < argc; ++i)
+      opts.aptitude_argv.push_back(argv[i]);
+
+    return !opts.aptitude_argv.empty() && opts.packages > 0 && opts.quiet_ms > 0;
+  }
+
+  bool key_from_name(const std::string &name, std::string &out)
+  {
+    static const std::map<std::string, std::string> keys = {
+      // Cursor keys in keypad-transmit mode, as curses enables it.
+      { "Up", "\033OA" },
+      { "Down", "\033OB" },
+      { "Right", "\033OC" },
+      { "Left", "\033OD" },
+      { "Home", "\033OH" },
+      { "End", "\033OF" },
+      { "PageUp", "\033[5~" },
+      { "PageDown", "\033[6~" },
+      { "Enter", "\r" },
+      { "Esc", "\033" },
+      { "Tab", "\t" },
+      { "Space", " " },
+    };
+
+    std::map<std::string, std::string>::const_iterator found = keys.find(name);
+    if(found != keys.end())
+      {
+	out = found->second;
+	return true;
+      }
+
+    if(name.size() == 3 && name[0] == 'C' && name[1] == '-')
+      {
+	out = std::string(1, name[2] & 0x1f);
+	return true;
+      }
+
+    return false;
+  }
+
+  /** \brief Parse the keystrokes of one step. */
+  bool parse_keys(const std::string &spec, std::vector<std::string> &keys)
+  {
+    std::string::size_type i = 0;
+    while(i < spec.size())
+      {
+	const char c = spec[i];
+
+	if(isspace(static_cast<unsigned char>(c)))
+	  ++i;
+	else if(c == '*' && !keys.empty())
+	  {
+	    std::string::size_type end = i + 1;
+	    while(end < spec.size() && isdigit(static_cast<unsigned char>(spec[end])))
+	      ++end;
+
+	    const int count = atoi(spec.substr(i + 1, end - i - 1).c_str());
+	    if(count < 1)
+	      return false;
+
+	    const std::string repeated = keys.back();
+	    for(int n = 1; n < count; ++n)
+	      keys.push_back(repeated);
+	    i = end;
+	  }
+	else if(c == '<')
+	  {
+	    const std::string::size_type end = spec.find('>', i);
+	    if(end == std::string::npos)
+	      return false;
+
+	    std::string key;
+	    if(!key_from_name(spec.substr(i + 1, end - i - 1), key))
+	      return false;
+
+	    keys.push_back(key);
+	    i = end + 1;
+	  }
+	else
+	  {
+	    keys.push_back(std::string(1, c));
+	    ++i;
+	  }
+      }
+
+    return true;
+  }
+
+  bool parse_script(std::istream &in, std::vector<step> &steps)
+  {
+    std::string line;
+    int line_number = 0;
+    while(std::getline(in, line))
+      {
+	++line_number;
+
+	const std::string::size_type comment = line.find('#');
+	if(comment != std::string::npos)
+	  line.erase(comment);
+
+	std::istringstream words(line);
+	step s;
+	if(!(words >> s.name))
+	  continue;
+
+	std::string spec;
+	std::getline(words, spec);
+	if(!parse_keys(spec, s.keys) || s.keys.empty())
+	  {
+	    std::cerr << "Invalid keystrokes on line " << line_number
+		      << " of the script." << std::endl;
+	    return false;
+	  }
+
+	steps.push_back(s);
+      }
+
+    return true;
+  }
+
+  bool write_file(const std::string &path, const std::string &contents)
+  {
+    std::ofstream out(path.c_str());
+    out << contents;
+    return static_cast<bool>(out);
+  }
+
+  std::string package_name(int n)
+  {
+    char name[32];
+    snprintf(name, sizeof(name), "pkg%05d", n);
+    return name;
+  }
+
+  /** \brief Write a dpkg status file with the given number of
+   *  installed packages.
+   *
+   *  Every package depends on pkg00000 and on a few of the packages
+   *  before it, so that the dependency graph is a dense DAG.
+   */
+  std::string make_status_file(int packages)
+  {
+    static const char *sections[] = { "admin", "devel", "libs", "net", "utils", "x11" };
+
+    std::ostringstream out;
+    for(int i = 0; i < packages; ++i)
+      {
+	out << "Package: " << package_name(i) << "\n"
+	    << "Status: install ok installed\n"
+	    << "Priority: optional\n"
+	    << "Section: " << sections[i % (sizeof(sections) / sizeof(sections[0]))] << "\n"
+	    << "Installed-Size: " << (i % 97 + 1) * 16 << "\n"
+	    << "Maintainer: Benchmark <benchmark@example.org>\n"
+	    << "Architecture: all\n"
+	    << "Version: 1." << i % 7 << "-" << i % 3 + 1 << "\n";
+
+	if(i > 0)
+	  {
+	    out << "Depends: " << package_name(0);
+	    if(i / 2 > 0)
+	      out << ", " << package_name(i / 2);
+	    if(i > 2)
+	      out << ", " << package_name(i - 1) << " | " << package_name(i - 2);
+	    out << "\n";
+	  }
+	if(i > 3)
+	  out << "Recommends: " << package_name(i / 3) << "\n";
+
+	out << "Description: synthetic package number " << i << "\n"
+	    << " This package was generated for the user interface benchmark.\n"
+	    << "\n";
+      }
+
+    return out.str();
+  }
+
+  /** \brief Set up the scratch directory and return the apt options
+   *  that point aptitude at it.
+   */
+  bool setup_scratch(const std::string &root, int packages,
+		     std::vector<std::string> &apt_options)
+  {
+    const char *dirs[] = { "/lists", "/lists/partial", "/cache", "/state",
+			   "/aptitude", "/etc", "/etc/sources.list.d",
+			   "/etc/preferences.d", "/home" };
+    for(const char *dir : dirs)
+      if(mkdir((root + dir).c_str(), 0700) != 0)
+	return false;
+
+    if(!write_file(root + "/status", make_status_file(packages)) ||
+       !write_file(root + "/etc/sources.list", ""))
+      return false;
+
+    apt_options = {
+      "Dir::State::status=" + root + "/status",
+      "Dir::State::Lists=" + root + "/lists",
+      "Dir::State::extended_states=" + root + "/state/extended_states",
+      "Dir::Cache=" + root + "/cache",
+      "Dir::Aptitude::state=" + root + "/aptitude",
+      "Dir::Etc::sourcelist=" + root + "/etc/sources.list",
+      "Dir::Etc::sourceparts=" + root + "/etc/sources.list.d",
+      "Dir::Etc::preferences=" + root + "/etc/preferences",
+      "Dir::Etc::preferencesparts=" + root + "/etc/preferences.d",
+      "Debug::NoLocking=true",
+      "Aptitude::Log=",
+    };
+
+    return true;
+  }
+
+  void remove_scratch(const std::string &root)
+  {
+    const std::string command = "rm -rf '" + root + "'";
+    if(system(command.c_str()) != 0)
+      std::cerr << "Unable to remove " << root << std::endl;
+  }
+
+  /** \brief A child process running on a pseudo-terminal. */
+  class terminal_session
+  {
+    pid_t pid;
+    int master;
+    bool exited;
+
+  public:
+    terminal_session()
+      : pid(-1), master(-1), exited(false)
+    {
+    }
+
+    ~terminal_session()
+    {
+      if(pid > 0 && !exited)
+	{
+	  kill(pid, SIGTERM);
+	  waitpid(pid, NULL, 0);
+	}
+
+      if(master >= 0)
+	close(master);
+    }
+
+    bool start(const std::vector<std::string> &argv, const std::string &home)
+    {
+      struct winsize size;
+      memset(&size, 0, sizeof(size));
+      size.ws_row = 24;
+      size.ws_col = 80;
+
+      pid = forkpty(&master, NULL, NULL, &size);
+      if(pid < 0)
+	return false;
+
+      if(pid == 0)
+	{
+	  setenv("HOME", home.c_str(), 1);
+	  setenv("TERM", "xterm", 1);
+	  setenv("LC_ALL", "C", 1);
+	  // Don't wait a second after Esc for the rest of a sequence.
+	  setenv("ESCDELAY", "25", 1);
+
+	  std::vector<char *> args;
+	  for(const std::string &arg : argv)
+	    args.push_back(const_cast<char *>(arg.c_str()));
+	  args.push_back(NULL);
+
+	  execv(args[0], &args[0]);
+	  perror("execv");
+	  _exit(127);
+	}
+
+      return true;
+    }
+
+    bool has_exited() const { return exited; }
+
+    void send(const std::string &key)
+    {
+      std::string::size_type written = 0;
+      while(written < key.size())
+	{
+	  const ssize_t n = write(master, key.data() + written, key.size() - written);
+	  if(n < 0)
+	    {
+	      if(errno == EINTR)
+		continue;
+	      exited = true;
+	      return;
+	    }
+	  written += n;
+	}
+    }
+
+    /** \brief Read output until none arrives for quiet_ms or the
+     *  deadline passes.
+     *
+     *  \return The time at which the last byte arrived, or \b since if
+     *  there was no output.
+     */
+    clock_type::time_point drain(clock_type::time_point since,
+				 int quiet_ms,
+				 clock_type::time_point deadline)
+    {
+      clock_type::time_point last_output = since;
+      char buf[4096];
+
+      while(!exited)
+	{
+	  const clock_type::time_point now = clock_type::now();
+	  if(now >= deadline)
+	    break;
+
+	  const long remaining =
+	    std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+
+	  struct pollfd pfd;
+	  pfd.fd = master;
+	  pfd.events = POLLIN;
+	  pfd.revents = 0;
+
+	  const int rval = poll(&pfd, 1, std::min<long>(quiet_ms, remaining));
+	  if(rval < 0)
+	    {
+	      if(errno == EINTR)
+		continue;
+	      break;
+	    }
+	  else if(rval == 0)
+	    break;
+
+	  const ssize_t n = read(master, buf, sizeof(buf));
+	  if(n > 0)
+	    last_output = clock_type::now();
+	  else if(n < 0 && errno == EINTR)
+	    continue;
+	  else
+	    // EIO: the child closed the terminal.
+	    exited = true;
+	}
+
+      return last_output;
+    }
+  };
+
+  double percentile(const std::vector<double> &sorted, double p)
+  {
+    if(sorted.empty())
+      return 0;
+
+    // Nearest-rank percentile.
+    std::size_t rank = static_cast<std::size_t>(p / 100.0 * sorted.size() + 0.999999);
+    rank = std::max<std::size_t>(1, std::min(rank, sorted.size()));
+    return sorted[rank - 1];
+  }
+
+  void print_row(const std::string &name, std::vector<double> latencies)
+  {
+    std::sort(latencies.begin(), latencies.end());
+
+    printf("%-16s %6zu %9.1f %9.1f %9.1f %9.1f\n",
+	   name.c_str(), latencies.size(),
+	   percentile(latencies, 50), percentile(latencies, 90),
+	   percentile(latencies, 99),
+	   latencies.empty() ? 0.0 : latencies.back());
+  }
+}
+
+int main(int argc, char **argv)
+{
+  options opts;
+  if(!parse_options(argc, argv, opts))
+    {
+      usage(argv[0]);
+      return 2;
+    }
+
+  std::vector<step> steps;
+  if(opts.script_file.empty())
+    {
+      std::istringstream in(default_script);
+      parse_script(in, steps);
+    }
+  else
+    {
+      std::ifstream in(opts.script_file.c_str());
+      if(!in)
+	{
+	  std::cerr << "Unable to open " << opts.script_file << std::endl;
+	  return 1;
+	}
+      if(!parse_script(in, steps))
+	return 1;
+    }
+
+  char root_template[] = "/tmp/aptitude-ui-benchmark.XXXXXX";
+  if(mkdtemp(root_template) == NULL)
+    {
+      perror("mkdtemp");
+      return 1;
+    }
+  const std::string root(root_template);
+
+  std::vector<std::string> apt_options;
+  if(!setup_scratch(root, opts.packages, apt_options))
+    {
+      std::cerr << "Unable to set up " << root << std::endl;
+      remove_scratch(root);
+      return 1;
+    }
+
+  std::vector<std::string> child_argv;
+  child_argv.push_back(opts.aptitude_argv[0]);
+  for(const std::string &option : apt_options)
+    {
+      child_argv.push_back("-o");
+      child_argv.push_back(option);
+    }
+  child_argv.insert(child_argv.end(),
+		    opts.aptitude_argv.begin() + 1, opts.aptitude_argv.end());
+
+  int rval = 0;
+  {
+    terminal_session session;
+    if(!session.start(child_argv, root + "/home"))
+      {
+	perror("forkpty");
+	remove_scratch(root);
+	return 1;
+      }
+
+    // Wait for the cache to load and the first screen to be drawn;
+    // loading shows progress, so a longer silence means it is done.
+    const clock_type::time_point started = clock_type::now();
+    const clock_type::time_point ready =
+      session.drain(started, std::max(opts.quiet_ms, 1000),
+		    started + std::chrono::seconds(opts.startup_timeout_s));
+
+    if(session.has_exited())
+      {
+	std::cerr << "aptitude exited during startup." << std::endl;
+	remove_scratch(root);
+	return 1;
+      }
+
+    printf("Packages: %d, startup: %.1f ms, quiet period: %d ms\n\n",
+	   opts.packages,
+	   std::chrono::duration<double, std::milli>(ready - started).count(),
+	   opts.quiet_ms);
+    printf("%-16s %6s %9s %9s %9s %9s\n",
+	   "Step", "Keys", "p50 ms", "p90 ms", "p99 ms", "max ms");
+
+    std::vector<double> all_latencies;
+    for(const step &s : steps)
+      {
+	std::vector<double> latencies;
+	for(const std::string &key : s.keys)
+	  {
+	    if(session.has_exited())
+	      break;
+
+	    const clock_type::time_point sent = clock_type::now();
+	    session.send(key);
+	    const clock_type::time_point done =
+	      session.drain(sent, opts.quiet_ms,
+			    sent + std::chrono::seconds(opts.startup_timeout_s));
+
+	    latencies.push_back(std::chrono::duration<double, std::milli>(done - sent).count());
+	  }
+
+	all_latencies.insert(all_latencies.end(), latencies.begin(), latencies.end());
+	print_row(s.name, latencies);
+
+	if(session.has_exited())
+	  {
+	    std::cerr << "aptitude exited during step \"" << s.name << "\"." << std::endl;
+	    rval = 1;
+	    break;
+	  }
+      }
+
+    print_row("total", all_latencies);
+  }
+
+  remove_scratch(root);
+  return rval;
+}